@@ -0,0 +1,605 @@
+//===- llvm/ADT/SwissTableMap.h - Group probed hash table -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the SwissTableMap class, an open addressing hash map that
+// keeps one byte of metadata per bucket and probes sixteen buckets at a time.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_SWISSTABLEMAP_H
+#define LLVM_ADT_SWISSTABLEMAP_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/EpochTracker.h"
+#include "llvm/Support/MathExtras.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace llvm {
+
+namespace detail {
+
+/// Control byte values for buckets that do not hold an entry. Full buckets
+/// store the top seven bits of the key's hash, so they are never negative.
+enum : int8_t { SwissCtrlEmpty = -128, SwissCtrlDeleted = -2 };
+
+/// A window of sixteen control bytes that is matched against in one step.
+struct SwissGroup {
+  static const unsigned Width = 16;
+
+#if defined(__SSE2__)
+  __m128i Ctrl;
+
+  explicit SwissGroup(const int8_t *P)
+      : Ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(P))) {}
+
+  /// Return a mask of the buckets whose control byte is \p H2.
+  uint32_t match(int8_t H2) const {
+    return static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(H2), Ctrl)));
+  }
+
+  /// Return a mask of the buckets that are empty or deleted.
+  uint32_t matchEmptyOrDeleted() const {
+    return static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmplt_epi8(Ctrl, _mm_set1_epi8(-1))));
+  }
+#else
+  const int8_t *Ctrl;
+
+  explicit SwissGroup(const int8_t *P) : Ctrl(P) {}
+
+  uint32_t match(int8_t H2) const {
+    uint32_t Mask = 0;
+    for (unsigned I = 0; I != Width; ++I)
+      if (Ctrl[I] == H2)
+        Mask |= 1u << I;
+    return Mask;
+  }
+
+  uint32_t matchEmptyOrDeleted() const {
+    uint32_t Mask = 0;
+    for (unsigned I = 0; I != Width; ++I)
+      if (Ctrl[I] < -1)
+        Mask |= 1u << I;
+    return Mask;
+  }
+#endif
+
+  /// Return a mask of the empty buckets.
+  uint32_t matchEmpty() const { return match(SwissCtrlEmpty); }
+};
+
+template <typename KeyT, typename ValueT, bool IsConst>
+class SwissTableMapIterator : DebugEpochBase::HandleBase {
+  typedef SwissTableMapIterator<KeyT, ValueT, true> ConstIterator;
+  friend class SwissTableMapIterator<KeyT, ValueT, true>;
+  friend class SwissTableMapIterator<KeyT, ValueT, false>;
+  typedef DenseMapPair<KeyT, ValueT> Bucket;
+
+public:
+  typedef ptrdiff_t difference_type;
+  typedef typename std::conditional<IsConst, const Bucket, Bucket>::type
+      value_type;
+  typedef value_type *pointer;
+  typedef value_type &reference;
+  typedef std::forward_iterator_tag iterator_category;
+
+private:
+  const int8_t *Ctrl;
+  pointer Ptr, End;
+
+public:
+  SwissTableMapIterator() : Ctrl(nullptr), Ptr(nullptr), End(nullptr) {}
+
+  SwissTableMapIterator(const int8_t *C, pointer Pos, pointer E,
+                        const DebugEpochBase &Epoch, bool NoAdvance = false)
+      : DebugEpochBase::HandleBase(&Epoch), Ctrl(C), Ptr(Pos), End(E) {
+    assert(isHandleInSync() && "invalid construction!");
+    if (!NoAdvance)
+      AdvancePastEmptyBuckets();
+  }
+
+  // Converting ctor from non-const iterators to const iterators. SFINAE'd out
+  // for const iterator destinations so it doesn't end up as a user defined copy
+  // constructor.
+  template <bool IsConstSrc,
+            typename = typename std::enable_if<!IsConstSrc && IsConst>::type>
+  SwissTableMapIterator(
+      const SwissTableMapIterator<KeyT, ValueT, IsConstSrc> &I)
+      : DebugEpochBase::HandleBase(I), Ctrl(I.Ctrl), Ptr(I.Ptr), End(I.End) {}
+
+  reference operator*() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    return *Ptr;
+  }
+  pointer operator->() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    return Ptr;
+  }
+
+  bool operator==(const ConstIterator &RHS) const {
+    assert((!Ptr || isHandleInSync()) && "handle not in sync!");
+    assert((!RHS.Ptr || RHS.isHandleInSync()) && "handle not in sync!");
+    assert(getEpochAddress() == RHS.getEpochAddress() &&
+           "comparing incomparable iterators!");
+    return Ptr == RHS.Ptr;
+  }
+  bool operator!=(const ConstIterator &RHS) const {
+    return !(*this == RHS);
+  }
+
+  SwissTableMapIterator &operator++() { // Preincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    ++Ptr;
+    ++Ctrl;
+    AdvancePastEmptyBuckets();
+    return *this;
+  }
+  SwissTableMapIterator operator++(int) { // Postincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    SwissTableMapIterator Tmp = *this;
+    ++*this;
+    return Tmp;
+  }
+
+private:
+  void AdvancePastEmptyBuckets() {
+    while (Ptr != End && *Ctrl < 0) {
+      ++Ptr;
+      ++Ctrl;
+    }
+  }
+};
+
+} // end namespace detail
+
+/// An open addressing hash map with the interface and the \c DenseMapInfo
+/// traits of \c DenseMap.
+///
+/// Next to the buckets the table keeps one control byte per bucket, holding
+/// seven bits of the key's hash or marking the bucket empty or deleted. A
+/// lookup compares sixteen control bytes at once (with SSE2 where available)
+/// and only calls \c KeyInfoT::isEqual on buckets whose hash bits match, so
+/// long probe sequences cost about one comparison per group instead of one
+/// key comparison per bucket. The empty and tombstone keys of \c KeyInfoT are
+/// never used and may be stored like any other key.
+///
+/// Like \c DenseMap, any insertion or erasure invalidates iterators and
+/// references into the map.
+template <typename KeyT, typename ValueT,
+          typename KeyInfoT = DenseMapInfo<KeyT>>
+class SwissTableMap : public DebugEpochBase {
+public:
+  typedef unsigned size_type;
+  typedef KeyT key_type;
+  typedef ValueT mapped_type;
+  typedef detail::DenseMapPair<KeyT, ValueT> value_type;
+  typedef detail::SwissTableMapIterator<KeyT, ValueT, false> iterator;
+  typedef detail::SwissTableMapIterator<KeyT, ValueT, true> const_iterator;
+
+private:
+  typedef value_type BucketT;
+  static const unsigned GroupWidth = detail::SwissGroup::Width;
+
+  int8_t *Ctrl;
+  BucketT *Buckets;
+  unsigned NumBuckets;
+  unsigned NumEntries;
+  /// Number of empty buckets that can still be filled before the table has to
+  /// be rehashed to stay below its maximum load factor.
+  unsigned GrowthLeft;
+
+public:
+  /// Create a map with enough buckets for \p InitialReserve entries.
+  explicit SwissTableMap(unsigned InitialReserve = 0)
+      : Ctrl(nullptr), Buckets(nullptr), NumBuckets(0), NumEntries(0),
+        GrowthLeft(0) {
+    reserve(InitialReserve);
+  }
+
+  SwissTableMap(const SwissTableMap &Other)
+      : Ctrl(nullptr), Buckets(nullptr), NumBuckets(0), NumEntries(0),
+        GrowthLeft(0) {
+    if (!Other.NumBuckets)
+      return;
+    allocate(Other.NumBuckets);
+    std::memcpy(Ctrl, Other.Ctrl, NumBuckets + GroupWidth);
+    for (unsigned I = 0; I != NumBuckets; ++I)
+      if (Ctrl[I] >= 0)
+        ::new (&Buckets[I]) BucketT(Other.Buckets[I]);
+    NumEntries = Other.NumEntries;
+    GrowthLeft = Other.GrowthLeft;
+  }
+
+  SwissTableMap(SwissTableMap &&Other)
+      : Ctrl(nullptr), Buckets(nullptr), NumBuckets(0), NumEntries(0),
+        GrowthLeft(0) {
+    swap(Other);
+  }
+
+  ~SwissTableMap() {
+    destroyAll();
+    deallocate();
+  }
+
+  SwissTableMap &operator=(const SwissTableMap &Other) {
+    if (&Other != this) {
+      SwissTableMap Tmp(Other);
+      swap(Tmp);
+    }
+    return *this;
+  }
+
+  SwissTableMap &operator=(SwissTableMap &&Other) {
+    SwissTableMap Tmp(std::move(Other));
+    swap(Tmp);
+    return *this;
+  }
+
+  void swap(SwissTableMap &RHS) {
+    this->incrementEpoch();
+    RHS.incrementEpoch();
+    std::swap(Ctrl, RHS.Ctrl);
+    std::swap(Buckets, RHS.Buckets);
+    std::swap(NumBuckets, RHS.NumBuckets);
+    std::swap(NumEntries, RHS.NumEntries);
+    std::swap(GrowthLeft, RHS.GrowthLeft);
+  }
+
+  inline iterator begin() {
+    // When the map is empty, avoid the overhead of advancing past the empty
+    // buckets.
+    if (empty())
+      return end();
+    return makeIterator(0, /*NoAdvance=*/false);
+  }
+  inline iterator end() { return makeIterator(NumBuckets); }
+  inline const_iterator begin() const {
+    if (empty())
+      return end();
+    return makeConstIterator(0, /*NoAdvance=*/false);
+  }
+  inline const_iterator end() const { return makeConstIterator(NumBuckets); }
+
+  bool empty() const { return NumEntries == 0; }
+  unsigned size() const { return NumEntries; }
+
+  /// Grow the map so that it can hold \p NumEntries entries without
+  /// rehashing.
+  void reserve(size_type NumEntries) {
+    unsigned NewNumBuckets = getMinBucketsToReserve(NumEntries);
+    incrementEpoch();
+    if (NewNumBuckets > NumBuckets)
+      resize(NewNumBuckets);
+  }
+
+  void clear() {
+    incrementEpoch();
+    if (NumEntries == 0 && GrowthLeft == maxLoad(NumBuckets))
+      return;
+    destroyAll();
+    if (NumBuckets)
+      std::memset(Ctrl, detail::SwissCtrlEmpty, NumBuckets + GroupWidth);
+    NumEntries = 0;
+    GrowthLeft = maxLoad(NumBuckets);
+  }
+
+  /// Return 1 if the specified key is in the map, 0 otherwise.
+  size_type count(const KeyT &Key) const {
+    return findBucket(Key) != NumBuckets ? 1 : 0;
+  }
+
+  iterator find(const KeyT &Key) { return makeIterator(findBucket(Key)); }
+  const_iterator find(const KeyT &Key) const {
+    return makeConstIterator(findBucket(Key));
+  }
+
+  /// Alternate version of find() which allows a different, and possibly
+  /// less expensive, key type.
+  /// The DenseMapInfo is responsible for supplying methods
+  /// getHashValue(LookupKeyT) and isEqual(LookupKeyT, KeyT) for each key
+  /// type used.
+  template <class LookupKeyT> iterator find_as(const LookupKeyT &Key) {
+    return makeIterator(findBucket(Key));
+  }
+  template <class LookupKeyT>
+  const_iterator find_as(const LookupKeyT &Key) const {
+    return makeConstIterator(findBucket(Key));
+  }
+
+  /// Return the entry for the specified key, or a default constructed value
+  /// if no such entry exists.
+  ValueT lookup(const KeyT &Key) const {
+    unsigned Idx = findBucket(Key);
+    if (Idx != NumBuckets)
+      return Buckets[Idx].getSecond();
+    return ValueT();
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // If the key is already in the map, it returns false and doesn't update the
+  // value.
+  std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+    return try_emplace(KV.first, KV.second);
+  }
+
+  std::pair<iterator, bool> insert(std::pair<KeyT, ValueT> &&KV) {
+    return try_emplace(std::move(KV.first), std::move(KV.second));
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // The value is constructed in-place if the key is not in the map, otherwise
+  // it is not moved.
+  template <typename... Ts>
+  std::pair<iterator, bool> try_emplace(KeyT &&Key, Ts &&... Args) {
+    unsigned Idx = findBucket(Key);
+    if (Idx != NumBuckets)
+      return std::make_pair(makeIterator(Idx), false);
+    Idx = prepareInsert(hashKey(Key));
+    ::new (&Buckets[Idx].getFirst()) KeyT(std::move(Key));
+    ::new (&Buckets[Idx].getSecond()) ValueT(std::forward<Ts>(Args)...);
+    return std::make_pair(makeIterator(Idx), true);
+  }
+
+  template <typename... Ts>
+  std::pair<iterator, bool> try_emplace(const KeyT &Key, Ts &&... Args) {
+    unsigned Idx = findBucket(Key);
+    if (Idx != NumBuckets)
+      return std::make_pair(makeIterator(Idx), false);
+    Idx = prepareInsert(hashKey(Key));
+    ::new (&Buckets[Idx].getFirst()) KeyT(Key);
+    ::new (&Buckets[Idx].getSecond()) ValueT(std::forward<Ts>(Args)...);
+    return std::make_pair(makeIterator(Idx), true);
+  }
+
+  value_type &FindAndConstruct(const KeyT &Key) {
+    return *try_emplace(Key).first;
+  }
+
+  value_type &FindAndConstruct(KeyT &&Key) {
+    return *try_emplace(std::move(Key)).first;
+  }
+
+  ValueT &operator[](const KeyT &Key) {
+    return try_emplace(Key).first->second;
+  }
+
+  ValueT &operator[](KeyT &&Key) {
+    return try_emplace(std::move(Key)).first->second;
+  }
+
+  bool erase(const KeyT &Key) {
+    unsigned Idx = findBucket(Key);
+    if (Idx == NumBuckets)
+      return false;
+    eraseBucket(Idx);
+    return true;
+  }
+
+  void erase(iterator I) {
+    assert(I != end() && "erasing the end iterator!");
+    eraseBucket(static_cast<unsigned>(&*I - Buckets));
+  }
+
+  /// Return the approximate size (in bytes) of the actual map.
+  /// This is just the raw memory used by the map; if entries point to
+  /// heap-allocated memory, that memory is not counted.
+  size_t getMemorySize() const {
+    if (!NumBuckets)
+      return 0;
+    return NumBuckets * sizeof(BucketT) + NumBuckets + GroupWidth;
+  }
+
+  /// Return true if the specified pointer points somewhere into the map's
+  /// array of buckets (i.e. either to a key or value in the map).
+  bool isPointerIntoBucketsArray(const void *Ptr) const {
+    return Ptr >= static_cast<const void *>(Buckets) &&
+           Ptr < static_cast<const void *>(Buckets + NumBuckets);
+  }
+
+  /// Return an opaque pointer into the buckets array. In conjunction with
+  /// the previous method, this can be used to determine whether an insertion
+  /// caused the map to reallocate.
+  const void *getPointerIntoBucketsArray() const { return Buckets; }
+
+private:
+  /// Keep at least one empty bucket in every probe sequence by never filling
+  /// more than seven eighths of the table.
+  static unsigned maxLoad(unsigned NumBuckets) {
+    return NumBuckets - NumBuckets / 8;
+  }
+
+  static unsigned getMinBucketsToReserve(unsigned NumEntries) {
+    if (NumEntries == 0)
+      return 0;
+    unsigned Buckets = static_cast<unsigned>(
+        NextPowerOf2(static_cast<uint64_t>(NumEntries) * 8 / 7));
+    return Buckets < GroupWidth ? GroupWidth : Buckets;
+  }
+
+  /// Mix the \c KeyInfoT hash. The weak pointer hashes map objects allocated
+  /// one after the other to consecutive values, which at this table's load
+  /// factor would fill long runs of buckets that every miss near them has to
+  /// probe past. The low half of the result picks the start of the probe
+  /// sequence, and the top seven bits go in the control byte.
+  template <typename LookupKeyT>
+  static uint64_t hashKey(const LookupKeyT &Key) {
+    uint64_t H = KeyInfoT::getHashValue(Key) * 0x9E3779B97F4A7C15ULL;
+    return H ^ (H >> 32);
+  }
+
+  static int8_t getH2(uint64_t Hash) { return static_cast<int8_t>(Hash >> 57); }
+
+  iterator makeIterator(unsigned Idx, bool NoAdvance = true) {
+    return iterator(Ctrl + Idx, Buckets + Idx, Buckets + NumBuckets, *this,
+                    NoAdvance);
+  }
+  const_iterator makeConstIterator(unsigned Idx, bool NoAdvance = true) const {
+    return const_iterator(Ctrl + Idx, Buckets + Idx, Buckets + NumBuckets,
+                          *this, NoAdvance);
+  }
+
+  /// Set the control byte of bucket \p Idx, keeping the copy of the first
+  /// group past the end of the table in sync so that groups starting near the
+  /// end can be loaded without wrapping around.
+  void setCtrl(unsigned Idx, int8_t V) {
+    Ctrl[Idx] = V;
+    if (Idx < GroupWidth)
+      Ctrl[NumBuckets + Idx] = V;
+  }
+
+  /// Return the bucket holding \p Key, or NumBuckets if there is none.
+  template <typename LookupKeyT>
+  unsigned findBucket(const LookupKeyT &Key) const {
+    if (!NumBuckets)
+      return 0;
+    uint64_t Hash = hashKey(Key);
+    int8_t H2 = getH2(Hash);
+    unsigned Mask = NumBuckets - 1;
+    unsigned Pos = static_cast<unsigned>(Hash) & Mask;
+    unsigned Stride = 0;
+    while (true) {
+      detail::SwissGroup G(Ctrl + Pos);
+      for (uint32_t M = G.match(H2); M; M &= M - 1) {
+        unsigned Idx = (Pos + countTrailingZeros(M)) & Mask;
+        if (LLVM_LIKELY(KeyInfoT::isEqual(Key, Buckets[Idx].getFirst())))
+          return Idx;
+      }
+      // An empty bucket ends the probe sequence: the key would have been
+      // inserted there.
+      if (G.matchEmpty())
+        return NumBuckets;
+      // Triangular probing over groups visits every group once because the
+      // number of buckets is a power of two.
+      Stride += GroupWidth;
+      Pos = (Pos + Stride) & Mask;
+    }
+  }
+
+  /// Return the first empty or deleted bucket in the probe sequence of
+  /// \p Hash. The table must not be full.
+  unsigned findNonFull(uint64_t Hash) const {
+    unsigned Mask = NumBuckets - 1;
+    unsigned Pos = static_cast<unsigned>(Hash) & Mask;
+    unsigned Stride = 0;
+    while (true) {
+      detail::SwissGroup G(Ctrl + Pos);
+      if (uint32_t M = G.matchEmptyOrDeleted())
+        return (Pos + countTrailingZeros(M)) & Mask;
+      Stride += GroupWidth;
+      Pos = (Pos + Stride) & Mask;
+    }
+  }
+
+  /// Claim a bucket for a new entry with the given hash, growing the table if
+  /// necessary. The caller constructs the entry.
+  unsigned prepareInsert(uint64_t Hash) {
+    incrementEpoch();
+    if (GrowthLeft == 0)
+      rehashAndGrowIfNeeded();
+    unsigned Idx = findNonFull(Hash);
+    if (Ctrl[Idx] == detail::SwissCtrlEmpty)
+      --GrowthLeft;
+    setCtrl(Idx, getH2(Hash));
+    ++NumEntries;
+    return Idx;
+  }
+
+  void rehashAndGrowIfNeeded() {
+    // If most of the used up growth went to deleted buckets, rehashing at the
+    // same size is enough to make room again.
+    if (NumBuckets && NumEntries < maxLoad(NumBuckets) / 2)
+      resize(NumBuckets);
+    else
+      resize(NumBuckets ? NumBuckets * 2 : GroupWidth);
+  }
+
+  void eraseBucket(unsigned Idx) {
+    incrementEpoch();
+    Buckets[Idx].getSecond().~ValueT();
+    Buckets[Idx].getFirst().~KeyT();
+    // Lookups for other keys may have probed past this bucket, so it can only
+    // become a tombstone.
+    setCtrl(Idx, detail::SwissCtrlDeleted);
+    --NumEntries;
+  }
+
+  void allocate(unsigned Num) {
+    NumBuckets = Num;
+    Ctrl = static_cast<int8_t *>(operator new(Num + GroupWidth));
+    Buckets = static_cast<BucketT *>(operator new(sizeof(BucketT) * Num));
+  }
+
+  void deallocate() {
+    operator delete(Ctrl);
+    operator delete(Buckets);
+    Ctrl = nullptr;
+    Buckets = nullptr;
+    NumBuckets = 0;
+  }
+
+  void destroyAll() {
+    if (!isPodLike<KeyT>::value || !isPodLike<ValueT>::value) {
+      for (unsigned I = 0; I != NumBuckets; ++I) {
+        if (Ctrl[I] < 0)
+          continue;
+        Buckets[I].getSecond().~ValueT();
+        Buckets[I].getFirst().~KeyT();
+      }
+    }
+  }
+
+  void resize(unsigned NewNumBuckets) {
+    assert(isPowerOf2_32(NewNumBuckets) && NewNumBuckets >= GroupWidth &&
+           "invalid number of buckets");
+    int8_t *OldCtrl = Ctrl;
+    BucketT *OldBuckets = Buckets;
+    unsigned OldNumBuckets = NumBuckets;
+
+    allocate(NewNumBuckets);
+    std::memset(Ctrl, detail::SwissCtrlEmpty, NumBuckets + GroupWidth);
+    GrowthLeft = maxLoad(NumBuckets) - NumEntries;
+
+    for (unsigned I = 0; I != OldNumBuckets; ++I) {
+      if (OldCtrl[I] < 0)
+        continue;
+      BucketT &B = OldBuckets[I];
+      uint64_t Hash = hashKey(B.getFirst());
+      unsigned Idx = findNonFull(Hash);
+      setCtrl(Idx, getH2(Hash));
+      ::new (&Buckets[Idx].getFirst()) KeyT(std::move(B.getFirst()));
+      ::new (&Buckets[Idx].getSecond()) ValueT(std::move(B.getSecond()));
+      B.getSecond().~ValueT();
+      B.getFirst().~KeyT();
+    }
+
+    operator delete(OldCtrl);
+    operator delete(OldBuckets);
+  }
+};
+
+template <typename KeyT, typename ValueT, typename KeyInfoT>
+static inline size_t
+capacity_in_bytes(const SwissTableMap<KeyT, ValueT, KeyInfoT> &X) {
+  return X.getMemorySize();
+}
+
+} // end namespace llvm
+
+#endif // LLVM_ADT_SWISSTABLEMAP_H
@@ -38,9 +38,13 @@
 #ifndef LLVM_ANALYSIS_ALIASANALYSIS_H
 #define LLVM_ANALYSIS_ALIASANALYSIS_H
 
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SwissTableMap.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/PassManager.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/Analysis/MemoryLocation.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 
@@ -179,6 +183,25 @@ public:
     AAs.emplace_back(new Model<AAResultT>(AAResult, *this));
   }
 
+  /// Handle invalidation events from the new pass manager.
+  ///
+  /// The aggregation, and with it the cached alias query results, stay valid
+  /// as long as \c AAManager is preserved. The cached results track the IR
+  /// they were computed from themselves.
+  bool invalidate(Function &F, const PreservedAnalyses &PA);
+
+  /// Drop all cached alias query results.
+  ///
+  /// With -aa-query-cache, results of \c alias queries are remembered along
+  /// with the address computations of the two pointers: the pointers, and the
+  /// GEPs, casts, phis and selects they are computed through. A result is
+  /// dropped once one of these values is deleted or replaced, or when its
+  /// operands no longer match. Results also depend on facts from elsewhere in
+  /// the function, such as whether an object escapes; a pass that changes
+  /// those while holding on to this object must call this before querying
+  /// again.
+  void clearQueryCache();
+
   //===--------------------------------------------------------------------===//
   /// \name Alias Queries
   /// @{
@@ -571,6 +594,30 @@ private:
   const TargetLibraryInfo &TLI;
 
   std::vector<std::unique_ptr<Concept>> AAs;
+
+  /// Clears the query cache when a value in the address computation of a
+  /// cached pointer is deleted or replaced, so that neither a changed address
+  /// nor a new value allocated at the same address can hit a stale entry.
+  class QueryCacheVH final : public CallbackVH {
+    AAResults *AAR;
+    void deleted() override;
+    void allUsesReplacedWith(Value *) override;
+
+  public:
+    QueryCacheVH(Value *V, AAResults *AAR) : CallbackVH(V), AAR(AAR) {}
+  };
+
+  typedef std::pair<MemoryLocation, MemoryLocation> LocPair;
+  typedef SmallVector<const Value *, 8> AddressChain;
+  SwissTableMap<LocPair, AliasResult> QueryCache;
+  /// The address computation of each pointer in a cached query, as it was
+  /// when the pointer was first cached.
+  DenseMap<const Value *, AddressChain> QueryCacheChains;
+  DenseSet<const Value *> QueryCacheValues;
+  std::vector<std::unique_ptr<QueryCacheVH>> QueryCacheHandles;
+
+  bool trackQueryCachePointer(const Value *Ptr);
+  bool isQueryCachePointerUnchanged(const Value *Ptr);
 };
 
 /// Temporary typedef for legacy code that uses a generic \c AliasAnalysis
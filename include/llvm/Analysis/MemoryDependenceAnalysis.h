@@ -344,11 +344,33 @@ private:
   DominatorTree &DT;
   PredIteratorCache PredCache;
 
+  /// The number of instructions scanned by all queries so far.
+  uint64_t NumInstsScanned;
+
+  /// Once NumInstsScanned reaches this, queries give up with an unknown
+  /// result. Zero means no limit.
+  uint64_t ScanLimit;
+
 public:
   MemoryDependenceResults(AliasAnalysis &AA, AssumptionCache &AC,
                           const TargetLibraryInfo &TLI,
                           DominatorTree &DT)
-      : AA(AA), AC(AC), TLI(TLI), DT(DT) {}
+      : AA(AA), AC(AC), TLI(TLI), DT(DT), NumInstsScanned(0), ScanLimit(0) {}
+
+  /// Return the number of instructions scanned by the queries so far. Clients
+  /// can compare it against a budget to bound the work they ask for.
+  uint64_t getNumInstsScanned() const { return NumInstsScanned; }
+
+  /// Make the queries stop scanning and return an unknown result once
+  /// getNumInstsScanned() reaches \p Limit, so that a single query cannot
+  /// overrun a client's budget. Zero removes the limit.
+  void setScanLimit(uint64_t Limit) { ScanLimit = Limit; }
+
+  /// Return true if the scan limit was reached, in which case some cached
+  /// results are unknown only because of the limit.
+  bool reachedScanLimit() const {
+    return ScanLimit && NumInstsScanned >= ScanLimit;
+  }
 
   /// Returns the instruction on which a memory operation depends.
   ///
@@ -443,7 +465,7 @@ public:
                                                   unsigned MemLocSize,
                                                   const LoadInst *LI);
 
-  /// Release memory in caches.
+  /// Release memory in caches, dropping every cached result.
   void releaseMemory();
 
 private:
@@ -24,6 +24,7 @@
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SwissTableMap.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/IR/ConstantRange.h"
 #include "llvm/IR/Instructions.h"
@@ -503,7 +504,7 @@ namespace llvm {
 
     /// The typedef for ValueExprMap.
     ///
-    typedef DenseMap<SCEVCallbackVH, const SCEV *, DenseMapInfo<Value *> >
+    typedef SwissTableMap<SCEVCallbackVH, const SCEV *, DenseMapInfo<Value *>>
       ValueExprMapType;
 
     /// This is a cache of the values we have analyzed so far.
@@ -752,6 +753,11 @@ namespace llvm {
       /// subexpression.
       bool hasOperand(const SCEV *S, ScalarEvolution *SE) const;
 
+      /// Return true if any backedge taken count expressions refer to one of
+      /// the subexpressions in \p Ops.
+      bool hasAnyOperand(const SmallPtrSetImpl<const SCEV *> &Ops,
+                         ScalarEvolution *SE) const;
+
       /// Invalidate this result and free associated memory.
       void clear();
     };
@@ -803,11 +809,13 @@ namespace llvm {
     /// Compute a BlockDisposition value.
     BlockDisposition computeBlockDisposition(const SCEV *S, const BasicBlock *BB);
 
+    typedef SwissTableMap<const SCEV *, ConstantRange> RangeMapType;
+
     /// Memoized results from getRange
-    DenseMap<const SCEV *, ConstantRange> UnsignedRanges;
+    RangeMapType UnsignedRanges;
 
     /// Memoized results from getRange
-    DenseMap<const SCEV *, ConstantRange> SignedRanges;
+    RangeMapType SignedRanges;
 
     /// Used to parameterize getRange
     enum RangeSignHint { HINT_RANGE_UNSIGNED, HINT_RANGE_SIGNED };
@@ -815,7 +823,7 @@ namespace llvm {
     /// Set the memoized range for the given SCEV.
     const ConstantRange &setRange(const SCEV *S, RangeSignHint Hint,
                                   const ConstantRange &CR) {
-      DenseMap<const SCEV *, ConstantRange> &Cache =
+      RangeMapType &Cache =
           Hint == HINT_RANGE_UNSIGNED ? UnsignedRanges : SignedRanges;
 
       auto Pair = Cache.insert({S, CR});
@@ -1092,6 +1100,10 @@ namespace llvm {
     /// Drop memoized information computed for S.
     void forgetMemoizedResults(const SCEV *S);
 
+    /// Drop memoized information computed for all of \p SCEVs. The
+    /// backedge-taken counts are scanned once for the whole batch.
+    void forgetMemoizedResults(ArrayRef<const SCEV *> SCEVs);
+
     /// Return an existing SCEV for V if there is one, otherwise return nullptr.
     const SCEV *getExistingSCEV(Value *V);
 
@@ -1201,29 +1213,40 @@ namespace llvm {
     const SCEV *getZeroExtendExpr(const SCEV *Op, Type *Ty);
     const SCEV *getSignExtendExpr(const SCEV *Op, Type *Ty);
     const SCEV *getAnyExtendExpr(const SCEV *Op, Type *Ty);
+    /// Get a canonical add expression, or something simpler if possible.
+    /// \p Depth is the recursion depth of the simplification; past the
+    /// complexity budget the operands are combined without simplification.
     const SCEV *getAddExpr(SmallVectorImpl<const SCEV *> &Ops,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap);
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0);
     const SCEV *getAddExpr(const SCEV *LHS, const SCEV *RHS,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap) {
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0) {
       SmallVector<const SCEV *, 2> Ops = {LHS, RHS};
-      return getAddExpr(Ops, Flags);
+      return getAddExpr(Ops, Flags, Depth);
     }
     const SCEV *getAddExpr(const SCEV *Op0, const SCEV *Op1, const SCEV *Op2,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap) {
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0) {
       SmallVector<const SCEV *, 3> Ops = {Op0, Op1, Op2};
-      return getAddExpr(Ops, Flags);
+      return getAddExpr(Ops, Flags, Depth);
     }
+    /// Get a canonical multiply expression, or something simpler if possible.
+    /// \p Depth is handled as for getAddExpr.
     const SCEV *getMulExpr(SmallVectorImpl<const SCEV *> &Ops,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap);
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0);
     const SCEV *getMulExpr(const SCEV *LHS, const SCEV *RHS,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap) {
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0) {
       SmallVector<const SCEV *, 2> Ops = {LHS, RHS};
-      return getMulExpr(Ops, Flags);
+      return getMulExpr(Ops, Flags, Depth);
     }
     const SCEV *getMulExpr(const SCEV *Op0, const SCEV *Op1, const SCEV *Op2,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap) {
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0) {
       SmallVector<const SCEV *, 3> Ops = {Op0, Op1, Op2};
-      return getMulExpr(Ops, Flags);
+      return getMulExpr(Ops, Flags, Depth);
     }
     const SCEV *getUDivExpr(const SCEV *LHS, const SCEV *RHS);
     const SCEV *getUDivExactExpr(const SCEV *LHS, const SCEV *RHS);
@@ -1278,8 +1301,10 @@ namespace llvm {
     const SCEV *getNotSCEV(const SCEV *V);
 
     /// Return LHS-RHS.  Minus is represented in SCEV as A+B*-1.
+    /// \p Depth is handled as for getAddExpr.
     const SCEV *getMinusSCEV(const SCEV *LHS, const SCEV *RHS,
-                             SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap);
+                             SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                             unsigned Depth = 0);
 
     /// Return a SCEV corresponding to a conversion of the input value to the
     /// specified type.  If the type must be extended, it is zero extended.
@@ -1539,6 +1564,9 @@ namespace llvm {
     void print(raw_ostream &OS) const;
     void verify() const;
 
+    /// Print the number of entries in each of the caches of this analysis.
+    void printCacheStats(raw_ostream &OS) const;
+
     /// Collect parametric terms occurring in step expressions (first step of
     /// delinearization).
     void collectParametricTerms(const SCEV *Expr,
@@ -1644,6 +1672,14 @@ namespace llvm {
                                       SCEVUnionPredicate &Preds);
 
   private:
+    /// Find or create the add expression of the simplified \p Ops.
+    const SCEV *getOrCreateAddExpr(SmallVectorImpl<const SCEV *> &Ops,
+                                   SCEV::NoWrapFlags Flags);
+
+    /// Find or create the multiply expression of the simplified \p Ops.
+    const SCEV *getOrCreateMulExpr(SmallVectorImpl<const SCEV *> &Ops,
+                                   SCEV::NoWrapFlags Flags);
+
     /// Compute the backedge taken count knowing the interval difference, the
     /// stride and presence of the equality in the comparison.
     const SCEV *computeBECount(const SCEV *Delta, const SCEV *Stride,
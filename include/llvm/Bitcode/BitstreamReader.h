@@ -43,6 +43,11 @@ public:
 private:
   std::unique_ptr<MemoryObject> BitcodeBytes;
 
+  /// If the bitcode is entirely in memory, these are its bytes. Cursors read
+  /// words straight out of them instead of through BitcodeBytes.
+  const uint8_t *BufferStart = nullptr;
+  size_t BufferSize = 0;
+
   std::vector<BlockInfo> BlockInfoRecords;
 
   /// This is set to true if we don't care about the block/record name
@@ -69,6 +74,8 @@ public:
 
   BitstreamReader &operator=(BitstreamReader &&Other) {
     BitcodeBytes = std::move(Other.BitcodeBytes);
+    BufferStart = Other.BufferStart;
+    BufferSize = Other.BufferSize;
     // Explicitly swap block info, so that nothing gets destroyed twice.
     std::swap(BlockInfoRecords, Other.BlockInfoRecords);
     IgnoreBlockInfoNames = Other.IgnoreBlockInfoNames;
@@ -78,10 +85,17 @@ public:
   void init(const unsigned char *Start, const unsigned char *End) {
     assert(((End-Start) & 3) == 0 &&"Bitcode stream not a multiple of 4 bytes");
     BitcodeBytes.reset(getNonStreamedMemoryObject(Start, End));
+    BufferStart = Start;
+    BufferSize = End - Start;
   }
 
   MemoryObject &getBitcodeBytes() { return *BitcodeBytes; }
 
+  /// Return the start of the bitcode if it is entirely in memory, or null if
+  /// it is being streamed.
+  const uint8_t *getBufferStart() const { return BufferStart; }
+  size_t getBufferSize() const { return BufferSize; }
+
   /// This is called by clients that want block/record name information.
   void CollectBlockInfoNames() { IgnoreBlockInfoNames = false; }
   bool isIgnoringBlockInfoNames() { return IgnoreBlockInfoNames; }
@@ -238,6 +252,19 @@ public:
     if (Size != 0 && NextChar >= Size)
       report_fatal_error("Unexpected end of file");
 
+    // Load whole words straight out of an in-memory buffer. Only the tail of
+    // the buffer and streamed bitcode go through the MemoryObject.
+    if (const uint8_t *Buffer = R->getBufferStart()) {
+      if (NextChar + sizeof(word_t) <= R->getBufferSize()) {
+        CurWord =
+            support::endian::read<word_t, support::little, support::unaligned>(
+                Buffer + NextChar);
+        NextChar += sizeof(word_t);
+        BitsInCurWord = sizeof(word_t) * 8;
+        return;
+      }
+    }
+
     // Read the next word from the stream.
     uint8_t Array[sizeof(word_t)] = {0};
 
@@ -304,17 +331,7 @@ public:
     if ((Piece & (1U << (NumBits-1))) == 0)
       return Piece;
 
-    uint32_t Result = 0;
-    unsigned NextBit = 0;
-    while (1) {
-      Result |= (Piece & ((1U << (NumBits-1))-1)) << NextBit;
-
-      if ((Piece & (1U << (NumBits-1))) == 0)
-        return Result;
-
-      NextBit += NumBits-1;
-      Piece = Read(NumBits);
-    }
+    return uint32_t(readVBRTail(Piece, NumBits));
   }
 
   // Read a VBR that may have a value up to 64-bits in size. The chunk size of
@@ -324,19 +341,53 @@ public:
     if ((Piece & (1U << (NumBits-1))) == 0)
       return uint64_t(Piece);
 
-    uint64_t Result = 0;
-    unsigned NextBit = 0;
-    while (1) {
-      Result |= uint64_t(Piece & ((1U << (NumBits-1))-1)) << NextBit;
+    return readVBRTail(Piece, NumBits);
+  }
 
-      if ((Piece & (1U << (NumBits-1))) == 0)
+private:
+  /// Finish reading a VBR whose first chunk, \p Piece, has its continuation
+  /// bit set.
+  ///
+  /// Chunks are peeled off a local copy of CurWord, which keeps the cursor
+  /// state in registers for the common case where the whole value is in the
+  /// current word. Only a value straddling two words goes through Read().
+  uint64_t readVBRTail(uint32_t Piece, unsigned NumBits) {
+    static const unsigned Mask = sizeof(word_t) > 4 ? 0x3f : 0x1f;
+    const uint32_t ContinueBit = 1U << (NumBits - 1);
+    const word_t ChunkMask = ~word_t(0) >> (MaxChunkSize - NumBits);
+
+    uint64_t Result = Piece & (ContinueBit - 1);
+    unsigned NextBit = NumBits - 1;
+    word_t Word = CurWord;
+    unsigned Bits = BitsInCurWord;
+    while (Bits >= NumBits) {
+      Piece = uint32_t(Word & ChunkMask);
+      Word >>= (NumBits & Mask);
+      Bits -= NumBits;
+      Result |= uint64_t(Piece & (ContinueBit - 1)) << NextBit;
+      if ((Piece & ContinueBit) == 0) {
+        CurWord = Word;
+        BitsInCurWord = Bits;
         return Result;
+      }
+      NextBit += NumBits - 1;
+    }
+    CurWord = Word;
+    BitsInCurWord = Bits;
 
-      NextBit += NumBits-1;
+    while (1) {
       Piece = Read(NumBits);
+      Result |= uint64_t(Piece & (ContinueBit - 1)) << NextBit;
+
+      if ((Piece & ContinueBit) == 0)
+        return Result;
+
+      NextBit += NumBits - 1;
     }
   }
 
+public:
+
   void SkipToFourByteBoundary() {
     // If word_t is 64-bits and if we've read less than 32 bits, just dump
     // the bits we have up to the next 32-bit boundary.
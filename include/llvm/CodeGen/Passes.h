@@ -275,9 +275,11 @@ namespace llvm {
   FunctionPass *createStackProtectorPass(const TargetMachine *TM);
 
   /// createMachineVerifierPass - This pass verifies cenerated machine code
-  /// instructions for correctness.
+  /// instructions for correctness. With \p Quick set, only the structural
+  /// checks are run and the liveness checks are skipped.
   ///
-  FunctionPass *createMachineVerifierPass(const std::string& Banner);
+  FunctionPass *createMachineVerifierPass(const std::string& Banner,
+                                          bool Quick = false);
 
   /// createDwarfEHPass - This pass mulches exception handling code into a form
   /// adapted to code generation.  Required if using dwarf exception handling.
@@ -564,6 +564,11 @@ namespace llvm {
 
     virtual void unscheduledNode(SUnit *) {}
 
+    /// changedEdges - Invoked when an edge to or from the given node is added
+    /// or removed during scheduling. Queues that cache a node's priority while
+    /// it is queued can refresh it here.
+    virtual void changedEdges(SUnit *) {}
+
     void setCurCycle(unsigned Cycle) {
       CurCycle = Cycle;
     }
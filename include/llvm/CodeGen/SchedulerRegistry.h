@@ -67,6 +67,13 @@ ScheduleDAGSDNodes *createBURRListDAGScheduler(SelectionDAGISel *IS,
 ScheduleDAGSDNodes *createSourceListDAGScheduler(SelectionDAGISel *IS,
                                                  CodeGenOpt::Level OptLevel);
 
+/// createHeapListDAGScheduler - This creates a bottom up list scheduler that
+/// schedules nodes in source code order using a heap ordered ready queue with
+/// priorities computed once per node. It trades the dynamic register pressure
+/// and latency heuristics for O(N log N) scheduling of very large blocks.
+ScheduleDAGSDNodes *createHeapListDAGScheduler(SelectionDAGISel *IS,
+                                               CodeGenOpt::Level OptLevel);
+
 /// createHybridListDAGScheduler - This creates a bottom up register pressure
 /// aware list scheduler that make use of latency information to avoid stalls
 /// for long latency instructions in low register pressure mode. In high
@@ -0,0 +1,183 @@
+//===-- llvm/IR/MappedSummaryIndex.h - Mappable summary index ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+/// \file
+/// This file declares a flat binary encoding of a combined module summary
+/// index that can be memory mapped and queried in place. Distributed ThinLTO
+/// backends only need the summaries reachable from the module they compile,
+/// and with the bitcode encoding every backend parses the whole index first.
+///
+/// The file starts with a header followed by fixed size, little endian
+/// tables:
+///
+///   Header
+///   ModuleEntry[NumModules]      sorted by module path
+///   SummaryEntry[NumSummaries]   sorted by GUID, then module
+///   ulittle32_t[NumSummaries]    summary numbers grouped by module
+///   RefEntry[NumRefs]            GUIDs of the referenced values
+///   CallEntry[NumCalls]
+///   char[StringTableSize]        module paths
+///
+/// Summaries refer to their module by index in the module table and to their
+/// edges by ranges in the ref and call tables, and modules to their summaries
+/// by a range in the per-module summary table, so a lookup by GUID or module
+/// path is a binary search over the mapped buffer.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_MAPPEDSUMMARYINDEX_H
+#define LLVM_IR_MAPPEDSUMMARYINDEX_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/ModuleSummaryIndex.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace llvm {
+class raw_ostream;
+
+class MappedSummaryIndex {
+public:
+  typedef support::ulittle32_t ulittle32_t;
+  typedef support::ulittle64_t ulittle64_t;
+
+  static const char Magic[8];
+  enum { Version = 2 };
+
+  struct Header {
+    char Magic[8];
+    ulittle32_t Version;
+    ulittle32_t NumModules;
+    ulittle32_t NumSummaries;
+    ulittle32_t NumRefs;
+    ulittle32_t NumCalls;
+    ulittle32_t StringTableSize;
+    /// The highest profile count of a call edge in the whole index, so that
+    /// importing from the part of the index a module needs classifies the
+    /// edges as hot or cold the same way as the thin link.
+    ulittle64_t MaxProfileCount;
+  };
+
+  struct ModuleEntry {
+    ulittle32_t PathOffset;
+    ulittle32_t PathSize;
+    ulittle64_t ModuleId;
+    ulittle32_t Hash[5];
+    ulittle32_t SummariesBegin;
+    ulittle32_t NumSummaries;
+  };
+
+  struct SummaryEntry {
+    ulittle64_t GUID;
+    ulittle64_t OriginalName;
+    /// GUID of the aliasee for an alias, which is defined in the same module.
+    ulittle64_t AliaseeGUID;
+    ulittle32_t Module;
+    uint8_t Kind;
+    uint8_t Linkage;
+    uint8_t HasSection;
+    uint8_t Reserved;
+    ulittle32_t InstCount;
+    ulittle32_t RefsBegin;
+    ulittle32_t NumRefs;
+    ulittle32_t CallsBegin;
+    ulittle32_t NumCalls;
+  };
+
+  typedef ulittle64_t RefEntry;
+
+  struct CallEntry {
+    ulittle64_t Callee;
+    ulittle64_t ProfileCount;
+    ulittle32_t CallsiteCount;
+  };
+
+private:
+  std::unique_ptr<MemoryBuffer> OwnedBuffer;
+  ArrayRef<ModuleEntry> Modules;
+  ArrayRef<SummaryEntry> Summaries;
+  ArrayRef<ulittle32_t> ModuleSummaries;
+  ArrayRef<RefEntry> Refs;
+  ArrayRef<CallEntry> Calls;
+  StringRef Strings;
+  uint64_t MaxProfileCount = 0;
+
+  MappedSummaryIndex() = default;
+
+  std::unique_ptr<ModuleSummaryIndex>
+  buildIndex(ArrayRef<const SummaryEntry *> Selected) const;
+
+public:
+  /// Return true if \p Buffer starts with the mapped summary index magic.
+  static bool isMappedSummaryIndex(MemoryBufferRef Buffer);
+
+  /// Validate the tables of \p Buffer and create an index querying it in
+  /// place. The buffer must outlive the index.
+  static Expected<std::unique_ptr<MappedSummaryIndex>>
+  create(MemoryBufferRef Buffer);
+
+  /// Map the file at \p Path and create an index owning the mapping.
+  static Expected<std::unique_ptr<MappedSummaryIndex>>
+  createFromFile(StringRef Path);
+
+  ArrayRef<ModuleEntry> modules() const { return Modules; }
+  ArrayRef<SummaryEntry> summaries() const { return Summaries; }
+  uint64_t getMaxProfileCount() const { return MaxProfileCount; }
+
+  StringRef getModulePath(const ModuleEntry &M) const {
+    return Strings.substr(M.PathOffset, M.PathSize);
+  }
+  const ModuleEntry &getModule(const SummaryEntry &S) const {
+    return Modules[S.Module];
+  }
+  ModuleHash getModuleHash(const ModuleEntry &M) const;
+
+  /// Return the numbers of the summaries defined in module \p M.
+  ArrayRef<ulittle32_t> moduleSummaries(const ModuleEntry &M) const {
+    return ModuleSummaries.slice(M.SummariesBegin, M.NumSummaries);
+  }
+
+  /// Return the entry for the module at \p Path, or null if there is none.
+  const ModuleEntry *findModule(StringRef Path) const;
+
+  /// Return the summaries for \p GUID, one per defining module.
+  ArrayRef<SummaryEntry> findSummaries(GlobalValue::GUID GUID) const;
+
+  /// Return the summary for \p GUID defined in the module at \p ModulePath,
+  /// or null if there is none.
+  const SummaryEntry *findSummaryInModule(GlobalValue::GUID GUID,
+                                          StringRef ModulePath) const;
+
+  ArrayRef<RefEntry> refs(const SummaryEntry &S) const {
+    return Refs.slice(S.RefsBegin, S.NumRefs);
+  }
+  ArrayRef<CallEntry> calls(const SummaryEntry &S) const {
+    return Calls.slice(S.CallsBegin, S.NumCalls);
+  }
+
+  /// Build a ModuleSummaryIndex holding every summary of this index.
+  std::unique_ptr<ModuleSummaryIndex> materialize() const;
+
+  /// Build a ModuleSummaryIndex holding what importing into \p ModulePath can
+  /// look at: the summaries defined in that module, and those of the values
+  /// transitively called from them and referenced along the way. All module
+  /// paths are kept.
+  std::unique_ptr<ModuleSummaryIndex>
+  materializeForModule(StringRef ModulePath) const;
+};
+
+/// Write the combined index \p Index to \p OS in the mapped summary index
+/// format.
+void writeMappedSummaryIndex(const ModuleSummaryIndex &Index, raw_ostream &OS);
+
+} // End llvm namespace
+
+#endif
@@ -16,6 +16,7 @@
 #ifndef LLVM_IR_MODULESUMMARYINDEX_H
 #define LLVM_IR_MODULESUMMARYINDEX_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
@@ -23,6 +24,7 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/Allocator.h"
 
 #include <array>
 
@@ -135,7 +137,12 @@ private:
   /// (either by the initializer of a global variable, or referenced
   /// from within a function). This does not include functions called, which
   /// are listed in the derived FunctionSummary object.
+  ///
+  /// The edges are accumulated in RefEdgeList while the summary is built, and
+  /// moved into the edge allocator of the index by flattenEdges() once the
+  /// summary is added to one, after which Refs points to them.
   std::vector<ValueInfo> RefEdgeList;
+  ArrayRef<ValueInfo> Refs;
 
 protected:
   /// GlobalValueSummary constructor.
@@ -184,11 +191,17 @@ public:
 
   /// Record a reference from this global value to the global value identified
   /// by \p RefGUID.
-  void addRefEdge(GlobalValue::GUID RefGUID) { RefEdgeList.push_back(RefGUID); }
+  void addRefEdge(GlobalValue::GUID RefGUID) {
+    assert(Refs.empty() && "Summary edges were already flattened");
+    RefEdgeList.push_back(RefGUID);
+  }
 
   /// Record a reference from this global value to the global value identified
   /// by \p RefV.
-  void addRefEdge(const Value *RefV) { RefEdgeList.push_back(RefV); }
+  void addRefEdge(const Value *RefV) {
+    assert(Refs.empty() && "Summary edges were already flattened");
+    RefEdgeList.push_back(RefV);
+  }
 
   /// Record a reference from this global value to each global value identified
   /// in \p RefEdges.
@@ -198,8 +211,15 @@ public:
   }
 
   /// Return the list of values referenced by this global value definition.
-  std::vector<ValueInfo> &refs() { return RefEdgeList; }
-  const std::vector<ValueInfo> &refs() const { return RefEdgeList; }
+  ArrayRef<ValueInfo> refs() const {
+    return RefEdgeList.empty() ? Refs : makeArrayRef(RefEdgeList);
+  }
+
+  /// Move the edges of this summary into \p Alloc, so that the edges of all
+  /// the summaries of an index are packed together instead of each list
+  /// having its own, partly unused, heap buffer. No edges may be added
+  /// afterwards. Called when the summary is added to an index.
+  void flattenEdges(BumpPtrAllocator &Alloc);
 };
 
 /// \brief Alias summary information.
@@ -239,8 +259,13 @@ private:
   /// during the initial compile step when the summary index is first built.
   unsigned InstCount;
 
-  /// List of <CalleeValueInfo, CalleeInfo> call edge pairs from this function.
+  /// List of <CalleeValueInfo, CalleeInfo> call edge pairs from this function,
+  /// accumulated in CallGraphEdgeList and then flattened into Calls like the
+  /// reference edges.
   std::vector<EdgeTy> CallGraphEdgeList;
+  ArrayRef<EdgeTy> Calls;
+
+  friend class GlobalValueSummary;
 
 public:
   /// Summary constructors.
@@ -259,6 +284,7 @@ public:
   /// by \p CalleeGUID, with \p CalleeInfo including the cumulative profile
   /// count (across all calls from this function) or 0 if no PGO.
   void addCallGraphEdge(GlobalValue::GUID CalleeGUID, CalleeInfo Info) {
+    assert(Calls.empty() && "Summary edges were already flattened");
     CallGraphEdgeList.push_back(std::make_pair(CalleeGUID, Info));
   }
 
@@ -274,6 +300,7 @@ public:
   /// by \p CalleeV, with \p CalleeInfo including the cumulative profile
   /// count (across all calls from this function) or 0 if no PGO.
   void addCallGraphEdge(const Value *CalleeV, CalleeInfo Info) {
+    assert(Calls.empty() && "Summary edges were already flattened");
     CallGraphEdgeList.push_back(std::make_pair(CalleeV, Info));
   }
 
@@ -285,8 +312,9 @@ public:
   }
 
   /// Return the list of <CalleeValueInfo, CalleeInfo> pairs.
-  std::vector<EdgeTy> &calls() { return CallGraphEdgeList; }
-  const std::vector<EdgeTy> &calls() const { return CallGraphEdgeList; }
+  ArrayRef<EdgeTy> calls() const {
+    return CallGraphEdgeList.empty() ? Calls : makeArrayRef(CallGraphEdgeList);
+  }
 };
 
 /// \brief Global variable summary information to aid decisions and
@@ -316,12 +344,91 @@ typedef std::array<uint32_t, 5> ModuleHash;
 typedef std::vector<std::unique_ptr<GlobalValueSummary>> GlobalValueSummaryList;
 
 /// Map from global value GUID to corresponding summary structures.
-/// Use a std::map rather than a DenseMap since it will likely incur
-/// less overhead, as the value type is not very small and the size
-/// of the map is unknown, resulting in inefficiencies due to repeated
-/// insertions and resizing.
-typedef std::map<GlobalValue::GUID, GlobalValueSummaryList>
-    GlobalValueSummaryMapTy;
+///
+/// The entries live in a single vector instead of one heap node each, with a
+/// DenseMap from GUID to position for lookups. Iteration is in increasing GUID
+/// order, like the std::map this replaces: entries are appended as they are
+/// created, and finalize() sorts them once the map is built. Iterating through
+/// a non-const map finalizes it; iterating through a const map requires that
+/// it was finalized, so that concurrent readers never sort.
+///
+/// Unlike with a std::map, inserting a new GUID invalidates references and
+/// iterators to all entries, so a map must not be inserted into while it is
+/// iterated.
+class GlobalValueSummaryMapTy {
+public:
+  typedef std::pair<GlobalValue::GUID, GlobalValueSummaryList> value_type;
+  typedef std::vector<value_type>::iterator iterator;
+  typedef std::vector<value_type>::const_iterator const_iterator;
+
+private:
+  std::vector<value_type> Entries;
+  DenseMap<GlobalValue::GUID, unsigned> Positions;
+  bool IsSorted = true;
+
+public:
+  /// Sort the entries by GUID, if an entry was added out of order.
+  void finalize() {
+    if (IsSorted)
+      return;
+    std::sort(Entries.begin(), Entries.end(),
+              [](const value_type &A, const value_type &B) {
+                return A.first < B.first;
+              });
+    for (unsigned I = 0, E = Entries.size(); I != E; ++I)
+      Positions[Entries[I].first] = I;
+    IsSorted = true;
+  }
+
+  bool isFinalized() const { return IsSorted; }
+
+  iterator begin() {
+    finalize();
+    return Entries.begin();
+  }
+  const_iterator begin() const {
+    assert(IsSorted && "Iterating a summary map that was not finalized");
+    return Entries.begin();
+  }
+  iterator end() { return Entries.end(); }
+  const_iterator end() const { return Entries.end(); }
+
+  size_t size() const { return Entries.size(); }
+  bool empty() const { return Entries.empty(); }
+
+  iterator find(GlobalValue::GUID GUID) {
+    auto I = Positions.find(GUID);
+    return I == Positions.end() ? end() : Entries.begin() + I->second;
+  }
+  const_iterator find(GlobalValue::GUID GUID) const {
+    auto I = Positions.find(GUID);
+    return I == Positions.end() ? end() : Entries.begin() + I->second;
+  }
+
+  GlobalValueSummaryList &operator[](GlobalValue::GUID GUID) {
+    auto Ins = Positions.insert(std::make_pair(GUID, Entries.size()));
+    if (Ins.second) {
+      if (!Entries.empty() && Entries.back().first > GUID)
+        IsSorted = false;
+      Entries.push_back(value_type(GUID, GlobalValueSummaryList()));
+    }
+    return Entries[Ins.first->second].second;
+  }
+
+  /// Remove the entries for which \p Pred returns true.
+  template <typename PredTy> void remove_if(PredTy Pred) {
+    Entries.erase(std::remove_if(Entries.begin(), Entries.end(), Pred),
+                  Entries.end());
+    Positions.clear();
+    for (unsigned I = 0, E = Entries.size(); I != E; ++I)
+      Positions[Entries[I].first] = I;
+  }
+
+  void reserve(size_t Size) {
+    Entries.reserve(Size);
+    Positions.reserve(Size);
+  }
+};
 
 /// Type used for iterating through the global value summary map.
 typedef GlobalValueSummaryMapTy::const_iterator const_gvsummary_iterator;
@@ -347,6 +454,12 @@ private:
   /// Holds strings for combined index, mapping to the corresponding module ID.
   ModulePathStringTableTy ModulePathStringTable;
 
+  /// Holds the ref and call edges of the summaries in this index, see
+  /// GlobalValueSummary::flattenEdges(). Indexes merged into this one hand
+  /// over their allocator, since their summaries now belong to this index.
+  BumpPtrAllocator EdgeAllocator;
+  std::vector<std::unique_ptr<BumpPtrAllocator>> MergedEdgeAllocators;
+
 public:
   ModuleSummaryIndex() = default;
 
@@ -380,13 +493,13 @@ public:
   /// Add a global value summary for a value of the given name.
   void addGlobalValueSummary(StringRef ValueName,
                              std::unique_ptr<GlobalValueSummary> Summary) {
-    GlobalValueMap[GlobalValue::getGUID(ValueName)].push_back(
-        std::move(Summary));
+    addGlobalValueSummary(GlobalValue::getGUID(ValueName), std::move(Summary));
   }
 
   /// Add a global value summary for a value of the given GUID.
   void addGlobalValueSummary(GlobalValue::GUID ValueGUID,
                              std::unique_ptr<GlobalValueSummary> Summary) {
+    Summary->flattenEdges(EdgeAllocator);
     GlobalValueMap[ValueGUID].push_back(std::move(Summary));
   }
 
@@ -452,6 +565,11 @@ public:
   void mergeFrom(std::unique_ptr<ModuleSummaryIndex> Other,
                  uint64_t NextModuleId);
 
+  /// Sort the summaries by GUID once the index is built, e.g. after the last
+  /// mergeFrom(). A const index can only be iterated once finalized.
+  void finalize() { GlobalValueMap.finalize(); }
+  bool isFinalized() const { return GlobalValueMap.isFinalized(); }
+
   /// Convenience method for creating a promoted global name
   /// for the given value name of a local, and its original module's ID.
   static std::string getGlobalNameForLocal(StringRef Name, ModuleHash ModHash) {
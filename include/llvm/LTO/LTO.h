@@ -56,19 +56,28 @@ public:
 ///
 /// This is done for correctness (if value exported, ensure we always
 /// emit a copy), and compile-time optimization (allow drop of duplicates).
+///
+/// With a \p ThreadCount greater than one the index is processed on that many
+/// threads, and \p isPrevailing must be safe to call concurrently.
+/// \p recordNewLinkage is always called on the calling thread.
 void thinLTOResolveWeakForLinkerInIndex(
     ModuleSummaryIndex &Index,
     function_ref<bool(GlobalValue::GUID, const GlobalValueSummary *)>
         isPrevailing,
     function_ref<void(StringRef, GlobalValue::GUID, GlobalValue::LinkageTypes)>
-        recordNewLinkage);
+        recordNewLinkage,
+    unsigned ThreadCount = 1);
 
 /// Update the linkages in the given \p Index to mark exported values
 /// as external and non-exported values as internal. The ThinLTO backends
 /// must apply the changes to the Module via thinLTOInternalizeModule.
+///
+/// With a \p ThreadCount greater than one the index is processed on that many
+/// threads, and \p isExported must be safe to call concurrently.
 void thinLTOInternalizeAndPromoteInIndex(
     ModuleSummaryIndex &Index,
-    function_ref<bool(StringRef, GlobalValue::GUID)> isExported);
+    function_ref<bool(StringRef, GlobalValue::GUID)> isExported,
+    unsigned ThreadCount = 1);
 }
 
 #endif
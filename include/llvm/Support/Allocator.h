@@ -190,12 +190,12 @@ public:
     // Deallocate all but the first slab, and deallocate all custom-sized slabs.
     DeallocateCustomSizedSlabs();
     CustomSizedSlabs.clear();
+    BytesAllocated = 0;
 
     if (Slabs.empty())
       return;
 
     // Reset the state.
-    BytesAllocated = 0;
     CurPtr = (char *)Slabs.front();
     End = CurPtr + SlabSize;
 
@@ -281,7 +281,7 @@ public:
   size_t getBytesAllocated() const { return BytesAllocated; }
 
   void PrintStats() const {
-    detail::printBumpPtrAllocatorStats(Slabs.size(), BytesAllocated,
+    detail::printBumpPtrAllocatorStats(GetNumSlabs(), BytesAllocated,
                                        getTotalMemory());
   }
 
@@ -16,6 +16,7 @@
 #define LLVM_SUPPORT_CACHE_PRUNING_H
 
 #include "llvm/ADT/StringRef.h"
+#include <cstdint>
 
 namespace llvm {
 
@@ -52,16 +53,35 @@ public:
     return *this;
   }
 
+  /// Define the maximum size for the cache directory in bytes. This applies
+  /// on top of setMaxSize(). A value of 0 disable this limit.
+  CachePruning &setMaxSizeBytes(uint64_t Bytes) {
+    MaxSizeBytes = Bytes;
+    return *this;
+  }
+
   /// Peform pruning using the supplied options, returns true if pruning
   /// occured, i.e. if PruningInterval was expired.
+  ///
+  /// The size and last use of every entry are kept in an index file in the
+  /// cache directory, so that only entries that are new, or that look due for
+  /// expiration, need to be stat()'d.
   bool prune();
 
+  /// Record that the cache entry at \p EntryPath, which is \p Size bytes
+  /// long, has just been created or used. This appends a line to a journal in
+  /// the entry's directory that the next prune() reads, which is both cheaper
+  /// than a stat() and does not depend on the file system updating access
+  /// times. Many processes can record accesses to the same cache at once.
+  static void recordAccess(StringRef EntryPath, uint64_t Size);
+
 private:
   // Options that matches the setters above.
   std::string Path;
   unsigned Expiration = 0;
   unsigned Interval = 0;
   unsigned PercentageOfAvailableSpace = 0;
+  uint64_t MaxSizeBytes = 0;
 };
 
 } // namespace llvm
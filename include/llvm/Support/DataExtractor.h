@@ -332,6 +332,33 @@ public:
   ///     The extracted unsigned integer value.
   uint64_t getULEB128(uint32_t *offset_ptr) const;
 
+  /// Extract \a count unsigned LEB128 values from \a *offset_ptr.
+  ///
+  /// Extract \a count consecutive unsigned LEB128 numbers from the
+  /// binary data at the offset pointed to by \a offset_ptr, and
+  /// advance the offset on success. The extracted values are copied
+  /// into \a dst. This is much faster than extracting the values one
+  /// at a time.
+  ///
+  /// @param[in,out] offset_ptr
+  ///     A pointer to an offset within the data that will be advanced
+  ///     past the last value if all values are extracted correctly. If
+  ///     the data ends before \a count values have been read, the
+  ///     offset will be left unmodified.
+  ///
+  /// @param[out] dst
+  ///     A buffer to copy \a count uint64_t values into. \a dst must
+  ///     be large enough to hold all requested data.
+  ///
+  /// @param[in] count
+  ///     The number of values to extract.
+  ///
+  /// @return
+  ///     \a dst if all values were properly extracted and copied,
+  ///     NULL otherise.
+  uint64_t *getULEB128(uint32_t *offset_ptr, uint64_t *dst,
+                       uint32_t count) const;
+
   /// Test the validity of \a offset.
   ///
   /// @return
@@ -28,6 +28,7 @@
 #define LLVM_SUPPORT_FILESYSTEM_H
 
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Twine.h"
@@ -743,6 +744,14 @@ public:
   const std::string &path() const { return Path; }
   std::error_code status(file_status &result) const;
 
+  /// Return the type of the entry if the directory listing reported it, or
+  /// file_type::type_unknown if only status() can tell. Unlike status(), this
+  /// does not touch the file system and does not follow symbolic links.
+  file_type type() const {
+    return Status.type() == file_type::status_error ? file_type::type_unknown
+                                                    : Status.type();
+  }
+
   bool operator==(const directory_entry& rhs) const { return Path == rhs.Path; }
   bool operator!=(const directory_entry& rhs) const { return !(*this == rhs); }
   bool operator< (const directory_entry& rhs) const;
@@ -855,8 +864,12 @@ public:
     if (State->HasNoPushRequest)
       State->HasNoPushRequest = false;
     else {
-      file_status st;
-      if ((ec = State->Stack.top()->status(st))) return *this;
+      // Use the type from the directory listing when it has one, so that only
+      // symbolic links and entries of unknown type need a stat.
+      file_status st(State->Stack.top()->type());
+      if (st.type() == file_type::type_unknown ||
+          st.type() == file_type::symlink_file)
+        if ((ec = State->Stack.top()->status(st))) return *this;
       if (is_directory(st)) {
         State->Stack.push(directory_iterator(*State->Stack.top(), ec));
         if (ec) return *this;
@@ -926,6 +939,28 @@ public:
   // C++ Std, 24.1.1 Input iterators [input.iterators]
 };
 
+/// Visit every file and directory below \p Path, reading directories and
+/// getting the status of their entries on up to \p ThreadCount threads at
+/// once (zero means one per hardware thread).
+///
+/// \p Visit is only ever called on the calling thread, one entry at a time,
+/// and in no particular order between directories. It is passed the status of
+/// the entry, which is a full stat() result if \p StatEntries is true. If it
+/// is false, the status holds just the type reported by the directory
+/// listing, and entries are only stat()'d if the listing gave no type or named
+/// a symbolic link. Like recursive_directory_iterator, symbolic links are
+/// followed. A directory is descended into only if \p Visit returns true for
+/// it. Entries that cannot be stat()'d are passed a status of
+/// file_type::status_error.
+///
+/// \returns The first error opening or reading a directory. The walk visits
+/// everything it can reach regardless.
+std::error_code
+walk_directory_tree(const Twine &Path,
+                    function_ref<bool(const directory_entry &Entry,
+                                      const file_status &Status)> Visit,
+                    bool StatEntries = false, unsigned ThreadCount = 0);
+
 /// @}
 
 } // end namespace fs
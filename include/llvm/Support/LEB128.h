@@ -109,6 +109,16 @@ inline int64_t decodeSLEB128(const uint8_t *p, unsigned *n = nullptr) {
   return Value;
 }
 
+/// Utility function to decode up to \p Count consecutive ULEB128 values from
+/// the bytes in [\p p, \p end) into \p Out. Returns the number of values
+/// decoded, which is less than \p Count if the bytes run out in the middle of
+/// a value. \p p is advanced past the last decoded value.
+///
+/// Values are decoded a 64-bit word at a time, so this is considerably faster
+/// than repeated calls to decodeULEB128 on long runs of small values. Bits
+/// beyond the 64th of an over-long encoding are discarded.
+extern unsigned decodeULEB128Batch(const uint8_t *&p, const uint8_t *end,
+                                   uint64_t *Out, unsigned Count);
 
 /// Utility function to get the size of the ULEB128-encoded value.
 extern unsigned getULEB128Size(uint64_t Value);
@@ -28,12 +28,13 @@
 #ifndef LLVM_SUPPORT_MD5_H
 #define LLVM_SUPPORT_MD5_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/Endian.h"
+#include <array>
 
 namespace llvm {
-template <typename T> class ArrayRef;
 
 class MD5 {
   // Any 32-bit or wider unsigned integer data type will do.
@@ -62,6 +63,28 @@ public:
   /// deposited into \p Str. The result will be of length 32.
   static void stringifyResult(MD5Result &Result, SmallString<32> &Str);
 
+  /// Compute the MD5 of each of \p Inputs into the element of \p Results
+  /// with the same index.
+  ///
+  /// On hosts with AVX2, eight buffers are hashed at once in the lanes of a
+  /// vector. MD5 is one long dependency chain per message, so this is the
+  /// only way to use more than one ALU.
+  static void hashMany(ArrayRef<ArrayRef<uint8_t>> Inputs,
+                       MutableArrayRef<std::array<uint8_t, 16>> Results);
+
+  /// The implementations of hashMany.
+  enum class Implementation {
+    Default, ///< The fastest one the host supports.
+    Generic, ///< One message after the other.
+    AVX2     ///< Eight messages at once in AVX2.
+  };
+
+  /// Make every MD5 computation in the process use \p Impl, so that tests
+  /// and benchmarks can cover each one on any host. Returns false, and
+  /// changes nothing, if the host can't run \p Impl. Not thread safe: no
+  /// hash may be computed concurrently.
+  static bool setImplementationForTesting(Implementation Impl);
+
 private:
   const uint8_t *body(ArrayRef<uint8_t> Data);
 };
@@ -18,6 +18,7 @@
 
 #include "llvm/ADT/ArrayRef.h"
 
+#include <array>
 #include <cstdint>
 
 namespace llvm {
@@ -53,6 +54,32 @@ public:
   /// made into update.
   StringRef result();
 
+  /// Return the raw 160-bits SHA1 of \p Data.
+  static std::array<uint8_t, 20> hash(ArrayRef<uint8_t> Data);
+
+  /// Compute the raw 160-bits SHA1 of each of \p Inputs into the element of
+  /// \p Results with the same index.
+  ///
+  /// On hosts without the SHA extensions but with AVX2, eight buffers are
+  /// hashed at once in the lanes of a vector, which is several times faster
+  /// than hashing them one after the other.
+  static void hashMany(ArrayRef<ArrayRef<uint8_t>> Inputs,
+                       MutableArrayRef<std::array<uint8_t, 20>> Results);
+
+  /// The implementations of the block function.
+  enum class Implementation {
+    Default, ///< The fastest one the host supports.
+    Generic, ///< Portable scalar code.
+    SHANI,   ///< The x86 SHA extensions.
+    AVX2     ///< Scalar for one stream, eight lanes in AVX2 for hashMany.
+  };
+
+  /// Make every SHA1 computation in the process use \p Impl, so that tests
+  /// and benchmarks can cover each one on any host. Returns false, and
+  /// changes nothing, if the host can't run \p Impl. Not thread safe: no
+  /// hash may be computed concurrently.
+  static bool setImplementationForTesting(Implementation Impl);
+
 private:
   /// Define some constants.
   /// "static constexpr" would be cleaner but MSVC does not support it yet.
@@ -63,7 +90,7 @@ private:
   struct {
     uint32_t Buffer[BLOCK_LENGTH / 4];
     uint32_t State[HASH_LENGTH / 4];
-    uint32_t ByteCount;
+    uint64_t ByteCount;
     uint8_t BufferOffset;
   } InternalState;
 
@@ -71,7 +98,6 @@ private:
   uint32_t HashResult[HASH_LENGTH / 4];
 
   // Helper
-  void writebyte(uint8_t data);
   void hashBlock();
   void addUncounted(uint8_t data);
   void pad();
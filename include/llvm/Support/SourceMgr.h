@@ -49,13 +49,27 @@ private:
     /// The memory buffer for the file.
     std::unique_ptr<MemoryBuffer> Buffer;
 
+    /// Sorted offsets of the '\n' characters in the buffer, built on the first
+    /// line number query. The element type depends on the size of the buffer,
+    /// so the implementation is private to SourceMgr.cpp.
+    mutable void *OffsetCache;
+
+    /// Return the 1-based line number of \p Ptr, which must point into the
+    /// buffer or at its end.
+    unsigned getLineNumber(const char *Ptr) const;
+
     /// This is the location of the parent include, or null if at the top level.
     SMLoc IncludeLoc;
 
-    SrcBuffer() {}
+    SrcBuffer() : OffsetCache(nullptr) {}
 
     SrcBuffer(SrcBuffer &&O)
-        : Buffer(std::move(O.Buffer)), IncludeLoc(O.IncludeLoc) {}
+        : Buffer(std::move(O.Buffer)), OffsetCache(O.OffsetCache),
+          IncludeLoc(O.IncludeLoc) {
+      O.OffsetCache = nullptr;
+    }
+
+    ~SrcBuffer();
   };
 
   /// This is all of the buffers that we are reading from.
@@ -64,10 +78,6 @@ private:
   // This is the list of directories we should search for include files in.
   std::vector<std::string> IncludeDirectories;
 
-  /// This is a cache for line number queries, its implementation is really
-  /// private to SourceMgr.cpp.
-  mutable void *LineNoCache;
-
   DiagHandlerTy DiagHandler;
   void *DiagContext;
 
@@ -76,9 +86,7 @@ private:
   SourceMgr(const SourceMgr&) = delete;
   void operator=(const SourceMgr&) = delete;
 public:
-  SourceMgr()
-    : LineNoCache(nullptr), DiagHandler(nullptr), DiagContext(nullptr) {}
-  ~SourceMgr();
+  SourceMgr() : DiagHandler(nullptr), DiagContext(nullptr) {}
 
   void setIncludeDirs(const std::vector<std::string> &Dirs) {
     IncludeDirectories = Dirs;
@@ -0,0 +1,99 @@
+//===- llvm/Support/ThreadLocalAllocator.h - Per-thread arenas --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines ThreadLocalBumpPtrAllocator, a bump pointer allocator that
+// threads can share by each allocating from an arena of their own.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_THREADLOCALALLOCATOR_H
+#define LLVM_SUPPORT_THREADLOCALALLOCATOR_H
+
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadLocal.h"
+#include <memory>
+#include <vector>
+
+namespace llvm {
+
+/// \brief A bump pointer allocator that can be used from many threads at once.
+///
+/// The first time a thread allocates, it is given its own BumpPtrAllocator
+/// arena, so Allocate never takes a lock. Every arena belongs to the
+/// ThreadLocalBumpPtrAllocator rather than to its thread, and memory stays
+/// valid after the allocating thread exits. It is freed all at once by Reset()
+/// or by destroying the allocator, neither of which may race with Allocate().
+///
+/// Each instance uses one thread-local storage key, so prefer a few long-lived
+/// instances that are reset between units of work to many short-lived ones.
+class ThreadLocalBumpPtrAllocator
+    : public AllocatorBase<ThreadLocalBumpPtrAllocator> {
+public:
+  ThreadLocalBumpPtrAllocator();
+  ~ThreadLocalBumpPtrAllocator();
+
+  /// \brief Allocate space at the specified alignment from the calling
+  /// thread's arena.
+  LLVM_ATTRIBUTE_RETURNS_NONNULL LLVM_ATTRIBUTE_RETURNS_NOALIAS void *
+  Allocate(size_t Size, size_t Alignment) {
+    return getThreadArena().Allocate(Size, Alignment);
+  }
+
+  // Pull in base class overloads.
+  using AllocatorBase<ThreadLocalBumpPtrAllocator>::Allocate;
+
+  /// \brief Memory is only reclaimed by Reset(), so this just tells ASan that
+  /// the space is no longer in use.
+  void Deallocate(const void *Ptr, size_t Size) {
+    __asan_poison_memory_region(Ptr, Size);
+  }
+
+  // Pull in base class overloads.
+  using AllocatorBase<ThreadLocalBumpPtrAllocator>::Deallocate;
+
+  /// \brief Free everything allocated so far from every arena. Each arena
+  /// keeps its first slab, and each thread keeps its arena, for reuse.
+  void Reset();
+
+  /// \brief Return the calling thread's arena, creating it if this is the
+  /// thread's first allocation.
+  BumpPtrAllocator &getThreadArena() {
+    if (BumpPtrAllocator *Arena = CurrentArena.get())
+      return *Arena;
+    return createThreadArena();
+  }
+
+  /// \brief Return the number of threads that have allocated so far.
+  size_t getNumArenas() const;
+
+  size_t GetNumSlabs() const;
+  size_t getTotalMemory() const;
+  size_t getBytesAllocated() const;
+
+  /// \brief Print the memory used and wasted by each arena, and in total.
+  void PrintStats() const;
+
+private:
+  ThreadLocalBumpPtrAllocator(const ThreadLocalBumpPtrAllocator &) = delete;
+  void operator=(const ThreadLocalBumpPtrAllocator &) = delete;
+
+  BumpPtrAllocator &createThreadArena();
+
+  /// \brief The calling thread's arena, or null before its first allocation.
+  sys::ThreadLocal<BumpPtrAllocator> CurrentArena;
+
+  /// \brief Guards Arenas against threads allocating for the first time.
+  mutable sys::Mutex ArenasLock;
+  std::vector<std::unique_ptr<BumpPtrAllocator>> Arenas;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_SUPPORT_THREADLOCALALLOCATOR_H
@@ -276,6 +276,16 @@ private:
   /// \invariant { Size > 0 }
   virtual void write_impl(const char *Ptr, size_t Size) = 0;
 
+  /// Write the \p BufferedSize bytes at \p Buffered followed by the \p Size
+  /// bytes at \p Ptr to the underlying stream. This is used instead of
+  /// write_impl when a write too large for the buffer arrives while the buffer
+  /// is not empty. Subclasses that can write both pieces at once should
+  /// override it; by default it calls write_impl once for each piece.
+  ///
+  /// \invariant { BufferedSize > 0 && Size > 0 }
+  virtual void writev_impl(const char *Buffered, size_t BufferedSize,
+                           const char *Ptr, size_t Size);
+
   // An out of line virtual method to provide a home for the class vtable.
   virtual void handle();
 
@@ -356,6 +366,10 @@ class raw_fd_ostream : public raw_pwrite_stream {
   /// See raw_ostream::write_impl.
   void write_impl(const char *Ptr, size_t Size) override;
 
+  /// See raw_ostream::writev_impl.
+  void writev_impl(const char *Buffered, size_t BufferedSize, const char *Ptr,
+                   size_t Size) override;
+
   void pwrite_impl(const char *Ptr, size_t Size, uint64_t Offset) override;
 
   /// Return the current position within the stream, not counting the bytes
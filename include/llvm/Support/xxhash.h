@@ -0,0 +1,141 @@
+//===- llvm/Support/xxhash.h - xxHash ---------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the XXH64 and XXH3 128-bit hash functions by Yann
+// Collet (https://github.com/Cyan4973/xxHash, BSD 2-Clause License), fast
+// non-cryptographic hashes of byte strings. It runs at memory speed on large
+// inputs, an order of magnitude faster than MD5 and SHA1, and should be used
+// wherever a content hash doesn't have to resist deliberate collisions.
+//
+// The result only depends on the input bytes and the seed, so it is the same
+// on every host and can be stored.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_XXHASH_H
+#define LLVM_SUPPORT_XXHASH_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include <array>
+#include <cstdint>
+
+namespace llvm {
+
+/// Incrementally computes the XXH64 hash of the data passed to \c update.
+///
+/// Splitting the input over several calls to \c update gives the same result
+/// as hashing it in one piece.
+class XXHash64 {
+public:
+  explicit XXHash64(uint64_t Seed = 0) { init(Seed); }
+
+  /// Reinitialize the internal state.
+  void init(uint64_t Seed = 0);
+
+  /// Digest more data.
+  void update(ArrayRef<uint8_t> Data);
+
+  /// Digest more data.
+  void update(StringRef Str) {
+    update(ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(Str.data()),
+                             Str.size()));
+  }
+
+  /// Return the hash of the data digested since the last call to init(). This
+  /// does not change the internal state, so more data can be added afterwards.
+  uint64_t result() const;
+
+  /// Hash \p Data in one go.
+  static uint64_t hash(ArrayRef<uint8_t> Data, uint64_t Seed = 0);
+
+private:
+  enum { STRIPE_LENGTH = 32 };
+
+  uint64_t Seed;
+  uint64_t Acc[4];
+  uint64_t TotalLength;
+  uint8_t Buffer[STRIPE_LENGTH];
+  unsigned BufferSize;
+};
+
+/// Return the XXH64 hash of \p Data with a seed of zero.
+inline uint64_t xxHash64(StringRef Data) {
+  return XXHash64::hash(
+      ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(Data.data()),
+                        Data.size()));
+}
+
+/// Incrementally computes the XXH3 128-bit hash of the data passed to
+/// \c update. Use it instead of XXHash64 when the hash names content that
+/// must not collide in practice, such as cache entries.
+class XXHash128 {
+public:
+  /// The two halves of a 128-bit hash.
+  struct Result {
+    uint64_t Low;
+    uint64_t High;
+
+    bool operator==(const Result &RHS) const {
+      return Low == RHS.Low && High == RHS.High;
+    }
+    bool operator!=(const Result &RHS) const { return !(*this == RHS); }
+
+    /// Return the 16 bytes of the canonical representation, high half first
+    /// and big endian, as printed by the reference xxhsum.
+    std::array<uint8_t, 16> bytes() const;
+  };
+
+  explicit XXHash128(uint64_t Seed = 0) { init(Seed); }
+
+  /// Reinitialize the internal state.
+  void init(uint64_t Seed = 0);
+
+  /// Digest more data.
+  void update(ArrayRef<uint8_t> Data);
+
+  /// Digest more data.
+  void update(StringRef Str) {
+    update(ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(Str.data()),
+                             Str.size()));
+  }
+
+  /// Return the hash of the data digested since the last call to init(). This
+  /// does not change the internal state, so more data can be added afterwards.
+  Result result() const;
+
+  /// Hash \p Data in one go.
+  static Result hash(ArrayRef<uint8_t> Data, uint64_t Seed = 0);
+
+private:
+  enum {
+    STRIPE_LENGTH = 64,
+    SECRET_SIZE = 192,
+    BUFFER_SIZE = 256
+  };
+
+  uint64_t Seed;
+  uint64_t Acc[8];
+  uint64_t TotalLength;
+  unsigned StripesSoFar;
+  unsigned BufferSize;
+  uint8_t Secret[SECRET_SIZE];
+  uint8_t Buffer[BUFFER_SIZE];
+};
+
+/// Return the XXH3 128-bit hash of \p Data with a seed of zero.
+inline XXHash128::Result xxHash128(StringRef Data) {
+  return XXHash128::hash(
+      ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(Data.data()),
+                        Data.size()));
+}
+
+} // end namespace llvm
+
+#endif // LLVM_SUPPORT_XXHASH_H
@@ -185,6 +185,7 @@ private:
   SmallVector<std::pair<TerminatorInst *, unsigned>, 4> toSplit;
 
   // Helper functions of redundant load elimination
+  bool isMemDepBudgetExhausted() const;
   bool processLoad(LoadInst *L);
   bool processNonLocalLoad(LoadInst *L);
   bool processAssumeIntrinsic(IntrinsicInst *II);
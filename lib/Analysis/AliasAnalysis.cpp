@@ -25,6 +25,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/BasicAliasAnalysis.h"
 #include "llvm/Analysis/CFG.h"
 #include "llvm/Analysis/CFLAndersAliasAnalysis.h"
@@ -44,18 +46,33 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Operator.h"
 #include "llvm/IR/Type.h"
 #include "llvm/Pass.h"
 using namespace llvm;
 
+#define DEBUG_TYPE "aa"
+
+STATISTIC(NumQueryCacheHits, "Number of alias queries answered from the cache");
+STATISTIC(NumQueryCacheClears, "Number of times the alias query cache was "
+                               "cleared");
+
 /// Allow disabling BasicAA from the AA results. This is particularly useful
 /// when testing to isolate a single AA implementation.
 static cl::opt<bool> DisableBasicAA("disable-basicaa", cl::Hidden,
                                     cl::init(false));
 
+/// Remember the results of alias queries in the aggregation until the pointers
+/// involved change, so that passes which share one AAResults don't repeat
+/// each other's queries.
+static cl::opt<bool> EnableQueryCache("aa-query-cache", cl::Hidden,
+                                      cl::init(false));
+
 AAResults::AAResults(AAResults &&Arg) : TLI(Arg.TLI), AAs(std::move(Arg.AAs)) {
   for (auto &AA : AAs)
     AA->setAAResults(this);
+  // The value handles point back at Arg, so start over with an empty cache.
+  Arg.clearQueryCache();
 }
 
 AAResults::~AAResults() {
@@ -73,14 +90,126 @@ AAResults::~AAResults() {
 // Default chaining methods
 //===----------------------------------------------------------------------===//
 
+bool AAResults::invalidate(Function &F, const PreservedAnalyses &PA) {
+  // The cached query results are checked against the IR they were computed
+  // from, so they don't need to be dropped here.
+  return !PA.preserved(AAManager::ID());
+}
+
+void AAResults::clearQueryCache() {
+  if (QueryCache.empty() && QueryCacheHandles.empty())
+    return;
+  ++NumQueryCacheClears;
+  QueryCache.clear();
+  QueryCacheChains.clear();
+  QueryCacheValues.clear();
+  QueryCacheHandles.clear();
+}
+
+/// The maximum number of values in the address computation of a pointer whose
+/// alias queries are cached.
+static const unsigned MaxAddressChainValues = 32;
+
+/// Collect the address computation of \p Ptr into \p Chain: each value it is
+/// computed through, looking through GEPs, casts, phis and selects, followed
+/// by its operands. Return false if there are too many values to be worth
+/// caching.
+static bool collectAddressChain(const Value *Ptr,
+                                SmallVectorImpl<const Value *> &Chain) {
+  SmallVector<const Value *, 8> Worklist;
+  SmallPtrSet<const Value *, 8> Visited;
+  Worklist.push_back(Ptr);
+  while (!Worklist.empty()) {
+    const Value *V = Worklist.pop_back_val();
+    if (!Visited.insert(V).second)
+      continue;
+    if (Visited.size() > MaxAddressChainValues)
+      return false;
+    Chain.push_back(V);
+
+    auto *U = dyn_cast<User>(V);
+    if (!U || !(isa<GEPOperator>(U) || isa<PHINode>(U) || isa<SelectInst>(U) ||
+                Operator::getOpcode(U) == Instruction::BitCast ||
+                Operator::getOpcode(U) == Instruction::AddrSpaceCast))
+      continue;
+    for (const Value *Op : U->operands()) {
+      Chain.push_back(Op);
+      if (Op->getType()->isPointerTy())
+        Worklist.push_back(Op);
+    }
+  }
+  return true;
+}
+
+bool AAResults::trackQueryCachePointer(const Value *Ptr) {
+  if (QueryCacheChains.count(Ptr))
+    return true;
+  AddressChain Chain;
+  if (!collectAddressChain(Ptr, Chain))
+    return false;
+  for (const Value *V : Chain)
+    if (!isa<ConstantData>(V) && QueryCacheValues.insert(V).second)
+      QueryCacheHandles.emplace_back(
+          new QueryCacheVH(const_cast<Value *>(V), this));
+  QueryCacheChains[Ptr] = std::move(Chain);
+  return true;
+}
+
+bool AAResults::isQueryCachePointerUnchanged(const Value *Ptr) {
+  // Operands rewritten in place don't notify the value handles, so compare
+  // the address computation with the one the results were computed from.
+  auto It = QueryCacheChains.find(Ptr);
+  AddressChain Chain;
+  return It != QueryCacheChains.end() && collectAddressChain(Ptr, Chain) &&
+         Chain == It->second;
+}
+
+void AAResults::QueryCacheVH::deleted() {
+  // This destroys the handle itself, so don't touch any members afterwards.
+  AAR->clearQueryCache();
+}
+
+void AAResults::QueryCacheVH::allUsesReplacedWith(Value *) {
+  AAR->clearQueryCache();
+}
+
 AliasResult AAResults::alias(const MemoryLocation &LocA,
                              const MemoryLocation &LocB) {
+  if (!EnableQueryCache || !LocA.Ptr || !LocB.Ptr) {
+    for (const auto &AA : AAs) {
+      auto Result = AA->alias(LocA, LocB);
+      if (Result != MayAlias)
+        return Result;
+    }
+    return MayAlias;
+  }
+
+  // Alias queries are symmetric, so canonicalize the key.
+  LocPair Locs(LocA, LocB);
+  if (Locs.first.Ptr > Locs.second.Ptr)
+    std::swap(Locs.first, Locs.second);
+
+  auto CacheIt = QueryCache.find(Locs);
+  if (CacheIt != QueryCache.end()) {
+    if (isQueryCachePointerUnchanged(Locs.first.Ptr) &&
+        isQueryCachePointerUnchanged(Locs.second.Ptr)) {
+      ++NumQueryCacheHits;
+      return CacheIt->second;
+    }
+    clearQueryCache();
+  }
+
+  AliasResult Result = MayAlias;
   for (const auto &AA : AAs) {
-    auto Result = AA->alias(LocA, LocB);
+    Result = AA->alias(LocA, LocB);
     if (Result != MayAlias)
-      return Result;
+      break;
   }
-  return MayAlias;
+
+  if (trackQueryCachePointer(Locs.first.Ptr) &&
+      trackQueryCachePointer(Locs.second.Ptr))
+    QueryCache[Locs] = Result;
+  return Result;
 }
 
 bool AAResults::pointsToConstantMemory(const MemoryLocation &Loc,
@@ -15,6 +15,9 @@
 #include "llvm/Analysis/LazyValueInfo.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SparseBitVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
@@ -32,12 +35,19 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include <map>
-#include <stack>
 using namespace llvm;
 using namespace PatternMatch;
 
 #define DEBUG_TYPE "lazy-value-info"
 
+STATISTIC(NumBudgetExhausted,
+          "Number of queries given up on due to the work budget");
+
+static cl::opt<unsigned> MaxProcessedPerValue(
+    "lvi-max-processed-per-value", cl::Hidden, cl::init(500),
+    cl::desc("The number of block values LazyValueInfo may solve for one "
+             "query before giving up on it as overdefined (default = 500)"));
+
 char LazyValueInfoWrapperPass::ID = 0;
 INITIALIZE_PASS_BEGIN(LazyValueInfoWrapperPass, "lazy-value-info",
                 "Lazy Value Information Analysis", false, true)
@@ -385,35 +395,56 @@ namespace {
   /// This is the cache kept by LazyValueInfo which
   /// maintains information about queries across the clients' queries.
   class LazyValueInfoCache {
-    /// This is all of the cached block information for exactly one Value*.
-    /// The entries are sorted by the BasicBlock* of the
-    /// entries, allowing us to do a lookup with a binary search.
-    /// Over-defined lattice values are recorded in OverDefinedCache to reduce
+    /// This is all of the cached block information for exactly one Value*,
+    /// keyed by the number of the block. Over-defined lattice values, by far
+    /// the most common result, are recorded as one bit per block to reduce
     /// memory overhead.
     struct ValueCacheEntryTy {
       ValueCacheEntryTy(Value *V, LazyValueInfoCache *P) : Handle(V, P) {}
       LVIValueHandle Handle;
-      SmallDenseMap<AssertingVH<BasicBlock>, LVILatticeVal, 4> BlockVals;
+      SparseBitVector<> OverDefined;
+      SmallDenseMap<unsigned, LVILatticeVal, 4> BlockVals;
     };
 
     /// This is all of the cached information for all values,
     /// mapped from Value* to key information.
     DenseMap<Value *, std::unique_ptr<ValueCacheEntryTy>> ValueCache;
 
-    /// This tracks, on a per-block basis, the set of values that are
-    /// over-defined at the end of that block.
-    typedef DenseMap<AssertingVH<BasicBlock>, SmallPtrSet<Value *, 4>>
-        OverDefinedCacheTy;
-    OverDefinedCacheTy OverDefinedCache;
+    /// The dense numbers of all blocks that we have ever seen. This also lets
+    /// us not spend time removing unused blocks from our caches. Numbers are
+    /// not reused after a block is erased.
+    DenseMap<AssertingVH<BasicBlock>, unsigned> BlockNumbers;
+    unsigned NextBlockNumber = 0;
+
+    /// This tracks, per block number, the values that have a result cached
+    /// for that block, so that dropping the results of a block does not walk
+    /// the whole ValueCache.
+    DenseMap<unsigned, SmallPtrSet<Value *, 4>> BlockValues;
+
+    unsigned getBlockNumber(BasicBlock *BB) {
+      auto It = BlockNumbers.insert({BB, NextBlockNumber});
+      if (It.second)
+        ++NextBlockNumber;
+      return It.first->second;
+    }
 
-    /// Keep track of all blocks that we have ever seen, so we
-    /// don't spend time removing unused blocks from our caches.
-    DenseSet<AssertingVH<BasicBlock> > SeenBlocks;
+    /// Return the cache entry of V, or null if nothing is cached for it.
+    ValueCacheEntryTy *lookupEntry(Value *V, BasicBlock *BB,
+                                   unsigned &BBNumber) const {
+      auto BI = BlockNumbers.find_as(BB);
+      if (BI == BlockNumbers.end())
+        return nullptr;
+      auto I = ValueCache.find_as(V);
+      if (I == ValueCache.end())
+        return nullptr;
+      BBNumber = BI->second;
+      return I->second.get();
+    }
 
     /// This stack holds the state of the value solver during a query.
     /// It basically emulates the callstack of the naive
     /// recursive value lookup process.
-    std::stack<std::pair<BasicBlock*, Value*> > BlockValueStack;
+    SmallVector<std::pair<BasicBlock *, Value *>, 8> BlockValueStack;
 
     /// Keeps track of which block-value pairs are in BlockValueStack.
     DenseSet<std::pair<BasicBlock*, Value*> > BlockValueSet;
@@ -426,7 +457,7 @@ namespace {
 
       DEBUG(dbgs() << "PUSH: " << *BV.second << " in " << BV.first->getName()
                    << "\n");
-      BlockValueStack.push(BV);
+      BlockValueStack.push_back(BV);
       return true;
     }
 
@@ -437,21 +468,23 @@ namespace {
     friend struct LVIValueHandle;
 
     void insertResult(Value *Val, BasicBlock *BB, const LVILatticeVal &Result) {
-      SeenBlocks.insert(BB);
+      unsigned BBNumber = getBlockNumber(BB);
 
-      // Insert over-defined values into their own cache to reduce memory
+      auto It = ValueCache.find_as(Val);
+      if (It == ValueCache.end()) {
+        ValueCache[Val] = make_unique<ValueCacheEntryTy>(Val, this);
+        It = ValueCache.find_as(Val);
+        assert(It != ValueCache.end() && "Val was just added to the map!");
+      }
+
+      BlockValues[BBNumber].insert(Val);
+
+      // Insert over-defined values into their own set to reduce memory
       // overhead.
       if (Result.isOverdefined())
-        OverDefinedCache[BB].insert(Val);
-      else {
-        auto It = ValueCache.find_as(Val);
-        if (It == ValueCache.end()) {
-          ValueCache[Val] = make_unique<ValueCacheEntryTy>(Val, this);
-          It = ValueCache.find_as(Val);
-          assert(It != ValueCache.end() && "Val was just added to the map!");
-        }
-        It->second->BlockVals[BB] = Result;
-      }
+        It->second->OverDefined.set(BBNumber);
+      else
+        It->second->BlockVals[BBNumber] = Result;
     }
 
   LVILatticeVal getBlockValue(Value *Val, BasicBlock *BB);
@@ -476,35 +509,25 @@ namespace {
 
   void solve();
 
-    bool isOverdefined(Value *V, BasicBlock *BB) const {
-      auto ODI = OverDefinedCache.find(BB);
-
-      if (ODI == OverDefinedCache.end())
+    bool hasCachedValueInfo(Value *V, BasicBlock *BB) const {
+      unsigned BBNumber;
+      ValueCacheEntryTy *Entry = lookupEntry(V, BB, BBNumber);
+      if (!Entry)
         return false;
 
-      return ODI->second.count(V);
+      return Entry->OverDefined.test(BBNumber) ||
+             Entry->BlockVals.count(BBNumber);
     }
 
-    bool hasCachedValueInfo(Value *V, BasicBlock *BB) {
-      if (isOverdefined(V, BB))
-        return true;
-
-      auto I = ValueCache.find_as(V);
-      if (I == ValueCache.end())
-        return false;
-
-      return I->second->BlockVals.count(BB);
-    }
-
-    LVILatticeVal getCachedValueInfo(Value *V, BasicBlock *BB) {
-      if (isOverdefined(V, BB))
-        return LVILatticeVal::getOverdefined();
-
-      auto I = ValueCache.find_as(V);
-      if (I == ValueCache.end())
+    LVILatticeVal getCachedValueInfo(Value *V, BasicBlock *BB) const {
+      unsigned BBNumber;
+      ValueCacheEntryTy *Entry = lookupEntry(V, BB, BBNumber);
+      if (!Entry)
         return LVILatticeVal();
-      auto BBI = I->second->BlockVals.find(BB);
-      if (BBI == I->second->BlockVals.end())
+      if (Entry->OverDefined.test(BBNumber))
+        return LVILatticeVal::getOverdefined();
+      auto BBI = Entry->BlockVals.find(BBNumber);
+      if (BBI == Entry->BlockVals.end())
         return LVILatticeVal();
       return BBI->second;
     }
@@ -533,11 +556,14 @@ namespace {
     /// that a block has been deleted.
     void eraseBlock(BasicBlock *BB);
 
+    /// Drop everything cached for V.
+    void eraseValue(Value *V);
+
     /// clear - Empty the cache.
     void clear() {
-      SeenBlocks.clear();
+      BlockNumbers.clear();
+      BlockValues.clear();
       ValueCache.clear();
-      OverDefinedCache.clear();
     }
 
     LazyValueInfoCache(AssumptionCache *AC, const DataLayout &DL,
@@ -547,56 +573,79 @@ namespace {
 } // end anonymous namespace
 
 void LVIValueHandle::deleted() {
-  SmallVector<AssertingVH<BasicBlock>, 4> ToErase;
-  for (auto &I : Parent->OverDefinedCache) {
-    SmallPtrSetImpl<Value *> &ValueSet = I.second;
-    if (ValueSet.count(getValPtr()))
-      ValueSet.erase(getValPtr());
-    if (ValueSet.empty())
-      ToErase.push_back(I.first);
-  }
-  for (auto &BB : ToErase)
-    Parent->OverDefinedCache.erase(BB);
-
   // This erasure deallocates *this, so it MUST happen after we're done
   // using any and all members of *this.
-  Parent->ValueCache.erase(*this);
+  Parent->eraseValue(*this);
+}
+
+void LazyValueInfoCache::eraseValue(Value *V) {
+  auto I = ValueCache.find_as(V);
+  if (I == ValueCache.end())
+    return;
+  ValueCacheEntryTy &Entry = *I->second;
+  for (unsigned BBNumber : Entry.OverDefined)
+    BlockValues[BBNumber].erase(V);
+  for (auto &BV : Entry.BlockVals)
+    BlockValues[BV.first].erase(V);
+  ValueCache.erase(I);
 }
 
 void LazyValueInfoCache::eraseBlock(BasicBlock *BB) {
   // Shortcut if we have never seen this block.
-  DenseSet<AssertingVH<BasicBlock> >::iterator I = SeenBlocks.find(BB);
-  if (I == SeenBlocks.end())
+  auto I = BlockNumbers.find_as(BB);
+  if (I == BlockNumbers.end())
     return;
-  SeenBlocks.erase(I);
-
-  auto ODI = OverDefinedCache.find(BB);
-  if (ODI != OverDefinedCache.end())
-    OverDefinedCache.erase(ODI);
+  unsigned BBNumber = I->second;
+  BlockNumbers.erase(I);
 
-  for (auto &I : ValueCache)
-    I.second->BlockVals.erase(BB);
+  auto BVI = BlockValues.find(BBNumber);
+  if (BVI == BlockValues.end())
+    return;
+  for (Value *V : BVI->second) {
+    ValueCacheEntryTy &Entry = *ValueCache.find_as(V)->second;
+    Entry.OverDefined.reset(BBNumber);
+    Entry.BlockVals.erase(BBNumber);
+  }
+  BlockValues.erase(BVI);
 }
 
 void LazyValueInfoCache::solve() {
+  SmallVector<std::pair<BasicBlock *, Value *>, 8> StartingStack(
+      BlockValueStack.begin(), BlockValueStack.end());
+
+  unsigned ProcessedCount = 0;
   while (!BlockValueStack.empty()) {
-    std::pair<BasicBlock*, Value*> &e = BlockValueStack.top();
+    // Give up if we have to process too many values to get a result for the
+    // query. The partial results computed so far are complete and stay
+    // cached; only the query itself is answered as overdefined.
+    if (++ProcessedCount > MaxProcessedPerValue) {
+      DEBUG(dbgs() << "Giving up on stack because we are getting too deep\n");
+      ++NumBudgetExhausted;
+      for (auto &e : StartingStack)
+        if (!hasCachedValueInfo(e.second, e.first))
+          insertResult(e.second, e.first, LVILatticeVal::getOverdefined());
+      BlockValueSet.clear();
+      BlockValueStack.clear();
+      return;
+    }
+
+    std::pair<BasicBlock *, Value *> e = BlockValueStack.back();
     assert(BlockValueSet.count(e) && "Stack value should be in BlockValueSet!");
 
     if (solveBlockValue(e.second, e.first)) {
       // The work item was completely processed.
-      assert(BlockValueStack.top() == e && "Nothing should have been pushed!");
+      assert(BlockValueStack.back() == e && "Nothing should have been pushed!");
       assert(hasCachedValueInfo(e.second, e.first) &&
              "Result should be in cache!");
 
       DEBUG(dbgs() << "POP " << *e.second << " in " << e.first->getName()
                    << " = " << getCachedValueInfo(e.second, e.first) << "\n");
 
-      BlockValueStack.pop();
+      BlockValueStack.pop_back();
       BlockValueSet.erase(e);
     } else {
       // More work needs to be done before revisiting.
-      assert(BlockValueStack.top() != e && "Stack should have been pushed!");
+      assert(BlockValueStack.back() != e && "Stack should have been pushed!");
     }
   }
 }
@@ -614,7 +663,7 @@ LVILatticeVal LazyValueInfoCache::getBlockValue(Value *Val, BasicBlock *BB) {
   if (Constant *VC = dyn_cast<Constant>(Val))
     return LVILatticeVal::get(VC);
 
-  SeenBlocks.insert(BB);
+  getBlockNumber(BB);
   return getCachedValueInfo(Val, BB);
 }
 
@@ -644,8 +693,8 @@ bool LazyValueInfoCache::solveBlockValue(Value *Val, BasicBlock *BB) {
                  << "' val=" << getCachedValueInfo(Val, BB) << '\n');
 
     // Since we're reusing a cached value, we don't need to update the
-    // OverDefinedCache. The cache will have been properly updated whenever the
-    // cached value was inserted.
+    // cache. It will have been properly updated whenever the cached value
+    // was inserted.
     return true;
   }
 
@@ -1393,10 +1442,20 @@ void LazyValueInfoCache::threadEdge(BasicBlock *PredBB, BasicBlock *OldSucc,
   std::vector<BasicBlock*> worklist;
   worklist.push_back(OldSucc);
 
-  auto I = OverDefinedCache.find(OldSucc);
-  if (I == OverDefinedCache.end())
+  auto I = BlockNumbers.find_as(OldSucc);
+  if (I == BlockNumbers.end())
     return; // Nothing to process here.
-  SmallVector<Value *, 4> ValsToClear(I->second.begin(), I->second.end());
+  auto BVI = BlockValues.find(I->second);
+  if (BVI == BlockValues.end())
+    return;
+  SmallVector<std::pair<Value *, ValueCacheEntryTy *>, 4> ValsToClear;
+  for (Value *V : BVI->second) {
+    ValueCacheEntryTy *Entry = ValueCache.find_as(V)->second.get();
+    if (Entry->OverDefined.test(I->second))
+      ValsToClear.push_back({V, Entry});
+  }
+  if (ValsToClear.empty())
+    return;
 
   // Use a worklist to perform a depth-first search of OldSucc's successors.
   // NOTE: We do not need a visited list since any blocks we have already
@@ -1409,19 +1468,20 @@ void LazyValueInfoCache::threadEdge(BasicBlock *PredBB, BasicBlock *OldSucc,
     // Skip blocks only accessible through NewSucc.
     if (ToUpdate == NewSucc) continue;
 
+    auto BI = BlockNumbers.find_as(ToUpdate);
+    if (BI == BlockNumbers.end())
+      continue;
+    unsigned BBNumber = BI->second;
+
     bool changed = false;
-    for (Value *V : ValsToClear) {
+    for (auto &VE : ValsToClear) {
       // If a value was marked overdefined in OldSucc, and is here too...
-      auto OI = OverDefinedCache.find(ToUpdate);
-      if (OI == OverDefinedCache.end())
-        continue;
-      SmallPtrSetImpl<Value *> &ValueSet = OI->second;
-      if (!ValueSet.count(V))
+      ValueCacheEntryTy *Entry = VE.second;
+      if (!Entry->OverDefined.test(BBNumber))
         continue;
 
-      ValueSet.erase(V);
-      if (ValueSet.empty())
-        OverDefinedCache.erase(OI);
+      Entry->OverDefined.reset(BBNumber);
+      BlockValues[BBNumber].erase(VE.first);
 
       // If we removed anything, then we potentially need to update
       // blocks successors too.
@@ -171,8 +171,9 @@ MemDepResult MemoryDependenceResults::getCallSiteDependencyFrom(
     // Limit the amount of scanning we do so we don't end up with quadratic
     // running time on extreme testcases.
     --Limit;
-    if (!Limit)
+    if (!Limit || reachedScanLimit())
       return MemDepResult::getUnknown();
+    ++NumInstsScanned;
 
     Instruction *Inst = &*--ScanIt;
 
@@ -475,8 +476,9 @@ MemDepResult MemoryDependenceResults::getSimplePointerDependencyFrom(
     // Limit the amount of scanning we do so we don't end up with quadratic
     // running time on extreme testcases.
     --Limit;
-    if (!Limit)
+    if (!Limit || reachedScanLimit())
       return MemDepResult::getUnknown();
+    ++NumInstsScanned;
 
     if (IntrinsicInst *II = dyn_cast<IntrinsicInst>(Inst)) {
       // If we reach a lifetime begin or end marker, then the query ends here
@@ -1454,6 +1456,16 @@ void MemoryDependenceResults::invalidateCachedPredecessors() {
   PredCache.clear();
 }
 
+void MemoryDependenceResults::releaseMemory() {
+  LocalDeps.clear();
+  NonLocalDeps.clear();
+  NonLocalPointerDeps.clear();
+  ReverseLocalDeps.clear();
+  ReverseNonLocalDeps.clear();
+  ReverseNonLocalPtrDeps.clear();
+  PredCache.clear();
+}
+
 void MemoryDependenceResults::removeInstruction(Instruction *RemInst) {
   // Walk through the Non-local dependencies, removing this one as the value
   // for any cached queries.
@@ -172,6 +172,8 @@ ModuleSummaryIndexBuilder::ModuleSummaryIndexBuilder(
       continue;
     computeVariableSummary(G);
   }
+
+  Index->finalize();
 }
 
 char ModuleSummaryIndexWrapperPass::ID = 0;
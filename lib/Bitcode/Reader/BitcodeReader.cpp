@@ -6664,6 +6664,7 @@ ErrorOr<std::unique_ptr<ModuleSummaryIndex>> llvm::getModuleSummaryIndex(
 
   if (std::error_code EC = R.parseSummaryIndexInto(nullptr, Index.get()))
     return cleanupOnError(EC);
+  Index->finalize();
 
   Buf.release(); // The ModuleSummaryIndexBitcodeReader owns it now.
   return std::move(Index);
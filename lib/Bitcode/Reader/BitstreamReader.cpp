@@ -72,6 +72,19 @@ static uint64_t readAbbreviatedField(BitstreamCursor &Cursor,
   llvm_unreachable("invalid abbreviation encoding");
 }
 
+/// Return true if \p NumElts fields of at least \p Width bits each fit in the
+/// rest of an in-memory bitstream. Streamed bitcode has no known end, so this
+/// is always false for it.
+static bool fitsInRemainingBits(const BitstreamCursor &Cursor,
+                                uint64_t NumElts, unsigned Width) {
+  const BitstreamReader *R = Cursor.getBitStreamReader();
+  if (!R->getBufferStart())
+    return false;
+  uint64_t EndBit = uint64_t(R->getBufferSize()) * 8;
+  uint64_t CurBit = Cursor.GetCurrentBitNo();
+  return CurBit <= EndBit && NumElts * Width <= EndBit - CurBit;
+}
+
 static void skipAbbreviatedField(BitstreamCursor &Cursor,
                                  const BitCodeAbbrevOp &Op) {
   assert(!Op.isLiteral() && "Not to be used with literals!");
@@ -224,18 +237,29 @@ unsigned BitstreamCursor::readRecord(unsigned AbbrevID,
         report_fatal_error(
             "Array element type has to be an encoding of a type");
 
-      // Read all the elements.
+      // Read all the elements. The element count comes straight from the
+      // stream, so don't trust it enough to reserve more than the remaining
+      // bits could possibly hold.
+      unsigned EltWidth = EltEnc.hasEncodingData()
+                              ? (unsigned)EltEnc.getEncodingData()
+                              : 6;
+      if (fitsInRemainingBits(*this, NumElts, EltWidth))
+        Vals.reserve(Vals.size() + NumElts);
       switch (EltEnc.getEncoding()) {
       default:
         report_fatal_error("Array element type can't be an Array or a Blob");
-      case BitCodeAbbrevOp::Fixed:
+      case BitCodeAbbrevOp::Fixed: {
+        unsigned Width = (unsigned)EltEnc.getEncodingData();
         for (; NumElts; --NumElts)
-          Vals.push_back(Read((unsigned)EltEnc.getEncodingData()));
+          Vals.push_back(Read(Width));
         break;
-      case BitCodeAbbrevOp::VBR:
+      }
+      case BitCodeAbbrevOp::VBR: {
+        unsigned Width = (unsigned)EltEnc.getEncodingData();
         for (; NumElts; --NumElts)
-          Vals.push_back(ReadVBR64((unsigned)EltEnc.getEncodingData()));
+          Vals.push_back(ReadVBR64(Width));
         break;
+      }
       case BitCodeAbbrevOp::Char6:
         for (; NumElts; --NumElts)
           Vals.push_back(BitCodeAbbrevOp::DecodeChar6(Read(6)));
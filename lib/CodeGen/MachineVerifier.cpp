@@ -21,6 +21,12 @@
 // command-line option -verify-machineinstrs, or by defining the environment
 // variable LLVM_VERIFY_MACHINEINSTRS to the name of a file that will receive
 // the verifier errors.
+//
+// A quick mode (-verify-machineinstrs-quick) only checks the structural
+// invariants: CFG and bundle consistency, operand counts and flags, register
+// classes and the stack frame. It skips the liveness dataflow and the
+// LiveVariables / LiveIntervals checks, which dominate the cost of the full
+// verifier, so it is cheap enough to leave on in release builds.
 //===----------------------------------------------------------------------===//
 
 #include "llvm/CodeGen/Passes.h"
@@ -53,15 +59,18 @@ using namespace llvm;
 namespace {
   struct MachineVerifier {
 
-    MachineVerifier(Pass *pass, const char *b) :
+    MachineVerifier(Pass *pass, const char *b, bool quick = false) :
       PASS(pass),
-      Banner(b)
+      Banner(b),
+      Quick(quick)
       {}
 
     unsigned verify(MachineFunction &MF);
 
     Pass *const PASS;
     const char *Banner;
+    // Skip the liveness checks.
+    const bool Quick;
     const MachineFunction *MF;
     const TargetMachine *TM;
     const TargetInstrInfo *TII;
@@ -257,9 +266,11 @@ namespace {
   struct MachineVerifierPass : public MachineFunctionPass {
     static char ID; // Pass ID, replacement for typeid
     const std::string Banner;
+    const bool Quick;
 
-    MachineVerifierPass(const std::string &banner = nullptr)
-      : MachineFunctionPass(ID), Banner(banner) {
+    MachineVerifierPass(const std::string &banner = nullptr,
+                        bool quick = false)
+      : MachineFunctionPass(ID), Banner(banner), Quick(quick) {
         initializeMachineVerifierPassPass(*PassRegistry::getPassRegistry());
       }
 
@@ -269,7 +280,8 @@ namespace {
     }
 
     bool runOnMachineFunction(MachineFunction &MF) override {
-      unsigned FoundErrors = MachineVerifier(this, Banner.c_str()).verify(MF);
+      unsigned FoundErrors =
+          MachineVerifier(this, Banner.c_str(), Quick).verify(MF);
       if (FoundErrors)
         report_fatal_error("Found "+Twine(FoundErrors)+" machine code errors.");
       return false;
@@ -282,8 +294,9 @@ char MachineVerifierPass::ID = 0;
 INITIALIZE_PASS(MachineVerifierPass, "machineverifier",
                 "Verify generated machine code", false, false)
 
-FunctionPass *llvm::createMachineVerifierPass(const std::string &Banner) {
-  return new MachineVerifierPass(Banner);
+FunctionPass *llvm::createMachineVerifierPass(const std::string &Banner,
+                                              bool Quick) {
+  return new MachineVerifierPass(Banner, Quick);
 }
 
 bool MachineFunction::verify(Pass *p, const char *Banner, bool AbortOnErrors)
@@ -334,7 +347,7 @@ unsigned MachineVerifier::verify(MachineFunction &MF) {
   LiveInts = nullptr;
   LiveStks = nullptr;
   Indexes = nullptr;
-  if (PASS) {
+  if (PASS && !Quick) {
     LiveInts = PASS->getAnalysisIfAvailable<LiveIntervals>();
     // We don't want to verify LiveVariables if LiveIntervals is available.
     if (!LiveInts)
@@ -406,7 +419,8 @@ unsigned MachineVerifier::verify(MachineFunction &MF) {
       report("BundledSucc flag set on last instruction in block", &MFI->back());
     visitMachineBasicBlockAfter(&*MFI);
   }
-  visitMachineFunctionAfter();
+  if (!Quick)
+    visitMachineFunctionAfter();
 
   // Clean up.
   regsLive.clear();
@@ -751,18 +765,22 @@ MachineVerifier::visitMachineBasicBlockBefore(const MachineBasicBlock *MBB) {
       report("MBB live-in list contains non-physical register", MBB);
       continue;
     }
+    if (Quick)
+      continue;
     for (MCSubRegIterator SubRegs(LI.PhysReg, TRI, /*IncludeSelf=*/true);
          SubRegs.isValid(); ++SubRegs)
       regsLive.insert(*SubRegs);
   }
   regsLiveInButUnused = regsLive;
 
-  const MachineFrameInfo &MFI = MF->getFrameInfo();
-  BitVector PR = MFI.getPristineRegs(*MF);
-  for (int I = PR.find_first(); I>0; I = PR.find_next(I)) {
-    for (MCSubRegIterator SubRegs(I, TRI, /*IncludeSelf=*/true);
-         SubRegs.isValid(); ++SubRegs)
-      regsLive.insert(*SubRegs);
+  if (!Quick) {
+    const MachineFrameInfo &MFI = MF->getFrameInfo();
+    BitVector PR = MFI.getPristineRegs(*MF);
+    for (int I = PR.find_first(); I>0; I = PR.find_next(I)) {
+      for (MCSubRegIterator SubRegs(I, TRI, /*IncludeSelf=*/true);
+           SubRegs.isValid(); ++SubRegs)
+        regsLive.insert(*SubRegs);
+    }
   }
 
   regsKilled.clear();
@@ -943,7 +961,7 @@ MachineVerifier::visitMachineOperand(const MachineOperand *MO, unsigned MONum) {
     const unsigned Reg = MO->getReg();
     if (!Reg)
       return;
-    if (MRI->tracksLiveness() && !MI->isDebugValue())
+    if (MRI->tracksLiveness() && !MI->isDebugValue() && !Quick)
       checkLiveness(MO, MONum);
 
     // Verify the consistency of tied operands.
@@ -1357,6 +1375,10 @@ void MachineVerifier::visitMachineInstrAfter(const MachineInstr *MI) {
 // Normal stand-alone instructions are also considered 'bundles', and this
 // function is called for all of them.
 void MachineVerifier::visitMachineBundleAfter(const MachineInstr *MI) {
+  if (Quick) {
+    regMasks.clear();
+    return;
+  }
   BBInfo &MInfo = MBBInfoMap[MI->getParent()];
   set_union(MInfo.regsKilled, regsKilled);
   set_subtract(regsLive, regsKilled); regsKilled.clear();
@@ -32,7 +32,11 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetLowering.h"
 #include "llvm/Target/TargetOptions.h"
@@ -78,6 +82,12 @@ namespace {
                              "slicing"),
                     cl::init(false));
 
+  static cl::opt<bool>
+  CombinerProfile("combiner-profile", cl::Hidden, cl::init(false),
+                  cl::desc("Report how often and for how long the DAG "
+                           "combiner visited each opcode, and how often it "
+                           "succeeded"));
+
   static cl::opt<bool>
     MaySplitLoadIndex("combiner-split-load-index", cl::Hidden, cl::init(true),
                       cl::desc("DAG combiner may split indexing from loads"));
@@ -526,6 +536,69 @@ public:
     DC.removeFromWorklist(N);
   }
 };
+
+/// Per-opcode visit counts and times collected by -combiner-profile. They are
+/// accumulated over every DAGCombiner run in the process and printed to the
+/// info output file at shutdown.
+class CombinerProfileInfo {
+  struct OpcodeInfo {
+    std::string Name;
+    unsigned Visits;
+    unsigned Fired;
+    TimeRecord Time;
+    OpcodeInfo() : Visits(0), Fired(0) {}
+  };
+
+  sys::SmartMutex<true> Lock;
+  DenseMap<unsigned, OpcodeInfo> Opcodes;
+
+public:
+  /// Make sure there is an entry for the opcode of N. This has to happen
+  /// before N is combined, since N may be deleted by then.
+  void addOpcode(SDNode *N, const SelectionDAG &DAG) {
+    sys::SmartScopedLock<true> Guard(Lock);
+    OpcodeInfo &Info = Opcodes[N->getOpcode()];
+    if (Info.Name.empty())
+      Info.Name = N->getOperationName(&DAG);
+  }
+
+  void recordVisit(unsigned Opcode, bool Fired, const TimeRecord &Time) {
+    sys::SmartScopedLock<true> Guard(Lock);
+    OpcodeInfo &Info = Opcodes[Opcode];
+    ++Info.Visits;
+    if (Fired)
+      ++Info.Fired;
+    Info.Time += Time;
+  }
+
+  ~CombinerProfileInfo() {
+    if (Opcodes.empty())
+      return;
+
+    std::vector<const OpcodeInfo *> Sorted;
+    for (auto &Entry : Opcodes)
+      Sorted.push_back(&Entry.second);
+    std::sort(Sorted.begin(), Sorted.end(),
+              [](const OpcodeInfo *LHS, const OpcodeInfo *RHS) {
+      return RHS->Time < LHS->Time;
+    });
+
+    std::unique_ptr<raw_fd_ostream> OutStream = CreateInfoOutputFile();
+    raw_ostream &OS = *OutStream;
+    OS << "===" << std::string(73, '-') << "===\n"
+       << "                          ... DAG Combiner Profile ...\n"
+       << "===" << std::string(73, '-') << "===\n\n"
+       << "    Visits      Fired     Failed    Wall Time  Opcode\n";
+    for (const OpcodeInfo *Info : Sorted)
+      OS << format("%10u %10u %10u %12.4f  ", Info->Visits, Info->Fired,
+                   Info->Visits - Info->Fired, Info->Time.getWallTime())
+         << Info->Name << '\n';
+    OS << '\n';
+    OS.flush();
+  }
+};
+
+static ManagedStatic<CombinerProfileInfo> CombinerProfileData;
 }
 
 //===----------------------------------------------------------------------===//
@@ -1300,7 +1373,17 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
       if (!CombinedNodes.count(ChildN.getNode()))
         AddToWorklist(ChildN.getNode());
 
-    SDValue RV = combine(N);
+    SDValue RV;
+    if (CombinerProfile) {
+      unsigned Opcode = N->getOpcode();
+      CombinerProfileData->addOpcode(N, DAG);
+      TimeRecord Start = TimeRecord::getCurrentTime(true);
+      RV = combine(N);
+      TimeRecord Time = TimeRecord::getCurrentTime(false);
+      Time -= Start;
+      CombinerProfileData->recordVisit(Opcode, RV.getNode(), Time);
+    } else
+      RV = combine(N);
 
     if (!RV.getNode())
       continue;
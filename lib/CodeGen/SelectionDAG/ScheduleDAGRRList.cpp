@@ -52,6 +52,12 @@ static RegisterScheduler
                          "order when possible",
                          createSourceListDAGScheduler);
 
+static RegisterScheduler
+  heapListDAGScheduler("list-heap",
+                       "Bottom-up source order list scheduling with a heap "
+                       "ordered ready queue, for very large blocks",
+                       createHeapListDAGScheduler);
+
 static RegisterScheduler
   hybridListDAGScheduler("list-hybrid",
                          "Bottom-up register pressure aware list scheduling "
@@ -199,6 +205,8 @@ public:
   void AddPred(SUnit *SU, const SDep &D) {
     Topo.AddPred(SU, D.getSUnit());
     SU->addPred(D);
+    AvailableQueue->changedEdges(SU);
+    AvailableQueue->changedEdges(D.getSUnit());
   }
 
   /// RemovePred - removes a predecessor edge from SUnit SU.
@@ -207,6 +215,8 @@ public:
   void RemovePred(SUnit *SU, const SDep &D) {
     Topo.RemovePred(SU, D.getSUnit());
     SU->removePred(D);
+    AvailableQueue->changedEdges(SU);
+    AvailableQueue->changedEdges(D.getSUnit());
   }
 
 private:
@@ -1813,6 +1823,98 @@ HybridBURRPriorityQueue;
 
 typedef RegReductionPriorityQueue<ilp_ls_rr_sort>
 ILPBURRPriorityQueue;
+
+/// HeapRegReductionPriorityQueue - A bottom-up source order queue for very
+/// large blocks. The dynamic pickers above rescan the whole ready list on
+/// every pop, which is quadratic when thousands of nodes are ready at once.
+/// This queue instead snapshots a static priority key for each node when it
+/// becomes available and keeps the ready list as a binary heap. A node's
+/// successors are all scheduled by the time it is pushed, so its height,
+/// depth and closest successor normally stay the same while it waits in the
+/// queue. When resolving a physical register dependency adds or removes an
+/// edge of a queued node, or updates its Sethi-Ullman number, the node is
+/// pushed again with a fresh key. Removed nodes and superseded entries are
+/// dropped lazily when they reach the top of the heap.
+class HeapRegReductionPriorityQueue : public RegReductionPQBase {
+  struct HeapEntry {
+    SUnit *SU;
+    unsigned QueueId;
+    bool ScheduleLow;
+    bool HasPhysRegDefs;
+    unsigned Order;
+    unsigned Priority;
+    unsigned ClosestSucc;
+    unsigned Scratches;
+    unsigned Height;
+    unsigned Depth;
+  };
+
+  /// heap_entry_less - Return true if right should be scheduled before left,
+  /// mirroring the tie-breaking of src_ls_rr_sort and BURRSort.
+  struct heap_entry_less {
+    bool operator()(const HeapEntry &left, const HeapEntry &right) const;
+  };
+
+  std::vector<HeapEntry> Heap;
+  unsigned NumQueued;
+
+  void pushEntry(SUnit *U);
+  void dropStaleEntries();
+
+public:
+  HeapRegReductionPriorityQueue(MachineFunction &mf,
+                                const TargetInstrInfo *tii,
+                                const TargetRegisterInfo *tri)
+    : RegReductionPQBase(mf, false, false, true, tii, tri, nullptr),
+      NumQueued(0) {}
+
+  bool isBottomUp() const override { return true; }
+
+  void releaseState() override {
+    RegReductionPQBase::releaseState();
+    Heap.clear();
+    NumQueued = 0;
+  }
+
+  bool empty() const override { return NumQueued == 0; }
+
+  void push(SUnit *U) override;
+
+  SUnit *pop() override;
+
+  void remove(SUnit *SU) override {
+    assert(NumQueued && "Queue is empty!");
+    assert(SU->NodeQueueId != 0 && "Not in queue!");
+    SU->NodeQueueId = 0;
+    --NumQueued;
+  }
+
+  void updateNode(const SUnit *SU) override {
+    RegReductionPQBase::updateNode(SU);
+    changedEdges(const_cast<SUnit *>(SU));
+  }
+
+  void changedEdges(SUnit *SU) override {
+    // Supersede the node's entry with one keyed on its current priority.
+    if (SU->NodeQueueId)
+      pushEntry(SU);
+  }
+
+#if !defined(NDEBUG) || defined(LLVM_ENABLE_DUMP)
+  void dump(ScheduleDAG *DAG) const override {
+    std::vector<HeapEntry> DumpHeap = Heap;
+    while (!DumpHeap.empty()) {
+      std::pop_heap(DumpHeap.begin(), DumpHeap.end(), heap_entry_less());
+      const HeapEntry &E = DumpHeap.back();
+      if (E.SU->NodeQueueId == E.QueueId) {
+        dbgs() << "Height " << E.Height << ": ";
+        E.SU->dump(DAG);
+      }
+      DumpHeap.pop_back();
+    }
+  }
+#endif
+};
 } // end anonymous namespace
 
 //===----------------------------------------------------------------------===//
@@ -2504,6 +2606,83 @@ bool src_ls_rr_sort::operator()(SUnit *left, SUnit *right) const {
   return BURRSort(left, right, SPQ);
 }
 
+// Static approximation of src_ls_rr_sort. Calls and latency are not
+// special-cased because those checks depend on the current cycle.
+bool HeapRegReductionPriorityQueue::heap_entry_less::
+operator()(const HeapEntry &left, const HeapEntry &right) const {
+  if (left.ScheduleLow != right.ScheduleLow)
+    return left.ScheduleLow < right.ScheduleLow;
+
+  if ((left.Order || right.Order) && left.Order != right.Order)
+    return left.Order != 0 && (left.Order < right.Order || right.Order == 0);
+
+  if (!DisableSchedPhysRegJoin && left.HasPhysRegDefs != right.HasPhysRegDefs)
+    return left.HasPhysRegDefs < right.HasPhysRegDefs;
+
+  if (left.Priority != right.Priority)
+    return left.Priority > right.Priority;
+
+  if (left.ClosestSucc != right.ClosestSucc)
+    return left.ClosestSucc < right.ClosestSucc;
+
+  if (left.Scratches != right.Scratches)
+    return left.Scratches > right.Scratches;
+
+  if (left.Height != right.Height)
+    return left.Height > right.Height;
+
+  if (left.Depth != right.Depth)
+    return left.Depth < right.Depth;
+
+  return left.QueueId > right.QueueId;
+}
+
+void HeapRegReductionPriorityQueue::push(SUnit *U) {
+  assert(!U->NodeQueueId && "Node in the queue already");
+  ++NumQueued;
+  pushEntry(U);
+}
+
+void HeapRegReductionPriorityQueue::pushEntry(SUnit *U) {
+  U->NodeQueueId = ++CurQueueId;
+
+  HeapEntry E;
+  E.SU = U;
+  E.QueueId = U->NodeQueueId;
+  E.ScheduleLow = U->isScheduleLow;
+  E.HasPhysRegDefs = U->hasPhysRegDefs;
+  E.Order = getNodeOrdering(U);
+  E.Priority = getNodePriority(U);
+  E.ClosestSucc = closestSucc(U);
+  E.Scratches = calcMaxScratches(U);
+  E.Height = U->getHeight();
+  E.Depth = U->getDepth();
+  Heap.push_back(E);
+  std::push_heap(Heap.begin(), Heap.end(), heap_entry_less());
+}
+
+void HeapRegReductionPriorityQueue::dropStaleEntries() {
+  // An entry is stale if its node was removed, or was removed and pushed
+  // again with a new queue id.
+  while (!Heap.empty() &&
+         Heap.front().SU->NodeQueueId != Heap.front().QueueId) {
+    std::pop_heap(Heap.begin(), Heap.end(), heap_entry_less());
+    Heap.pop_back();
+  }
+}
+
+SUnit *HeapRegReductionPriorityQueue::pop() {
+  dropStaleEntries();
+  if (Heap.empty()) return nullptr;
+
+  std::pop_heap(Heap.begin(), Heap.end(), heap_entry_less());
+  SUnit *V = Heap.back().SU;
+  Heap.pop_back();
+  V->NodeQueueId = 0;
+  --NumQueued;
+  return V;
+}
+
 // If the time between now and when the instruction will be ready can cover
 // the spill code, then avoid adding it to the ready queue. This gives long
 // stalls highest priority and allows hoisting across calls. It should also
@@ -2988,6 +3167,20 @@ llvm::createSourceListDAGScheduler(SelectionDAGISel *IS,
   return SD;
 }
 
+llvm::ScheduleDAGSDNodes *
+llvm::createHeapListDAGScheduler(SelectionDAGISel *IS,
+                                 CodeGenOpt::Level OptLevel) {
+  const TargetSubtargetInfo &STI = IS->MF->getSubtarget();
+  const TargetInstrInfo *TII = STI.getInstrInfo();
+  const TargetRegisterInfo *TRI = STI.getRegisterInfo();
+
+  HeapRegReductionPriorityQueue *PQ =
+    new HeapRegReductionPriorityQueue(*IS->MF, TII, TRI);
+  ScheduleDAGRRList *SD = new ScheduleDAGRRList(*IS->MF, false, PQ, OptLevel);
+  PQ->setScheduleDAG(SD);
+  return SD;
+}
+
 llvm::ScheduleDAGSDNodes *
 llvm::createHybridListDAGScheduler(SelectionDAGISel *IS,
                                    CodeGenOpt::Level OptLevel) {
@@ -184,6 +184,12 @@ UseMBPI("use-mbpi",
         cl::desc("use Machine Branch Probability Info"),
         cl::init(true), cl::Hidden);
 
+static cl::opt<unsigned>
+HeapSchedThreshold("sched-heap-threshold", cl::Hidden, cl::init(0),
+                   cl::desc("Use the heap based list scheduler for blocks "
+                            "whose DAG has more than this many nodes "
+                            "(0 = never)"));
+
 #ifndef NDEBUG
 static cl::opt<std::string>
 FilterDAGBasicBlockName("filter-view-dags", cl::Hidden,
@@ -304,6 +310,11 @@ namespace llvm {
       return SchedulerCtor(IS, OptLevel);
     }
 
+    // The list schedulers rescan the ready list on every pop. Keep huge
+    // blocks out of them so scheduling time stays close to linear.
+    if (HeapSchedThreshold && IS->CurDAG->allnodes_size() > HeapSchedThreshold)
+      return createHeapListDAGScheduler(IS, OptLevel);
+
     if (OptLevel == CodeGenOpt::None ||
         (ST.enableMachineScheduler() && ST.enableMachineSchedDefaultSched()) ||
         TLI->getSchedulingPreference() == Sched::Source)
@@ -92,6 +92,11 @@ static cl::opt<bool> VerifyMachineCode("verify-machineinstrs", cl::Hidden,
     cl::desc("Verify generated machine code"),
     cl::init(false),
     cl::ZeroOrMore);
+static cl::opt<bool> VerifyMachineCodeQuick("verify-machineinstrs-quick",
+    cl::Hidden,
+    cl::desc("Verify generated machine code, skipping the liveness checks"),
+    cl::init(false),
+    cl::ZeroOrMore);
 
 static cl::opt<std::string>
 PrintMachineInstrs("print-machineinstrs", cl::ValueOptional,
@@ -415,6 +420,8 @@ void TargetPassConfig::addPrintPass(const std::string &Banner) {
 void TargetPassConfig::addVerifyPass(const std::string &Banner) {
   if (VerifyMachineCode)
     PM->add(createMachineVerifierPass(Banner));
+  else if (VerifyMachineCodeQuick)
+    PM->add(createMachineVerifierPass(Banner, /*Quick=*/true));
 }
 
 /// Add common target configurable passes that perform LLVM IR to IR transforms
@@ -0,0 +1,421 @@
+//===-- MappedSummaryIndex.cpp - Mappable summary index -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the writer and the in place reader of the mapped
+// summary index format.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/MappedSummaryIndex.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+using namespace llvm;
+
+const char MappedSummaryIndex::Magic[8] = {'L', 'L', 'V', 'M', 'M', 'S',
+                                           'I', 'X'};
+
+// The tables are written and mapped as arrays, so the entries must not have
+// any padding.
+static_assert(sizeof(MappedSummaryIndex::Header) == 40, "Unexpected padding");
+static_assert(sizeof(MappedSummaryIndex::ModuleEntry) == 44,
+              "Unexpected padding");
+static_assert(sizeof(MappedSummaryIndex::SummaryEntry) == 52,
+              "Unexpected padding");
+static_assert(sizeof(MappedSummaryIndex::CallEntry) == 20,
+              "Unexpected padding");
+
+template <typename T>
+static void writeTable(raw_ostream &OS, const std::vector<T> &Table) {
+  OS.write(reinterpret_cast<const char *>(Table.data()),
+           Table.size() * sizeof(T));
+}
+
+void llvm::writeMappedSummaryIndex(const ModuleSummaryIndex &Index,
+                                   raw_ostream &OS) {
+  typedef MappedSummaryIndex::ModuleEntry ModuleEntry;
+  typedef MappedSummaryIndex::SummaryEntry SummaryEntry;
+  typedef MappedSummaryIndex::CallEntry CallEntry;
+
+  // Number the modules in path order.
+  std::vector<StringRef> Paths;
+  for (auto &MPI : Index.modulePaths())
+    Paths.push_back(MPI.first());
+  std::sort(Paths.begin(), Paths.end());
+  StringMap<uint32_t> ModuleNumbers;
+  std::vector<ModuleEntry> Modules(Paths.size());
+  std::string Strings;
+  for (uint32_t I = 0, E = Paths.size(); I != E; ++I) {
+    ModuleNumbers[Paths[I]] = I;
+    ModuleEntry &M = Modules[I];
+    M.PathOffset = Strings.size();
+    M.PathSize = Paths[I].size();
+    Strings += Paths[I];
+    const auto &Info = Index.modulePaths().find(Paths[I])->second;
+    M.ModuleId = Info.first;
+    for (unsigned H = 0; H != 5; ++H)
+      M.Hash[H] = Info.second[H];
+  }
+
+  // Aliases record the GUID of their aliasee.
+  DenseMap<const GlobalValueSummary *, GlobalValue::GUID> SummaryGUIDs;
+  for (auto &GlobalList : Index)
+    for (auto &Summary : GlobalList.second)
+      SummaryGUIDs[Summary.get()] = GlobalList.first;
+
+  // The index iterates in GUID order, the summaries of a GUID are ordered by
+  // module to make the output deterministic.
+  std::vector<SummaryEntry> Summaries;
+  std::vector<MappedSummaryIndex::RefEntry> Refs;
+  std::vector<CallEntry> Calls;
+  uint64_t MaxProfileCount = 0;
+  std::vector<std::pair<uint32_t, GlobalValueSummary *>> SummaryList;
+  for (auto &GlobalList : Index) {
+    SummaryList.clear();
+    for (auto &Summary : GlobalList.second)
+      SummaryList.push_back(std::make_pair(
+          ModuleNumbers.lookup(Summary->modulePath()), Summary.get()));
+    std::stable_sort(SummaryList.begin(), SummaryList.end(),
+                     [](const std::pair<uint32_t, GlobalValueSummary *> &A,
+                        const std::pair<uint32_t, GlobalValueSummary *> &B) {
+                       return A.first < B.first;
+                     });
+
+    for (auto &MS : SummaryList) {
+      GlobalValueSummary *Summary = MS.second;
+      SummaryEntry S = SummaryEntry();
+      S.GUID = GlobalList.first;
+      S.OriginalName = Summary->getOriginalName();
+      S.Module = MS.first;
+      S.Kind = Summary->getSummaryKind();
+      S.Linkage = Summary->linkage();
+      S.HasSection = Summary->hasSection();
+
+      S.RefsBegin = Refs.size();
+      S.NumRefs = Summary->refs().size();
+      for (auto &VI : Summary->refs())
+        Refs.push_back(MappedSummaryIndex::RefEntry(VI.getGUID()));
+
+      if (auto *AS = dyn_cast<AliasSummary>(Summary))
+        S.AliaseeGUID = SummaryGUIDs.lookup(&AS->getAliasee());
+
+      S.CallsBegin = Calls.size();
+      if (auto *FS = dyn_cast<FunctionSummary>(Summary)) {
+        S.InstCount = FS->instCount();
+        S.NumCalls = FS->calls().size();
+        for (auto &Edge : FS->calls()) {
+          CallEntry C;
+          C.Callee = Edge.first.getGUID();
+          C.ProfileCount = Edge.second.ProfileCount;
+          MaxProfileCount = std::max(MaxProfileCount, Edge.second.ProfileCount);
+          C.CallsiteCount = Edge.second.CallsiteCount;
+          Calls.push_back(C);
+        }
+      }
+      Summaries.push_back(S);
+    }
+  }
+
+  // Group the summary numbers by module.
+  std::vector<support::ulittle32_t> ModuleSummaries(Summaries.size());
+  for (const SummaryEntry &S : Summaries)
+    Modules[S.Module].NumSummaries = Modules[S.Module].NumSummaries + 1;
+  uint32_t Begin = 0;
+  for (ModuleEntry &M : Modules) {
+    M.SummariesBegin = Begin;
+    Begin += M.NumSummaries;
+    M.NumSummaries = 0;
+  }
+  for (uint32_t I = 0, E = Summaries.size(); I != E; ++I) {
+    ModuleEntry &M = Modules[Summaries[I].Module];
+    ModuleSummaries[M.SummariesBegin + M.NumSummaries] = I;
+    M.NumSummaries = M.NumSummaries + 1;
+  }
+
+  MappedSummaryIndex::Header H;
+  memcpy(H.Magic, MappedSummaryIndex::Magic, sizeof(H.Magic));
+  H.Version = MappedSummaryIndex::Version;
+  H.NumModules = Modules.size();
+  H.NumSummaries = Summaries.size();
+  H.NumRefs = Refs.size();
+  H.NumCalls = Calls.size();
+  H.StringTableSize = Strings.size();
+  H.MaxProfileCount = MaxProfileCount;
+  OS.write(reinterpret_cast<const char *>(&H), sizeof(H));
+  writeTable(OS, Modules);
+  writeTable(OS, Summaries);
+  writeTable(OS, ModuleSummaries);
+  writeTable(OS, Refs);
+  writeTable(OS, Calls);
+  OS << Strings;
+}
+
+static Error malformed(const Twine &Msg) {
+  return make_error<StringError>("malformed mapped summary index: " + Msg,
+                                 make_error_code(errc::invalid_argument));
+}
+
+bool MappedSummaryIndex::isMappedSummaryIndex(MemoryBufferRef Buffer) {
+  return Buffer.getBuffer().startswith(StringRef(Magic, sizeof(Magic)));
+}
+
+// Carve a table of \p Count entries off the front of \p Data.
+template <typename T>
+static bool takeTable(StringRef &Data, uint64_t Count, ArrayRef<T> &Table) {
+  if (Count > Data.size() / sizeof(T))
+    return false;
+  Table = makeArrayRef(reinterpret_cast<const T *>(Data.data()), Count);
+  Data = Data.drop_front(Count * sizeof(T));
+  return true;
+}
+
+Expected<std::unique_ptr<MappedSummaryIndex>>
+MappedSummaryIndex::create(MemoryBufferRef Buffer) {
+  StringRef Data = Buffer.getBuffer();
+  if (!isMappedSummaryIndex(Buffer) || Data.size() < sizeof(Header))
+    return malformed("bad header");
+  auto *H = reinterpret_cast<const Header *>(Data.data());
+  if (H->Version != Version)
+    return malformed("unsupported version " + Twine(H->Version));
+  Data = Data.drop_front(sizeof(Header));
+
+  std::unique_ptr<MappedSummaryIndex> Index(new MappedSummaryIndex());
+  if (!takeTable(Data, H->NumModules, Index->Modules) ||
+      !takeTable(Data, H->NumSummaries, Index->Summaries) ||
+      !takeTable(Data, H->NumSummaries, Index->ModuleSummaries) ||
+      !takeTable(Data, H->NumRefs, Index->Refs) ||
+      !takeTable(Data, H->NumCalls, Index->Calls))
+    return malformed("truncated tables");
+  if (Data.size() != H->StringTableSize)
+    return malformed("bad string table size");
+  Index->Strings = Data;
+  Index->MaxProfileCount = H->MaxProfileCount;
+
+  // Check the ranges and the table order once, so that the accessors can use
+  // the ranges unchecked and binary search the tables. This reads the tables
+  // sequentially, the records are not decoded.
+  StringRef PrevPath;
+  for (const ModuleEntry &M : Index->Modules) {
+    if (uint64_t(M.PathOffset) + M.PathSize > Index->Strings.size() ||
+        uint64_t(M.SummariesBegin) + M.NumSummaries > H->NumSummaries)
+      return malformed("module entry out of range");
+    StringRef Path = Index->getModulePath(M);
+    if (&M != Index->Modules.begin() && Path <= PrevPath)
+      return malformed("modules not sorted by path");
+    PrevPath = Path;
+  }
+  for (const SummaryEntry &S : Index->Summaries) {
+    if (S.Module >= H->NumModules || S.Kind > GlobalValueSummary::GlobalVarKind ||
+        uint64_t(S.RefsBegin) + S.NumRefs > H->NumRefs ||
+        uint64_t(S.CallsBegin) + S.NumCalls > H->NumCalls)
+      return malformed("summary entry out of range");
+    if (&S != Index->Summaries.begin()) {
+      const SummaryEntry &Prev = (&S)[-1];
+      if (S.GUID < Prev.GUID ||
+          (S.GUID == Prev.GUID && S.Module <= Prev.Module))
+        return malformed("summaries not sorted by GUID and module");
+    }
+  }
+  for (const ModuleEntry &M : Index->Modules) {
+    uint32_t ModuleNo = &M - Index->Modules.begin();
+    for (uint32_t SummaryNo : Index->moduleSummaries(M)) {
+      if (SummaryNo >= H->NumSummaries)
+        return malformed("summary number out of range");
+      if (Index->Summaries[SummaryNo].Module != ModuleNo)
+        return malformed("summary listed under the wrong module");
+    }
+  }
+
+  // Materializing an alias links it to its aliasee, which must be defined in
+  // the same module.
+  for (const SummaryEntry &S : Index->Summaries)
+    if (S.Kind == GlobalValueSummary::AliasKind &&
+        !llvm::any_of(Index->findSummaries(S.AliaseeGUID),
+                      [&](const SummaryEntry &A) {
+                        return A.Module == S.Module;
+                      }))
+      return malformed("alias without an aliasee");
+  return std::move(Index);
+}
+
+Expected<std::unique_ptr<MappedSummaryIndex>>
+MappedSummaryIndex::createFromFile(StringRef Path) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+      MemoryBuffer::getFile(Path, /*FileSize=*/-1,
+                            /*RequiresNullTerminator=*/false);
+  if (std::error_code EC = BufferOrErr.getError())
+    return errorCodeToError(EC);
+  auto IndexOrErr = create((*BufferOrErr)->getMemBufferRef());
+  if (IndexOrErr)
+    (*IndexOrErr)->OwnedBuffer = std::move(*BufferOrErr);
+  return IndexOrErr;
+}
+
+ModuleHash MappedSummaryIndex::getModuleHash(const ModuleEntry &M) const {
+  ModuleHash Hash;
+  for (unsigned I = 0; I != 5; ++I)
+    Hash[I] = M.Hash[I];
+  return Hash;
+}
+
+const MappedSummaryIndex::ModuleEntry *
+MappedSummaryIndex::findModule(StringRef Path) const {
+  auto I = std::lower_bound(Modules.begin(), Modules.end(), Path,
+                            [&](const ModuleEntry &M, StringRef Path) {
+                              return getModulePath(M) < Path;
+                            });
+  if (I == Modules.end() || getModulePath(*I) != Path)
+    return nullptr;
+  return &*I;
+}
+
+namespace {
+struct SummaryGUIDLess {
+  bool operator()(const MappedSummaryIndex::SummaryEntry &S,
+                  GlobalValue::GUID GUID) const {
+    return S.GUID < GUID;
+  }
+  bool operator()(GlobalValue::GUID GUID,
+                  const MappedSummaryIndex::SummaryEntry &S) const {
+    return GUID < S.GUID;
+  }
+};
+} // end anonymous namespace
+
+ArrayRef<MappedSummaryIndex::SummaryEntry>
+MappedSummaryIndex::findSummaries(GlobalValue::GUID GUID) const {
+  auto Range = std::equal_range(Summaries.begin(), Summaries.end(), GUID,
+                                SummaryGUIDLess());
+  return makeArrayRef(Range.first, Range.second);
+}
+
+const MappedSummaryIndex::SummaryEntry *
+MappedSummaryIndex::findSummaryInModule(GlobalValue::GUID GUID,
+                                        StringRef ModulePath) const {
+  const ModuleEntry *M = findModule(ModulePath);
+  if (!M)
+    return nullptr;
+  uint32_t ModuleNo = M - Modules.begin();
+  for (const SummaryEntry &S : findSummaries(GUID))
+    if (S.Module == ModuleNo)
+      return &S;
+  return nullptr;
+}
+
+std::unique_ptr<ModuleSummaryIndex> MappedSummaryIndex::buildIndex(
+    ArrayRef<const SummaryEntry *> Selected) const {
+  auto Index = llvm::make_unique<ModuleSummaryIndex>();
+
+  // The summaries point to the module paths owned by the index.
+  std::vector<StringRef> ModulePaths;
+  ModulePaths.reserve(Modules.size());
+  for (const ModuleEntry &M : Modules)
+    ModulePaths.push_back(
+        Index->addModulePath(getModulePath(M), M.ModuleId, getModuleHash(M))
+            ->first());
+
+  std::vector<std::pair<AliasSummary *, GlobalValue::GUID>> Aliases;
+  for (const SummaryEntry *S : Selected) {
+    GlobalValueSummary::GVFlags Flags(
+        static_cast<GlobalValue::LinkageTypes>(S->Linkage), S->HasSection);
+    std::unique_ptr<GlobalValueSummary> Summary;
+    switch (S->Kind) {
+    case GlobalValueSummary::AliasKind: {
+      auto AS = llvm::make_unique<AliasSummary>(Flags);
+      Aliases.push_back(std::make_pair(AS.get(), GlobalValue::GUID(
+                                                     S->AliaseeGUID)));
+      Summary = std::move(AS);
+      break;
+    }
+    case GlobalValueSummary::FunctionKind: {
+      auto FS = llvm::make_unique<FunctionSummary>(Flags, S->InstCount);
+      for (const CallEntry &C : calls(*S))
+        FS->addCallGraphEdge(GlobalValue::GUID(C.Callee),
+                             CalleeInfo(C.CallsiteCount, C.ProfileCount));
+      Summary = std::move(FS);
+      break;
+    }
+    case GlobalValueSummary::GlobalVarKind:
+      Summary = llvm::make_unique<GlobalVarSummary>(Flags);
+      break;
+    }
+    for (uint64_t Ref : refs(*S))
+      Summary->addRefEdge(GlobalValue::GUID(Ref));
+    Summary->setOriginalName(S->OriginalName);
+    Summary->setModulePath(ModulePaths[S->Module]);
+    Index->addGlobalValueSummary(S->GUID, std::move(Summary));
+  }
+
+  for (auto &Alias : Aliases) {
+    auto *AliaseeInModule =
+        Index->findSummaryInModule(Alias.second, Alias.first->modulePath());
+    assert(AliaseeInModule && "create() checked that the aliasee exists");
+    Alias.first->setAliasee(AliaseeInModule);
+  }
+  Index->finalize();
+  return Index;
+}
+
+std::unique_ptr<ModuleSummaryIndex> MappedSummaryIndex::materialize() const {
+  std::vector<const SummaryEntry *> Selected;
+  Selected.reserve(Summaries.size());
+  for (const SummaryEntry &S : Summaries)
+    Selected.push_back(&S);
+  return buildIndex(Selected);
+}
+
+std::unique_ptr<ModuleSummaryIndex>
+MappedSummaryIndex::materializeForModule(StringRef ModulePath) const {
+  SmallPtrSet<const SummaryEntry *, 32> Added;
+  DenseSet<const SummaryEntry *> Walked;
+  std::vector<const SummaryEntry *> Worklist;
+
+  // The import of a function looks at the summaries of its callees, which
+  // may be imported in turn, and at the summaries of the values it
+  // references, which are not walked further. An alias stands for its
+  // aliasee.
+  auto Add = [&](const SummaryEntry &S, bool Walk) {
+    const SummaryEntry *Aliasee = nullptr;
+    if (S.Kind == GlobalValueSummary::AliasKind)
+      for (const SummaryEntry &A : findSummaries(S.AliaseeGUID))
+        if (A.Module == S.Module)
+          Aliasee = &A;
+    for (const SummaryEntry *E : {&S, Aliasee}) {
+      if (!E)
+        continue;
+      Added.insert(E);
+      if (Walk && Walked.insert(E).second)
+        Worklist.push_back(E);
+    }
+  };
+
+  if (const ModuleEntry *M = findModule(ModulePath))
+    for (uint32_t SummaryNo : moduleSummaries(*M))
+      Add(Summaries[SummaryNo], /*Walk=*/true);
+
+  while (!Worklist.empty()) {
+    const SummaryEntry &S = *Worklist.back();
+    Worklist.pop_back();
+    for (const CallEntry &C : calls(S))
+      for (const SummaryEntry &Callee : findSummaries(C.Callee))
+        Add(Callee, /*Walk=*/true);
+    for (uint64_t Ref : refs(S))
+      for (const SummaryEntry &Referenced : findSummaries(Ref))
+        Add(Referenced, /*Walk=*/false);
+  }
+
+  // Keep the table order, which is the GUID order of the index.
+  std::vector<const SummaryEntry *> Selected(Added.begin(), Added.end());
+  std::sort(Selected.begin(), Selected.end());
+  return buildIndex(Selected);
+}
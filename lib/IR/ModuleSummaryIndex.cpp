@@ -16,11 +16,38 @@
 #include "llvm/ADT/StringMap.h"
 using namespace llvm;
 
+void GlobalValueSummary::flattenEdges(BumpPtrAllocator &Alloc) {
+  // Copy each list into the allocator and release its heap buffer. A summary
+  // moved over from another index has already been flattened.
+  if (!RefEdgeList.empty()) {
+    ValueInfo *RefMem = Alloc.Allocate<ValueInfo>(RefEdgeList.size());
+    std::uninitialized_copy(RefEdgeList.begin(), RefEdgeList.end(), RefMem);
+    Refs = makeArrayRef(RefMem, RefEdgeList.size());
+    std::vector<ValueInfo>().swap(RefEdgeList);
+  }
+
+  auto *FS = dyn_cast<FunctionSummary>(this);
+  if (!FS || FS->CallGraphEdgeList.empty())
+    return;
+  auto &CallList = FS->CallGraphEdgeList;
+  auto *CallMem = Alloc.Allocate<FunctionSummary::EdgeTy>(CallList.size());
+  std::uninitialized_copy(CallList.begin(), CallList.end(), CallMem);
+  FS->Calls = makeArrayRef(CallMem, CallList.size());
+  std::vector<FunctionSummary::EdgeTy>().swap(CallList);
+}
+
 // Create the combined module index/summary from multiple
 // per-module instances.
 void ModuleSummaryIndex::mergeFrom(std::unique_ptr<ModuleSummaryIndex> Other,
                                    uint64_t NextModuleId) {
 
+  // The edges of the summaries we take over live in the other index's
+  // allocator; keep it alive.
+  MergedEdgeAllocators.push_back(
+      llvm::make_unique<BumpPtrAllocator>(std::move(Other->EdgeAllocator)));
+  for (auto &Alloc : Other->MergedEdgeAllocators)
+    MergedEdgeAllocators.push_back(std::move(Alloc));
+
   StringRef ModPath;
   for (auto &OtherGlobalValSummaryLists : *Other) {
     GlobalValue::GUID ValueGUID = OtherGlobalValSummaryLists.first;
@@ -54,15 +81,12 @@ void ModuleSummaryIndex::mergeFrom(std::unique_ptr<ModuleSummaryIndex> Other,
 }
 
 void ModuleSummaryIndex::removeEmptySummaryEntries() {
-  for (auto MI = begin(), MIE = end(); MI != MIE;) {
+  GlobalValueMap.remove_if([](const GlobalValueSummaryMapTy::value_type &V) {
     // Only expect this to be called on a per-module index, which has a single
     // entry per value entry list.
-    assert(MI->second.size() == 1);
-    if (!MI->second[0])
-      MI = GlobalValueMap.erase(MI);
-    else
-      ++MI;
-  }
+    assert(V.second.size() == 1);
+    return !V.second[0];
+  });
 }
 
 // Collect for the given module the list of function it defines
@@ -75,6 +75,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cstdarg>
@@ -82,6 +83,10 @@ using namespace llvm;
 
 static cl::opt<bool> VerifyDebugInfo("verify-debug-info", cl::init(true));
 
+static cl::opt<unsigned> VerifyThreads(
+    "verify-threads", cl::Hidden, cl::init(1),
+    cl::desc("Number of threads verifyModule uses to verify functions"));
+
 namespace {
 struct VerifierSupport {
   raw_ostream *OS;
@@ -271,6 +276,19 @@ public:
 
   bool hasBrokenDebugInfo() const { return BrokenDebugInfo; }
 
+  /// Fold in the module level state collected by \p Other while it verified
+  /// a subset of the functions of the module, so that verify(Module) sees
+  /// all of them.
+  void mergeFunctionState(const Verifier &Other) {
+    BrokenDebugInfo |= Other.BrokenDebugInfo;
+    CUVisited.insert(Other.CUVisited.begin(), Other.CUVisited.end());
+    for (const auto &Info : Other.FrameEscapeInfo) {
+      auto &Entry = FrameEscapeInfo[Info.first];
+      Entry.first = std::max(Entry.first, Info.second.first);
+      Entry.second = std::max(Entry.second, Info.second.second);
+    }
+  }
+
   bool verify(const Function &F) {
     updateModule(F.getParent());
     Context = &M->getContext();
@@ -1324,6 +1342,23 @@ void Verifier::verifyAttributeTypes(AttributeSet Attrs, unsigned Idx,
   }
 }
 
+/// Print the attributes at \p Idx in \p Attrs that are also in \p Kinds.
+/// This only reads \p Attrs; building an AttributeSet to print would add it
+/// to the context, which verifyModule must not do when it runs in parallel.
+static std::string getAttrsString(AttributeSet Attrs, unsigned Idx,
+                                  const AttrBuilder &Kinds) {
+  std::string Result;
+  for (unsigned K = Attribute::None + 1; K != Attribute::EndAttrKinds; ++K) {
+    auto Kind = static_cast<Attribute::AttrKind>(K);
+    if (!Kinds.contains(Kind) || !Attrs.hasAttribute(Idx, Kind))
+      continue;
+    if (!Result.empty())
+      Result += ' ';
+    Result += Attrs.getAttribute(Idx, Kind).getAsString();
+  }
+  return Result;
+}
+
 // VerifyParameterAttrs - Check the given attributes for an argument or return
 // value of the specified type.  The value V is printed in error messages.
 void Verifier::verifyParameterAttrs(AttributeSet Attrs, unsigned Idx, Type *Ty,
@@ -1401,11 +1436,10 @@ void Verifier::verifyParameterAttrs(AttributeSet Attrs, unsigned Idx, Type *Ty,
          "'noinline and alwaysinline' are incompatible!",
          V);
 
-  Assert(!AttrBuilder(Attrs, Idx)
-              .overlaps(AttributeFuncs::typeIncompatible(Ty)),
+  AttrBuilder IncompatibleAttrs = AttributeFuncs::typeIncompatible(Ty);
+  Assert(!AttrBuilder(Attrs, Idx).overlaps(IncompatibleAttrs),
          "Wrong types for attribute: " +
-         AttributeSet::get(*Context, Idx,
-                        AttributeFuncs::typeIncompatible(Ty)).getAsString(Idx),
+             getAttrsString(Attrs, Idx, IncompatibleAttrs),
          V);
 
   if (PointerType *PTy = dyn_cast<PointerType>(Ty)) {
@@ -4302,14 +4336,86 @@ bool llvm::verifyFunction(const Function &f, raw_ostream *OS) {
   return !V.verify(F);
 }
 
+/// Ask the context for everything that verifying the functions of \p M
+/// might create in it, so that verifying them in parallel only reads it.
+/// Checking an intrinsic call matches the declaration's type against the
+/// intrinsic tables, which can create derived types, and checking EH pads
+/// uses the none token.
+static void prepareForParallelVerify(const Module &M) {
+  ConstantTokenNone::get(M.getContext());
+  for (const Function &F : M) {
+    Intrinsic::ID ID = F.getIntrinsicID();
+    if (ID == Intrinsic::not_intrinsic)
+      continue;
+    SmallVector<Intrinsic::IITDescriptor, 8> Table;
+    getIntrinsicInfoTableEntries(ID, Table);
+    ArrayRef<Intrinsic::IITDescriptor> TableRef = Table;
+    SmallVector<Type *, 4> ArgTys;
+    FunctionType *FTy = F.getFunctionType();
+    if (Intrinsic::matchIntrinsicType(FTy->getReturnType(), TableRef, ArgTys))
+      continue;
+    for (Type *ParamTy : FTy->params())
+      if (Intrinsic::matchIntrinsicType(ParamTy, TableRef, ArgTys))
+        break;
+  }
+}
+
+/// Verify the functions of \p M on a thread pool. Each thread verifies a
+/// contiguous range of functions with its own Verifier and output buffer; the
+/// buffers are printed in module order and the module level state is merged
+/// into \p V.
+static bool verifyFunctionsInParallel(Verifier &V, const Module &M,
+                                      raw_ostream *OS,
+                                      bool TreatBrokenDebugInfoAsError) {
+  prepareForParallelVerify(M);
+
+  std::vector<const Function *> Functions;
+  for (const Function &F : M)
+    Functions.push_back(&F);
+  size_t NumChunks = std::min<size_t>(VerifyThreads, Functions.size());
+
+  std::vector<std::string> Buffers(NumChunks);
+  std::vector<std::unique_ptr<raw_string_ostream>> Streams;
+  std::vector<std::unique_ptr<Verifier>> Verifiers;
+  std::vector<char> ChunkBroken(NumChunks, false);
+  for (size_t C = 0; C != NumChunks; ++C) {
+    Streams.emplace_back(new raw_string_ostream(Buffers[C]));
+    Verifiers.emplace_back(new Verifier(OS ? Streams[C].get() : nullptr,
+                                        TreatBrokenDebugInfoAsError));
+  }
+
+  ThreadPool Pool(NumChunks);
+  for (size_t C = 0; C != NumChunks; ++C) {
+    size_t Begin = Functions.size() * C / NumChunks;
+    size_t End = Functions.size() * (C + 1) / NumChunks;
+    Pool.async([&, C, Begin, End] {
+      for (size_t I = Begin; I != End; ++I)
+        ChunkBroken[C] |= !Verifiers[C]->verify(*Functions[I]);
+    });
+  }
+  Pool.wait();
+
+  bool Broken = false;
+  for (size_t C = 0; C != NumChunks; ++C) {
+    if (OS)
+      *OS << Streams[C]->str();
+    Broken |= ChunkBroken[C];
+    V.mergeFunctionState(*Verifiers[C]);
+  }
+  return Broken;
+}
+
 bool llvm::verifyModule(const Module &M, raw_ostream *OS,
                         bool *BrokenDebugInfo) {
   // Don't use a raw_null_ostream.  Printing IR is expensive.
   Verifier V(OS, /*ShouldTreatBrokenDebugInfoAsError=*/!BrokenDebugInfo);
 
   bool Broken = false;
-  for (const Function &F : M)
-    Broken |= !V.verify(F);
+  if (VerifyThreads > 1 && !M.empty())
+    Broken |= verifyFunctionsInParallel(V, M, OS, !BrokenDebugInfo);
+  else
+    for (const Function &F : M)
+      Broken |= !V.verify(F);
 
   Broken |= !V.verify(M);
   if (BrokenDebugInfo)
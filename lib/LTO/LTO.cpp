@@ -15,7 +15,9 @@
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <tuple>
 
 namespace llvm {
 
@@ -40,6 +42,26 @@ std::unique_ptr<Module> loadModuleFromBuffer(const MemoryBufferRef &Buffer,
   return std::move(ModuleOrErr.get());
 }
 
+// Call \p Fn on every GUID entry of \p Index, with the entries split in at
+// most \p ThreadCount contiguous ranges processed in parallel. \p Fn also gets
+// the number of the range, for the caller to keep per range results.
+static void forEachGUIDInParallel(
+    ModuleSummaryIndex &Index, unsigned ThreadCount,
+    function_ref<void(unsigned, GlobalValueSummaryMapTy::value_type &)> Fn) {
+  // The threads iterate a shared index, which must not be sorted under them.
+  Index.finalize();
+  auto Begin = Index.begin();
+  size_t Size = Index.end() - Begin;
+  ThreadPool Pool(ThreadCount);
+  for (unsigned Range = 0; Range != ThreadCount; ++Range)
+    Pool.async([=]() {
+      for (auto I = Begin + Size * Range / ThreadCount,
+                E = Begin + Size * (Range + 1) / ThreadCount;
+           I != E; ++I)
+        Fn(Range, *I);
+    });
+}
+
 static void thinLTOResolveWeakForLinkerGUID(
     GlobalValueSummaryList &GVSummaryList, GlobalValue::GUID GUID,
     DenseSet<GlobalValueSummary *> &GlobalInvolvedWithAlias,
@@ -81,7 +103,8 @@ void thinLTOResolveWeakForLinkerInIndex(
     function_ref<bool(GlobalValue::GUID, const GlobalValueSummary *)>
         isPrevailing,
     function_ref<void(StringRef, GlobalValue::GUID, GlobalValue::LinkageTypes)>
-        recordNewLinkage) {
+        recordNewLinkage,
+    unsigned ThreadCount) {
   // We won't optimize the globals that are referenced by an alias for now
   // Ideally we should turn the alias into a global and duplicate the definition
   // when needed.
@@ -91,9 +114,35 @@ void thinLTOResolveWeakForLinkerInIndex(
       if (auto AS = dyn_cast<AliasSummary>(S.get()))
         GlobalInvolvedWithAlias.insert(&AS->getAliasee());
 
-  for (auto &I : Index)
-    thinLTOResolveWeakForLinkerGUID(I.second, I.first, GlobalInvolvedWithAlias,
-                                    isPrevailing, recordNewLinkage);
+  if (ThreadCount <= 1) {
+    for (auto &I : Index)
+      thinLTOResolveWeakForLinkerGUID(I.second, I.first,
+                                      GlobalInvolvedWithAlias, isPrevailing,
+                                      recordNewLinkage);
+    return;
+  }
+
+  // Buffer the linkage changes of each range and report them once all the
+  // ranges are done, in index order, so recordNewLinkage does not have to be
+  // thread safe.
+  typedef std::tuple<StringRef, GlobalValue::GUID, GlobalValue::LinkageTypes>
+      LinkageChange;
+  std::vector<std::vector<LinkageChange>> Changes(ThreadCount);
+  forEachGUIDInParallel(
+      Index, ThreadCount,
+      [&](unsigned Range, GlobalValueSummaryMapTy::value_type &I) {
+        thinLTOResolveWeakForLinkerGUID(
+            I.second, I.first, GlobalInvolvedWithAlias, isPrevailing,
+            [&](StringRef ModuleIdentifier, GlobalValue::GUID GUID,
+                GlobalValue::LinkageTypes NewLinkage) {
+              Changes[Range].push_back(
+                  std::make_tuple(ModuleIdentifier, GUID, NewLinkage));
+            });
+      });
+  for (auto &RangeChanges : Changes)
+    for (auto &Change : RangeChanges)
+      recordNewLinkage(std::get<0>(Change), std::get<1>(Change),
+                       std::get<2>(Change));
 }
 
 static void thinLTOInternalizeAndPromoteGUID(
@@ -112,8 +161,17 @@ static void thinLTOInternalizeAndPromoteGUID(
 // as external and non-exported values as internal.
 void thinLTOInternalizeAndPromoteInIndex(
     ModuleSummaryIndex &Index,
-    function_ref<bool(StringRef, GlobalValue::GUID)> isExported) {
-  for (auto &I : Index)
-    thinLTOInternalizeAndPromoteGUID(I.second, I.first, isExported);
+    function_ref<bool(StringRef, GlobalValue::GUID)> isExported,
+    unsigned ThreadCount) {
+  if (ThreadCount <= 1) {
+    for (auto &I : Index)
+      thinLTOInternalizeAndPromoteGUID(I.second, I.first, isExported);
+    return;
+  }
+  forEachGUIDInParallel(
+      Index, ThreadCount,
+      [&](unsigned, GlobalValueSummaryMapTy::value_type &I) {
+        thinLTOInternalizeAndPromoteGUID(I.second, I.first, isExported);
+      });
 }
 }
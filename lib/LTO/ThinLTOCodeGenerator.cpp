@@ -38,10 +38,12 @@
 #include "llvm/Object/ModuleSummaryIndexObjectFile.h"
 #include "llvm/Support/CachePruning.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/SHA1.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/xxhash.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/FunctionImport.h"
@@ -215,21 +217,57 @@ std::unique_ptr<MemoryBuffer> codegenModule(Module &TheModule,
   return make_unique<ObjectMemoryBuffer>(std::move(OutputBuffer));
 }
 
+/// Return the SHA1 of the bitcode of each module in \p Modules that was
+/// compiled without a module hash. The cache keys would not tell these modules
+/// apart otherwise. The buffers are hashed together with SHA1::hashMany.
+static StringMap<ModuleHash>
+computeMissingModuleHashes(const ModuleSummaryIndex &Index,
+                           ArrayRef<MemoryBufferRef> Modules) {
+  std::vector<StringRef> ModuleIDs;
+  std::vector<ArrayRef<uint8_t>> Buffers;
+  for (const MemoryBufferRef &ModuleBuffer : Modules) {
+    const ModuleHash &Hash =
+        Index.getModuleHash(ModuleBuffer.getBufferIdentifier());
+    if (any_of(Hash, [](uint32_t Word) { return Word != 0; }))
+      continue;
+    ModuleIDs.push_back(ModuleBuffer.getBufferIdentifier());
+    Buffers.push_back(makeArrayRef(
+        reinterpret_cast<const uint8_t *>(ModuleBuffer.getBufferStart()),
+        ModuleBuffer.getBufferSize()));
+  }
+
+  std::vector<std::array<uint8_t, 20>> Hashes(Buffers.size());
+  SHA1::hashMany(Buffers, Hashes);
+
+  // Store the words like the bitcode writer does for the module hash.
+  StringMap<ModuleHash> BitcodeHashes;
+  for (size_t I = 0, E = ModuleIDs.size(); I != E; ++I) {
+    ModuleHash &Hash = BitcodeHashes[ModuleIDs[I]];
+    for (unsigned Word = 0; Word != 5; ++Word)
+      Hash[Word] = support::endian::read32be(Hashes[I].data() + 4 * Word);
+  }
+  return BitcodeHashes;
+}
+
 /// Manage caching for a single Module.
 class ModuleCacheEntry {
   SmallString<128> EntryPath;
+  // Whether to tell the cache pruner about the uses of this entry.
+  bool RecordAccesses;
 
 public:
   // Create a cache entry. This compute a unique hash for the Module considering
   // the current list of export/import, and offer an interface to query to
   // access the content in the cache.
   ModuleCacheEntry(
-      StringRef CachePath, const ModuleSummaryIndex &Index, StringRef ModuleID,
+      StringRef CachePath, bool RecordAccesses, const ModuleSummaryIndex &Index,
+      const StringMap<ModuleHash> &BitcodeHashes, StringRef ModuleID,
       const FunctionImporter::ImportMapTy &ImportList,
       const FunctionImporter::ExportSetTy &ExportList,
       const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes> &ResolvedODR,
       const GVSummaryMapTy &DefinedFunctions,
-      const DenseSet<GlobalValue::GUID> &PreservedSymbols) {
+      const DenseSet<GlobalValue::GUID> &PreservedSymbols)
+      : RecordAccesses(RecordAccesses) {
     if (CachePath.empty())
       return;
 
@@ -237,8 +275,19 @@ public:
     // This is based on the current compiler version, the module itself, the
     // export list, the hash for every single module in the import list, the
     // list of ResolvedODR for the module, and the list of preserved symbols.
+    // The key only names a cache entry, so it doesn't need a cryptographic
+    // hash; 128 bits make an accidental collision as unlikely as with SHA1.
+
+    XXHash128 Hasher;
 
-    SHA1 Hasher;
+    // Modules compiled without a module hash are identified by the hash of
+    // their bitcode.
+    auto getModuleHash = [&](StringRef ModPath) -> const ModuleHash & {
+      auto It = BitcodeHashes.find(ModPath);
+      if (It != BitcodeHashes.end())
+        return It->second;
+      return Index.getModuleHash(ModPath);
+    };
 
     // Start with the compiler revision
     Hasher.update(LLVM_VERSION_STRING);
@@ -247,7 +296,7 @@ public:
 #endif
 
     // Include the hash for the current module
-    auto ModHash = Index.getModuleHash(ModuleID);
+    auto ModHash = getModuleHash(ModuleID);
     Hasher.update(ArrayRef<uint8_t>((uint8_t *)&ModHash[0], sizeof(ModHash)));
     for (auto F : ExportList)
       // The export list can impact the internalization, be conservative here
@@ -255,7 +304,7 @@ public:
 
     // Include the hash for every module we import functions from
     for (auto &Entry : ImportList) {
-      auto ModHash = Index.getModuleHash(Entry.first());
+      auto ModHash = getModuleHash(Entry.first());
       Hasher.update(ArrayRef<uint8_t>((uint8_t *)&ModHash[0], sizeof(ModHash)));
     }
 
@@ -274,7 +323,11 @@ public:
             ArrayRef<uint8_t>((const uint8_t *)&Entry, sizeof(GlobalValue::GUID)));
     }
 
-    sys::path::append(EntryPath, CachePath, toHex(Hasher.result()));
+    std::array<uint8_t, 16> Key = Hasher.result().bytes();
+    sys::path::append(
+        EntryPath, CachePath,
+        toHex(StringRef(reinterpret_cast<const char *>(Key.data()),
+                        Key.size())));
   }
 
   // Access the path to this entry in the cache.
@@ -284,7 +337,11 @@ public:
   ErrorOr<std::unique_ptr<MemoryBuffer>> tryLoadingBuffer() {
     if (EntryPath.empty())
       return std::error_code();
-    return MemoryBuffer::getFile(EntryPath);
+    auto BufferOrErr = MemoryBuffer::getFile(EntryPath);
+    // Let the cache pruner know the entry is still in use.
+    if (BufferOrErr && RecordAccesses)
+      CachePruning::recordAccess(EntryPath, (*BufferOrErr)->getBufferSize());
+    return BufferOrErr;
   }
 
   // Cache the Produced object file
@@ -323,6 +380,9 @@ public:
              << "': " << EC.message() << "\n";
       return OutputBuffer;
     }
+    if (RecordAccesses)
+      CachePruning::recordAccess(EntryPath,
+                                 (*ReloadedBufferOrErr)->getBufferSize());
     return std::move(*ReloadedBufferOrErr);
   }
 };
@@ -394,7 +454,8 @@ ProcessThinLTOModule(Module &TheModule, ModuleSummaryIndex &Index,
 static void resolveWeakForLinkerInIndex(
     ModuleSummaryIndex &Index,
     StringMap<std::map<GlobalValue::GUID, GlobalValue::LinkageTypes>>
-        &ResolvedODR) {
+        &ResolvedODR,
+    unsigned NumThreads = 1) {
 
   DenseMap<GlobalValue::GUID, const GlobalValueSummary *> PrevailingCopy;
   computePrevailingCopies(Index, PrevailingCopy);
@@ -413,7 +474,8 @@ static void resolveWeakForLinkerInIndex(
     ResolvedODR[ModuleIdentifier][GUID] = NewLinkage;
   };
 
-  thinLTOResolveWeakForLinkerInIndex(Index, isPrevailing, recordNewLinkage);
+  thinLTOResolveWeakForLinkerInIndex(Index, isPrevailing, recordNewLinkage,
+                                     NumThreads);
 }
 
 // Initialize the TargetMachine builder for a given Triple
@@ -506,6 +568,8 @@ std::unique_ptr<ModuleSummaryIndex> ThinLTOCodeGenerator::linkCombinedIndex() {
       CombinedIndex = std::move(Index);
     }
   }
+  if (CombinedIndex)
+    CombinedIndex->finalize();
   return CombinedIndex;
 }
 
@@ -716,11 +780,12 @@ void ThinLTOCodeGenerator::run() {
   Index->collectDefinedGVSummariesPerModule(ModuleToDefinedGVSummaries);
 
   // Collect the import/export lists for all modules from the call-graph in the
-  // combined index.
+  // combined index. This and the index wide analyses below are spread over the
+  // backend threads.
   StringMap<FunctionImporter::ImportMapTy> ImportLists(ModuleCount);
   StringMap<FunctionImporter::ExportSetTy> ExportLists(ModuleCount);
   ComputeCrossModuleImport(*Index, ModuleToDefinedGVSummaries, ImportLists,
-                           ExportLists);
+                           ExportLists, ThreadCount);
 
   // Convert the preserved symbols set from string to GUID, this is needed for
   // computing the caching hash and the internalization.
@@ -735,7 +800,7 @@ void ThinLTOCodeGenerator::run() {
 
   // Resolve LinkOnce/Weak symbols, this has to be computed early because it
   // impacts the caching.
-  resolveWeakForLinkerInIndex(*Index, ResolvedODR);
+  resolveWeakForLinkerInIndex(*Index, ResolvedODR, ThreadCount);
 
   auto isExported = [&](StringRef ModuleIdentifier, GlobalValue::GUID GUID) {
     const auto &ExportList = ExportLists.find(ModuleIdentifier);
@@ -747,7 +812,7 @@ void ThinLTOCodeGenerator::run() {
   // Use global summary-based analysis to identify symbols that can be
   // internalized (because they aren't exported or preserved as per callback).
   // Changes are made in the index, consumed in the ThinLTO backends.
-  thinLTOInternalizeAndPromoteInIndex(*Index, isExported);
+  thinLTOInternalizeAndPromoteInIndex(*Index, isExported, ThreadCount);
 
   // Make sure that every module has an entry in the ExportLists and
   // ResolvedODR maps to enable threaded access to these maps below.
@@ -756,6 +821,10 @@ void ThinLTOCodeGenerator::run() {
     ResolvedODR[DefinedGVSummaries.first()];
   }
 
+  StringMap<ModuleHash> BitcodeHashes;
+  if (!CacheOptions.Path.empty())
+    BitcodeHashes = computeMissingModuleHashes(*Index, Modules);
+
   // Compute the ordering we will process the inputs: the rough heuristic here
   // is to sort them per size so that the largest module get schedule as soon as
   // possible. This is purely a compile-time optimization.
@@ -781,7 +850,10 @@ void ThinLTOCodeGenerator::run() {
         auto &DefinedFunctions = ModuleToDefinedGVSummaries[ModuleIdentifier];
 
         // The module may be cached, this helps handling it.
-        ModuleCacheEntry CacheEntry(CacheOptions.Path, *Index, ModuleIdentifier,
+        // Nothing reads the journal of accesses if pruning is disabled.
+        ModuleCacheEntry CacheEntry(CacheOptions.Path,
+                                    CacheOptions.PruningInterval != -1,
+                                    *Index, BitcodeHashes, ModuleIdentifier,
                                     ImportLists[ModuleIdentifier], ExportList,
                                     ResolvedODR[ModuleIdentifier],
                                     DefinedFunctions, GUIDPreservedSymbols);
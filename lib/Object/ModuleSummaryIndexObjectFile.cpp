@@ -14,6 +14,7 @@
 #include "llvm/Object/ModuleSummaryIndexObjectFile.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/MappedSummaryIndex.h"
 #include "llvm/IR/ModuleSummaryIndex.h"
 #include "llvm/MC/MCStreamer.h"
 #include "llvm/Object/ObjectFile.h"
@@ -114,6 +115,13 @@ ErrorOr<std::unique_ptr<ModuleSummaryIndex>> llvm::getModuleSummaryIndexForFile(
   if (EC)
     return EC;
   MemoryBufferRef BufferRef = (FileOrErr.get())->getMemBufferRef();
+  if (MappedSummaryIndex::isMappedSummaryIndex(BufferRef)) {
+    Expected<std::unique_ptr<MappedSummaryIndex>> MappedOrErr =
+        MappedSummaryIndex::create(BufferRef);
+    if (!MappedOrErr)
+      return errorToErrorCode(MappedOrErr.takeError());
+    return (*MappedOrErr)->materialize();
+  }
   ErrorOr<std::unique_ptr<object::ModuleSummaryIndexObjectFile>> ObjOrErr =
       object::ModuleSummaryIndexObjectFile::create(BufferRef,
                                                    DiagnosticHandler);
@@ -13,15 +13,18 @@
 
 #include "llvm/Support/CachePruning.h"
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 
 #define DEBUG_TYPE "cache-pruning"
 
-#include <set>
+#include <algorithm>
+#include <vector>
 
 using namespace llvm;
 
@@ -32,6 +35,185 @@ static void writeTimestampFile(StringRef TimestampFile) {
   raw_fd_ostream Out(TimestampFile.str(), EC, sys::fs::F_None);
 }
 
+/// The files that the pruner keeps in the cache directory next to the entries.
+static const char TimestampName[] = "llvmcache.timestamp";
+static const char IndexName[] = "llvmcache.index";
+static const char JournalName[] = "llvmcache.journal";
+
+/// Once the journal has grown past this many bytes, prune() folds it into the
+/// index and starts a new one.
+static const uint64_t MaxJournalSize = 1 << 20;
+
+/// If nothing prunes the cache, the journal stops growing at this many bytes.
+/// Accesses that aren't recorded only cost the next prune() a stat().
+static const uint64_t JournalSizeLimit = 16 * MaxJournalSize;
+
+namespace {
+/// What the index knows about a cache entry.
+struct CacheEntryInfo {
+  uint64_t Size;
+  /// The last time the entry is known to have been used, in seconds since the
+  /// epoch.
+  uint64_t AccessTime;
+  /// Whether prune() found the entry in the cache directory.
+  bool Present;
+};
+} // end anonymous namespace
+
+/// Whether \p Name is \p Base or one of the "<Base>-XXXXXX" temporaries that
+/// replace it when renamed over it.
+static bool isNamedAfter(StringRef Name, StringRef Base) {
+  return Name.startswith(Base) &&
+         (Name.size() == Base.size() || Name[Base.size()] == '-');
+}
+
+static bool isPrunerFile(StringRef Name) {
+  return Name == TimestampName || isNamedAfter(Name, IndexName) ||
+         isNamedAfter(Name, JournalName);
+}
+
+/// Index and journal records are "<name> <size> <access time>" lines, so
+/// entries whose names would break a record are never indexed.
+static bool canIndex(StringRef Name) {
+  return Name.find_first_of(" \n") == StringRef::npos;
+}
+
+/// Add the information from a record to Entries. A later record for the same
+/// entry has the current size, but only replaces the access time if it is more
+/// recent.
+static void addRecord(StringRef Record, StringMap<CacheEntryInfo> &Entries) {
+  StringRef Name, SizeStr, TimeStr;
+  std::tie(Name, Record) = Record.split(' ');
+  std::tie(SizeStr, TimeStr) = Record.split(' ');
+  CacheEntryInfo Info;
+  Info.Present = false;
+  if (Name.empty() || SizeStr.getAsInteger(10, Info.Size) ||
+      TimeStr.getAsInteger(10, Info.AccessTime))
+    return;
+  auto Inserted = Entries.insert(std::make_pair(Name, Info));
+  if (!Inserted.second) {
+    CacheEntryInfo &Known = Inserted.first->second;
+    Known.Size = Info.Size;
+    Known.AccessTime = std::max(Known.AccessTime, Info.AccessTime);
+  }
+}
+
+static void addRecords(StringRef Records, StringMap<CacheEntryInfo> &Entries) {
+  while (!Records.empty()) {
+    StringRef Record;
+    std::tie(Record, Records) = Records.split('\n');
+    addRecord(Record, Entries);
+  }
+}
+
+/// Read the index into Entries and return how much of the journal it already
+/// includes.
+static uint64_t readIndex(StringRef IndexFile,
+                          StringMap<CacheEntryInfo> &Entries) {
+  auto BufferOrErr = MemoryBuffer::getFile(IndexFile, /*FileSize=*/-1,
+                                           /*RequiresNullTerminator=*/false);
+  if (!BufferOrErr)
+    return 0;
+  StringRef Header, Records;
+  std::tie(Header, Records) = (*BufferOrErr)->getBuffer().split('\n');
+  uint64_t JournalOffset;
+  if (!Header.consume_front("llvmcache-index ") ||
+      Header.getAsInteger(10, JournalOffset))
+    return 0;
+  addRecords(Records, Entries);
+  return JournalOffset;
+}
+
+/// Add the journal records from Offset on to Entries, and return the offset
+/// just past the last complete one. Other processes may be appending to the
+/// journal, so a record without its newline is left for next time.
+static uint64_t readJournal(StringRef JournalFile, uint64_t Offset,
+                            StringMap<CacheEntryInfo> &Entries) {
+  auto BufferOrErr = MemoryBuffer::getFile(JournalFile, /*FileSize=*/-1,
+                                           /*RequiresNullTerminator=*/false,
+                                           /*IsVolatileSize=*/true);
+  if (!BufferOrErr)
+    return 0;
+  StringRef Journal = (*BufferOrErr)->getBuffer();
+  // Another process has started a new journal since the index was written.
+  if (Offset > Journal.size())
+    Offset = 0;
+  uint64_t End = Journal.rfind('\n') + 1;
+  if (End <= Offset)
+    return Offset;
+  addRecords(Journal.slice(Offset, End), Entries);
+  return End;
+}
+
+/// Move the journal aside, read whatever was appended to it since Offset, and
+/// delete it, so that the next access starts a new journal. A process that
+/// opened the journal just before the move can still lose its record, which
+/// only makes that entry look older than it is.
+static void startNewJournal(StringRef CachePath, StringRef JournalFile,
+                            uint64_t Offset,
+                            StringMap<CacheEntryInfo> &Entries) {
+  SmallString<128> Model(CachePath), OldJournal;
+  sys::path::append(Model, "llvmcache.journal-%%%%%%");
+  if (sys::fs::createUniqueFile(Model, OldJournal) ||
+      sys::fs::rename(JournalFile, OldJournal)) {
+    sys::fs::remove(OldJournal);
+    return;
+  }
+  readJournal(OldJournal, Offset, Entries);
+  sys::fs::remove(OldJournal);
+}
+
+/// Replace the index with one holding Entries. The new index is written to a
+/// temporary first so that readers never see a partial one.
+static void writeIndex(StringRef CachePath, StringRef IndexFile,
+                       uint64_t JournalOffset,
+                       const StringMap<CacheEntryInfo> &Entries) {
+  SmallString<128> Model(CachePath), TempFile;
+  sys::path::append(Model, "llvmcache.index-%%%%%%");
+  int FD;
+  if (sys::fs::createUniqueFile(Model, FD, TempFile))
+    return;
+  bool Failed;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << "llvmcache-index " << JournalOffset << '\n';
+    for (const auto &Entry : Entries)
+      if (canIndex(Entry.getKey()))
+        OS << Entry.getKey() << ' ' << Entry.second.Size << ' '
+           << Entry.second.AccessTime << '\n';
+    OS.close();
+    Failed = OS.has_error();
+    OS.clear_error();
+  }
+  if (Failed || sys::fs::rename(TempFile, IndexFile))
+    sys::fs::remove(TempFile);
+}
+
+void CachePruning::recordAccess(StringRef EntryPath, uint64_t Size) {
+  StringRef Name = sys::path::filename(EntryPath);
+  if (!canIndex(Name))
+    return;
+  SmallString<128> JournalFile(sys::path::parent_path(EntryPath));
+  sys::path::append(JournalFile, JournalName);
+  SmallString<128> Record;
+  raw_svector_ostream(Record) << Name << ' ' << Size << ' '
+                              << sys::TimeValue::now().toEpochTime() << '\n';
+
+  int FD;
+  if (sys::fs::openFileForWrite(JournalFile, FD, sys::fs::F_Append))
+    return;
+  raw_fd_ostream OS(FD, /*shouldClose=*/true);
+  sys::fs::file_status Status;
+  if (sys::fs::status(FD, Status) || Status.getSize() >= JournalSizeLimit)
+    return;
+  // The journal is opened for appending, and each record goes to the OS in a
+  // single write, so records from processes sharing the cache do not mix.
+  OS.SetUnbuffered();
+  OS << Record;
+  // The journal is only a hint; losing a record is not an error.
+  OS.clear_error();
+}
+
 /// Prune the cache of files that haven't been accessed in a long time.
 bool CachePruning::prune() {
   if (Path.empty())
@@ -44,7 +226,7 @@ bool CachePruning::prune() {
   if (!isPathDir)
     return false;
 
-  if (Expiration == 0 && PercentageOfAvailableSpace == 0) {
+  if (Expiration == 0 && PercentageOfAvailableSpace == 0 && MaxSizeBytes == 0) {
     DEBUG(dbgs() << "No pruning settings set, exit early\n");
     // Nothing will be pruned, early exit
     return false;
@@ -82,78 +264,152 @@ bool CachePruning::prune() {
     writeTimestampFile(TimestampFile);
   }
 
-  bool ShouldComputeSize = (PercentageOfAvailableSpace > 0);
-
-  // Keep track of space
-  std::set<std::pair<uint64_t, std::string>> FileSizes;
-  uint64_t TotalSize = 0;
-  // Helper to add a path to the set of files to consider for size-based
-  // pruning, sorted by size.
-  auto AddToFileListForSizePruning =
-      [&](StringRef Path) {
-        if (!ShouldComputeSize)
-          return;
-        TotalSize += FileStatus.getSize();
-        FileSizes.insert(
-            std::make_pair(FileStatus.getSize(), std::string(Path)));
-      };
+  bool ShouldComputeSize = PercentageOfAvailableSpace > 0 || MaxSizeBytes > 0;
 
-  // Walk the entire directory cache, looking for unused files.
-  std::error_code EC;
+  // Start from what the index and the journal know about the cache.
+  SmallString<128> IndexFile(Path), JournalFile(Path);
+  sys::path::append(IndexFile, IndexName);
+  sys::path::append(JournalFile, JournalName);
+  StringMap<CacheEntryInfo> Entries;
+  uint64_t JournalOffset = readIndex(IndexFile, Entries);
+  JournalOffset = readJournal(JournalFile, JournalOffset, Entries);
+  if (JournalOffset > MaxJournalSize) {
+    startNewJournal(Path, JournalFile, JournalOffset, Entries);
+    JournalOffset = 0;
+  }
+
+  // List the cache to find the entries that are actually there. Only those
+  // the index does not know yet need a stat(). Without an index, that is all
+  // of them, so let the walk stat() them in parallel.
+  bool HaveIndex = !Entries.empty();
+  unsigned NumStatted = 0;
   SmallString<128> CachePathNative;
   sys::path::native(Path, CachePathNative);
-  auto TimeExpiration = sys::TimeValue(sys::TimeValue::SecondsType(Expiration));
-  // Walk all of the files within this directory.
-  for (sys::fs::directory_iterator File(CachePathNative, EC), FileEnd;
-       File != FileEnd && !EC; File.increment(EC)) {
-    // Do not touch the timestamp.
-    if (File->path() == TimestampFile)
-      continue;
-
-    // Look at this file. If we can't stat it, there's nothing interesting
-    // there.
-    if (sys::fs::status(File->path(), FileStatus)) {
-      DEBUG(dbgs() << "Ignore " << File->path() << " (can't stat)\n");
-      continue;
-    }
+  sys::fs::walk_directory_tree(
+      CachePathNative,
+      [&](const sys::fs::directory_entry &File,
+          const sys::fs::file_status &WalkStatus) {
+        StringRef Name = sys::path::filename(File.path());
+        if (isPrunerFile(Name))
+          return false;
+        auto KnownEntry = Entries.find(Name);
+        if (KnownEntry != Entries.end()) {
+          KnownEntry->second.Present = true;
+          return false;
+        }
 
-    // If the file hasn't been used recently enough, delete it
-    sys::TimeValue FileAccessTime = FileStatus.getLastAccessedTime();
-    auto FileAge = CurrentTime - FileAccessTime;
-    if (FileAge > TimeExpiration) {
-      DEBUG(dbgs() << "Remove " << File->path() << " (" << FileAge.seconds()
-                   << "s old)\n");
-      sys::fs::remove(File->path());
-      continue;
-    }
+        sys::fs::file_status Status = WalkStatus;
+        if (HaveIndex && sys::fs::status(File.path(), Status))
+          Status = sys::fs::file_status();
+        ++NumStatted;
+        // If we can't stat the file, there's nothing interesting there.
+        if (Status.type() == sys::fs::file_type::status_error) {
+          DEBUG(dbgs() << "Ignore " << File.path() << " (can't stat)\n");
+          return false;
+        }
+        Entries.insert(std::make_pair(
+            Name,
+            CacheEntryInfo{Status.getSize(),
+                           Status.getLastAccessedTime().toEpochTime(), true}));
+        // Only the top level of the cache is pruned.
+        return false;
+      },
+      /*StatEntries=*/!HaveIndex);
 
-    // Leave it here for now, but add it to the list of size-based pruning.
-    AddToFileListForSizePruning(File->path());
+  // Forget the entries that are gone, and only consider the ones still there.
+  for (auto I = Entries.begin(), E = Entries.end(); I != E;) {
+    auto Cur = I;
+    ++I;
+    if (!Cur->second.Present)
+      Entries.erase(Cur);
+  }
+  DEBUG(dbgs() << "Found " << Entries.size() << " entries, " << NumStatted
+               << " of them not in the index\n");
+
+  auto GetEntryPath = [&](StringRef Name) {
+    SmallString<128> EntryPath(CachePathNative);
+    sys::path::append(EntryPath, Name);
+    return EntryPath;
+  };
+
+  // Remove the entries that haven't been used recently enough. The index may
+  // miss uses by processes that don't record them, so check the file's own
+  // access time before removing it.
+  uint64_t Now = CurrentTime.toEpochTime();
+  if (Expiration) {
+    for (auto I = Entries.begin(), E = Entries.end(); I != E;) {
+      auto Cur = I;
+      ++I;
+      CacheEntryInfo &Info = Cur->second;
+      if (Info.AccessTime + Expiration >= Now)
+        continue;
+      SmallString<128> EntryPath = GetEntryPath(Cur->getKey());
+      if (!sys::fs::status(EntryPath, FileStatus)) {
+        Info.Size = FileStatus.getSize();
+        Info.AccessTime =
+            std::max(Info.AccessTime,
+                     FileStatus.getLastAccessedTime().toEpochTime());
+        if (Info.AccessTime + Expiration >= Now)
+          continue;
+      }
+      DEBUG(dbgs() << "Remove " << EntryPath << " ("
+                   << Now - Info.AccessTime << "s old)\n");
+      sys::fs::remove(EntryPath);
+      Entries.erase(Cur);
+    }
   }
 
   // Prune for size now if needed
   if (ShouldComputeSize) {
-    auto ErrOrSpaceInfo = sys::fs::disk_space(Path);
-    if (!ErrOrSpaceInfo) {
-      report_fatal_error("Can't get available size");
+    uint64_t TotalSize = 0;
+    for (const auto &Entry : Entries)
+      TotalSize += Entry.second.Size;
+
+    uint64_t AvailableSpace = 0;
+    if (PercentageOfAvailableSpace) {
+      auto ErrOrSpaceInfo = sys::fs::disk_space(Path);
+      if (!ErrOrSpaceInfo) {
+        report_fatal_error("Can't get available size");
+      }
+      sys::fs::space_info SpaceInfo = ErrOrSpaceInfo.get();
+      AvailableSpace = TotalSize + SpaceInfo.free;
+      DEBUG(dbgs() << "Occupancy: " << ((100 * TotalSize) / AvailableSpace)
+                   << "% target is: " << PercentageOfAvailableSpace << "\n");
     }
-    sys::fs::space_info SpaceInfo = ErrOrSpaceInfo.get();
-    auto AvailableSpace = TotalSize + SpaceInfo.free;
-    auto FileAndSize = FileSizes.rbegin();
-    DEBUG(dbgs() << "Occupancy: " << ((100 * TotalSize) / AvailableSpace)
-                 << "% target is: " << PercentageOfAvailableSpace << "\n");
-    // Remove the oldest accessed files first, till we get below the threshold
-    while (((100 * TotalSize) / AvailableSpace) > PercentageOfAvailableSpace &&
-           FileAndSize != FileSizes.rend()) {
-      // Remove the file.
-      sys::fs::remove(FileAndSize->second);
-      // Update size
-      TotalSize -= FileAndSize->first;
-      DEBUG(dbgs() << " - Remove " << FileAndSize->second << " (size "
-                   << FileAndSize->first << "), new occupancy is " << TotalSize
-                   << "%\n");
-      ++FileAndSize;
+    auto IsOverBudget = [&]() {
+      if (PercentageOfAvailableSpace &&
+          (100 * TotalSize) / AvailableSpace > PercentageOfAvailableSpace)
+        return true;
+      return MaxSizeBytes && TotalSize > MaxSizeBytes;
+    };
+
+    if (IsOverBudget()) {
+      // Remove the least recently used entries first, taking them off a heap
+      // so that only as many are ordered as need to go.
+      typedef StringMapEntry<CacheEntryInfo> EntryTy;
+      std::vector<EntryTy *> LRU;
+      LRU.reserve(Entries.size());
+      for (auto &Entry : Entries)
+        LRU.push_back(&Entry);
+      auto UsedLater = [](const EntryTy *LHS, const EntryTy *RHS) {
+        return LHS->second.AccessTime > RHS->second.AccessTime;
+      };
+      std::make_heap(LRU.begin(), LRU.end(), UsedLater);
+      while (IsOverBudget() && !LRU.empty()) {
+        std::pop_heap(LRU.begin(), LRU.end(), UsedLater);
+        EntryTy *Victim = LRU.back();
+        LRU.pop_back();
+        SmallString<128> EntryPath = GetEntryPath(Victim->getKey());
+        sys::fs::remove(EntryPath);
+        TotalSize -= Victim->second.Size;
+        DEBUG(dbgs() << " - Remove " << EntryPath << " (size "
+                     << Victim->second.Size << "), new cache size is "
+                     << TotalSize << "\n");
+        Entries.erase(Victim->getKey());
+      }
     }
   }
+
+  writeIndex(Path, IndexFile, JournalOffset, Entries);
   return true;
 }
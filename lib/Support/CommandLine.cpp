@@ -134,6 +134,11 @@ public:
   }
 
   void addLiteralOption(Option &Opt, const char *Name) {
+    if (!Opt.hasArgStr())
+      PendingOptions.push_back(std::make_pair(&Opt, Name));
+  }
+
+  void registerLiteralOption(Option &Opt, const char *Name) {
     if (Opt.Subs.empty())
       addLiteralOption(Opt, &*TopLevelSubCommand, Name);
     else {
@@ -185,6 +190,10 @@ public:
   }
 
   void addOption(Option *O) {
+    PendingOptions.push_back(std::make_pair(O, nullptr));
+  }
+
+  void registerOption(Option *O) {
     if (O->Subs.empty()) {
       addOption(O, &*TopLevelSubCommand);
     } else {
@@ -223,6 +232,7 @@ public:
   }
 
   void removeOption(Option *O) {
+    registerPendingOptions();
     if (O->Subs.empty())
       removeOption(O, &*TopLevelSubCommand);
     else {
@@ -262,6 +272,7 @@ public:
   }
 
   void updateArgStr(Option *O, StringRef NewName) {
+    registerPendingOptions();
     if (O->Subs.empty())
       updateArgStr(O, NewName, &*TopLevelSubCommand);
     else {
@@ -306,10 +317,36 @@ public:
   }
 
   void unregisterSubCommand(SubCommand *sub) {
+    // Options still waiting to be registered may name this subcommand.
+    registerPendingOptions();
     RegisteredSubCommands.erase(sub);
   }
 
+  /// Add every option constructed since the last call to the option maps of
+  /// its subcommands. Anything that looks options up or walks the maps must
+  /// call this first.
+  void registerPendingOptions() {
+    if (PendingOptions.empty())
+      return;
+
+    // Most options live in the top-level map. Size it for all of them at
+    // once instead of growing it an option at a time.
+    auto &TopLevelMap = TopLevelSubCommand->OptionsMap;
+    if (TopLevelMap.empty())
+      TopLevelMap = StringMap<Option *>(PendingOptions.size());
+
+    std::vector<std::pair<Option *, const char *>> Pending;
+    Pending.swap(PendingOptions);
+    for (const auto &P : Pending) {
+      if (P.second)
+        registerLiteralOption(*P.first, P.second);
+      else
+        registerOption(P.first);
+    }
+  }
+
   void reset() {
+    PendingOptions.clear();
     ActiveSubCommand = nullptr;
     ProgramName.clear();
     ProgramOverview = nullptr;
@@ -329,6 +366,13 @@ public:
 private:
   SubCommand *ActiveSubCommand;
 
+  /// Options, and literal option names, in the order they were constructed
+  /// but not yet added to the option maps. Tools construct thousands of
+  /// options during static initialization. Queueing them keeps that cheap and
+  /// lets the maps be built in one go, or never for programs that link LLVM
+  /// but don't parse its command line.
+  std::vector<std::pair<Option *, const char *>> PendingOptions;
+
   Option *LookupOption(SubCommand &Sub, StringRef &Arg, StringRef &Value);
   SubCommand *LookupSubCommand(const char *Name);
 };
@@ -407,10 +451,21 @@ Option *CommandLineParser::LookupOption(SubCommand &Sub, StringRef &Arg,
 
   size_t EqualPos = Arg.find('=');
 
+  // Options constructed while the command line is parsed, by a plugin that
+  // -load brought in for example, are still pending. Add them on a miss.
+  auto Find = [&](StringRef Name) {
+    auto I = Sub.OptionsMap.find(Name);
+    if (I == Sub.OptionsMap.end() && !PendingOptions.empty()) {
+      registerPendingOptions();
+      I = Sub.OptionsMap.find(Name);
+    }
+    return I;
+  };
+
   // If we have an equals sign, remember the value.
   if (EqualPos == StringRef::npos) {
     // Look up the option.
-    auto I = Sub.OptionsMap.find(Arg);
+    auto I = Find(Arg);
     if (I == Sub.OptionsMap.end())
       return nullptr;
 
@@ -419,7 +474,7 @@ Option *CommandLineParser::LookupOption(SubCommand &Sub, StringRef &Arg,
 
   // If the argument before the = is a valid option name, we match.  If not,
   // return Arg unmolested.
-  auto I = Sub.OptionsMap.find(Arg.substr(0, EqualPos));
+  auto I = Find(Arg.substr(0, EqualPos));
   if (I == Sub.OptionsMap.end())
     return nullptr;
 
@@ -978,6 +1033,8 @@ bool cl::ParseCommandLineOptions(int argc, const char *const *argv,
 }
 
 void CommandLineParser::ResetAllOptionOccurrences() {
+  registerPendingOptions();
+
   // So that we can parse different command lines multiple times in succession
   // we reset all option values to look like they have never been seen before.
   for (auto SC : RegisteredSubCommands) {
@@ -990,6 +1047,7 @@ bool CommandLineParser::ParseCommandLineOptions(int argc,
                                                 const char *const *argv,
                                                 const char *Overview,
                                                 bool IgnoreErrors) {
+  registerPendingOptions();
   assert(hasOptions() && "No options specified!");
 
   // Expand response files.
@@ -1274,6 +1332,7 @@ bool CommandLineParser::ParseCommandLineOptions(int argc,
   }
 
   // Loop over args and make sure all required args are specified!
+  registerPendingOptions();
   for (const auto &Opt : OptionsMap) {
     switch (Opt.second->getNumOccurrencesFlag()) {
     case Required:
@@ -1734,6 +1793,7 @@ public:
     if (!Value)
       return;
 
+    GlobalParser->registerPendingOptions();
     SubCommand *Sub = GlobalParser->getActiveSubCommand();
     auto &OptionsMap = Sub->OptionsMap;
     auto &PositionalOpts = Sub->PositionalOpts;
@@ -1988,6 +2048,7 @@ void CommandLineParser::printOptionValues() {
   if (!PrintOptions && !PrintAllOptions)
     return;
 
+  registerPendingOptions();
   SmallVector<std::pair<const char *, Option *>, 128> Opts;
   sortOpts(ActiveSubCommand->OptionsMap, Opts, /*ShowHidden*/ true);
 
@@ -2099,6 +2160,7 @@ void cl::AddExtraVersionPrinter(void (*func)()) {
 }
 
 StringMap<Option *> &cl::getRegisteredOptions(SubCommand &Sub) {
+  GlobalParser->registerPendingOptions();
   auto &Subs = GlobalParser->RegisteredSubCommands;
   (void)Subs;
   assert(std::find(Subs.begin(), Subs.end(), &Sub) != Subs.end());
@@ -2106,6 +2168,7 @@ StringMap<Option *> &cl::getRegisteredOptions(SubCommand &Sub) {
 }
 
 void cl::HideUnrelatedOptions(cl::OptionCategory &Category, SubCommand &Sub) {
+  GlobalParser->registerPendingOptions();
   for (auto &I : Sub.OptionsMap) {
     if (I.second->Category != &Category &&
         I.second->Category != &GenericCategory)
@@ -2115,6 +2178,7 @@ void cl::HideUnrelatedOptions(cl::OptionCategory &Category, SubCommand &Sub) {
 
 void cl::HideUnrelatedOptions(ArrayRef<const cl::OptionCategory *> Categories,
                               SubCommand &Sub) {
+  GlobalParser->registerPendingOptions();
   auto CategoriesBegin = Categories.begin();
   auto CategoriesEnd = Categories.end();
   for (auto &I : Sub.OptionsMap) {
@@ -10,6 +10,7 @@
 #include "llvm/Support/DataExtractor.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/LEB128.h"
 #include "llvm/Support/SwapByteOrder.h"
 using namespace llvm;
 
@@ -149,6 +150,18 @@ uint64_t DataExtractor::getULEB128(uint32_t *offset_ptr) const {
   return result;
 }
 
+uint64_t *DataExtractor::getULEB128(uint32_t *offset_ptr, uint64_t *dst,
+                                    uint32_t count) const {
+  if (count == 0 || !isValidOffset(*offset_ptr))
+    return nullptr;
+
+  const uint8_t *p = Data.bytes_begin() + *offset_ptr;
+  if (decodeULEB128Batch(p, Data.bytes_end(), dst, count) != count)
+    return nullptr;
+  *offset_ptr = p - Data.bytes_begin();
+  return dst;
+}
+
 int64_t DataExtractor::getSLEB128(uint32_t *offset_ptr) const {
   int64_t result = 0;
   if (Data.empty())
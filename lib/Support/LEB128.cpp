@@ -13,6 +13,12 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/LEB128.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MathExtras.h"
+
+#if defined(__BMI2__) && defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 namespace llvm {
 
@@ -41,4 +47,79 @@ unsigned getSLEB128Size(int64_t Value) {
   return Size;
 }
 
+/// Gather the low seven bits of each byte of \p Word into the low 56 bits of
+/// the result, in little-endian order.
+static inline uint64_t compactSevenBitGroups(uint64_t Word) {
+#if defined(__BMI2__) && defined(__x86_64__)
+  return _pext_u64(Word, 0x7f7f7f7f7f7f7f7fULL);
+#else
+  // Halve the number of groups at each step: 8 x 7 bits -> 4 x 14 bits ->
+  // 2 x 28 bits -> 1 x 56 bits.
+  Word &= 0x7f7f7f7f7f7f7f7fULL;
+  Word = (Word & 0x007f007f007f007fULL) | ((Word & 0x7f007f007f007f00ULL) >> 1);
+  Word = (Word & 0x00003fff00003fffULL) | ((Word & 0x3fff00003fff0000ULL) >> 2);
+  return (Word & 0x000000000fffffffULL) | ((Word & 0x0fffffff00000000ULL) >> 4);
+#endif
+}
+
+/// Decode a single value a byte at a time, checking every byte against \p end.
+static bool decodeULEB128Checked(const uint8_t *&p, const uint8_t *end,
+                                 uint64_t &Value) {
+  const uint8_t *q = p;
+  uint64_t Result = 0;
+  unsigned Shift = 0;
+  while (q != end) {
+    uint8_t Byte = *q++;
+    if (Shift < 64)
+      Result |= uint64_t(Byte & 0x7f) << Shift;
+    Shift += 7;
+    if ((Byte & 0x80) == 0) {
+      p = q;
+      Value = Result;
+      return true;
+    }
+  }
+  return false;
+}
+
+unsigned decodeULEB128Batch(const uint8_t *&p, const uint8_t *end,
+                            uint64_t *Out, unsigned Count) {
+  const uint64_t HighBits = 0x8080808080808080ULL;
+  unsigned N = 0;
+  while (N != Count) {
+    // Near the end of the data, fall back to checking every byte.
+    if (end - p < 8) {
+      if (!decodeULEB128Checked(p, end, Out[N]))
+        break;
+      ++N;
+      continue;
+    }
+
+    uint64_t Word = support::endian::read64le(p);
+
+    // Eight single byte values in a row are common in DWARF, e.g. in runs of
+    // attribute and form codes.
+    if ((Word & HighBits) == 0 && Count - N >= 8) {
+      for (unsigned I = 0; I != 8; ++I)
+        Out[N + I] = (Word >> (8 * I)) & 0xff;
+      N += 8;
+      p += 8;
+      continue;
+    }
+
+    // The last byte of a value is the first one with its high bit clear.
+    uint64_t Last = ~Word & HighBits;
+    if (Last == 0) {
+      if (!decodeULEB128Checked(p, end, Out[N]))
+        break;
+      ++N;
+      continue;
+    }
+
+    Out[N++] = compactSevenBitGroups(Word & (Last ^ (Last - 1)));
+    p += countTrailingZeros(Last) / 8 + 1;
+  }
+  return N;
+}
+
 }  // namespace llvm
@@ -38,10 +38,25 @@
  */
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/Host.h"
 #include "llvm/Support/MD5.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cstring>
+#include <numeric>
+#include <vector>
+
+// The multi-buffer code is compiled for AVX2 with a function attribute and
+// only called after checking the host CPU, so the rest of the library keeps
+// running everywhere.
+#if (defined(__x86_64__) || defined(__i386__)) &&                               \
+    (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define MD5_X86_ACCEL
+#endif
 
 // The basic MD5 functions.
 
@@ -70,12 +85,97 @@
 
 namespace llvm {
 
+/// The 64 steps of the MD5 compression function on one block, whose sixteen
+/// words are in \p block. \p T is a 32-bit integer, or a vector of them to
+/// process one block of several messages at once.
+template <typename T>
+static inline LLVM_ATTRIBUTE_ALWAYS_INLINE void
+transform(T &a, T &b, T &c, T &d, const T *block) {
+  T saved_a = a, saved_b = b, saved_c = c, saved_d = d;
+
+  // Round 1
+  STEP(F, a, b, c, d, GET(0), 0xd76aa478, 7)
+  STEP(F, d, a, b, c, GET(1), 0xe8c7b756, 12)
+  STEP(F, c, d, a, b, GET(2), 0x242070db, 17)
+  STEP(F, b, c, d, a, GET(3), 0xc1bdceee, 22)
+  STEP(F, a, b, c, d, GET(4), 0xf57c0faf, 7)
+  STEP(F, d, a, b, c, GET(5), 0x4787c62a, 12)
+  STEP(F, c, d, a, b, GET(6), 0xa8304613, 17)
+  STEP(F, b, c, d, a, GET(7), 0xfd469501, 22)
+  STEP(F, a, b, c, d, GET(8), 0x698098d8, 7)
+  STEP(F, d, a, b, c, GET(9), 0x8b44f7af, 12)
+  STEP(F, c, d, a, b, GET(10), 0xffff5bb1, 17)
+  STEP(F, b, c, d, a, GET(11), 0x895cd7be, 22)
+  STEP(F, a, b, c, d, GET(12), 0x6b901122, 7)
+  STEP(F, d, a, b, c, GET(13), 0xfd987193, 12)
+  STEP(F, c, d, a, b, GET(14), 0xa679438e, 17)
+  STEP(F, b, c, d, a, GET(15), 0x49b40821, 22)
+
+  // Round 2
+  STEP(G, a, b, c, d, GET(1), 0xf61e2562, 5)
+  STEP(G, d, a, b, c, GET(6), 0xc040b340, 9)
+  STEP(G, c, d, a, b, GET(11), 0x265e5a51, 14)
+  STEP(G, b, c, d, a, GET(0), 0xe9b6c7aa, 20)
+  STEP(G, a, b, c, d, GET(5), 0xd62f105d, 5)
+  STEP(G, d, a, b, c, GET(10), 0x02441453, 9)
+  STEP(G, c, d, a, b, GET(15), 0xd8a1e681, 14)
+  STEP(G, b, c, d, a, GET(4), 0xe7d3fbc8, 20)
+  STEP(G, a, b, c, d, GET(9), 0x21e1cde6, 5)
+  STEP(G, d, a, b, c, GET(14), 0xc33707d6, 9)
+  STEP(G, c, d, a, b, GET(3), 0xf4d50d87, 14)
+  STEP(G, b, c, d, a, GET(8), 0x455a14ed, 20)
+  STEP(G, a, b, c, d, GET(13), 0xa9e3e905, 5)
+  STEP(G, d, a, b, c, GET(2), 0xfcefa3f8, 9)
+  STEP(G, c, d, a, b, GET(7), 0x676f02d9, 14)
+  STEP(G, b, c, d, a, GET(12), 0x8d2a4c8a, 20)
+
+  // Round 3
+  STEP(H, a, b, c, d, GET(5), 0xfffa3942, 4)
+  STEP(H, d, a, b, c, GET(8), 0x8771f681, 11)
+  STEP(H, c, d, a, b, GET(11), 0x6d9d6122, 16)
+  STEP(H, b, c, d, a, GET(14), 0xfde5380c, 23)
+  STEP(H, a, b, c, d, GET(1), 0xa4beea44, 4)
+  STEP(H, d, a, b, c, GET(4), 0x4bdecfa9, 11)
+  STEP(H, c, d, a, b, GET(7), 0xf6bb4b60, 16)
+  STEP(H, b, c, d, a, GET(10), 0xbebfbc70, 23)
+  STEP(H, a, b, c, d, GET(13), 0x289b7ec6, 4)
+  STEP(H, d, a, b, c, GET(0), 0xeaa127fa, 11)
+  STEP(H, c, d, a, b, GET(3), 0xd4ef3085, 16)
+  STEP(H, b, c, d, a, GET(6), 0x04881d05, 23)
+  STEP(H, a, b, c, d, GET(9), 0xd9d4d039, 4)
+  STEP(H, d, a, b, c, GET(12), 0xe6db99e5, 11)
+  STEP(H, c, d, a, b, GET(15), 0x1fa27cf8, 16)
+  STEP(H, b, c, d, a, GET(2), 0xc4ac5665, 23)
+
+  // Round 4
+  STEP(I, a, b, c, d, GET(0), 0xf4292244, 6)
+  STEP(I, d, a, b, c, GET(7), 0x432aff97, 10)
+  STEP(I, c, d, a, b, GET(14), 0xab9423a7, 15)
+  STEP(I, b, c, d, a, GET(5), 0xfc93a039, 21)
+  STEP(I, a, b, c, d, GET(12), 0x655b59c3, 6)
+  STEP(I, d, a, b, c, GET(3), 0x8f0ccc92, 10)
+  STEP(I, c, d, a, b, GET(10), 0xffeff47d, 15)
+  STEP(I, b, c, d, a, GET(1), 0x85845dd1, 21)
+  STEP(I, a, b, c, d, GET(8), 0x6fa87e4f, 6)
+  STEP(I, d, a, b, c, GET(15), 0xfe2ce6e0, 10)
+  STEP(I, c, d, a, b, GET(6), 0xa3014314, 15)
+  STEP(I, b, c, d, a, GET(13), 0x4e0811a1, 21)
+  STEP(I, a, b, c, d, GET(4), 0xf7537e82, 6)
+  STEP(I, d, a, b, c, GET(11), 0xbd3af235, 10)
+  STEP(I, c, d, a, b, GET(2), 0x2ad7d2bb, 15)
+  STEP(I, b, c, d, a, GET(9), 0xeb86d391, 21)
+
+  a += saved_a;
+  b += saved_b;
+  c += saved_c;
+  d += saved_d;
+}
+
 /// \brief This processes one or more 64-byte data blocks, but does NOT update
 ///the bit counters.  There are no alignment requirements.
 const uint8_t *MD5::body(ArrayRef<uint8_t> Data) {
   const uint8_t *ptr;
   MD5_u32plus a, b, c, d;
-  MD5_u32plus saved_a, saved_b, saved_c, saved_d;
   unsigned long Size = Data.size();
 
   ptr = Data.data();
@@ -86,88 +186,9 @@ const uint8_t *MD5::body(ArrayRef<uint8_t> Data) {
   d = this->d;
 
   do {
-    saved_a = a;
-    saved_b = b;
-    saved_c = c;
-    saved_d = d;
-
-    // Round 1
-    STEP(F, a, b, c, d, SET(0), 0xd76aa478, 7)
-    STEP(F, d, a, b, c, SET(1), 0xe8c7b756, 12)
-    STEP(F, c, d, a, b, SET(2), 0x242070db, 17)
-    STEP(F, b, c, d, a, SET(3), 0xc1bdceee, 22)
-    STEP(F, a, b, c, d, SET(4), 0xf57c0faf, 7)
-    STEP(F, d, a, b, c, SET(5), 0x4787c62a, 12)
-    STEP(F, c, d, a, b, SET(6), 0xa8304613, 17)
-    STEP(F, b, c, d, a, SET(7), 0xfd469501, 22)
-    STEP(F, a, b, c, d, SET(8), 0x698098d8, 7)
-    STEP(F, d, a, b, c, SET(9), 0x8b44f7af, 12)
-    STEP(F, c, d, a, b, SET(10), 0xffff5bb1, 17)
-    STEP(F, b, c, d, a, SET(11), 0x895cd7be, 22)
-    STEP(F, a, b, c, d, SET(12), 0x6b901122, 7)
-    STEP(F, d, a, b, c, SET(13), 0xfd987193, 12)
-    STEP(F, c, d, a, b, SET(14), 0xa679438e, 17)
-    STEP(F, b, c, d, a, SET(15), 0x49b40821, 22)
-
-    // Round 2
-    STEP(G, a, b, c, d, GET(1), 0xf61e2562, 5)
-    STEP(G, d, a, b, c, GET(6), 0xc040b340, 9)
-    STEP(G, c, d, a, b, GET(11), 0x265e5a51, 14)
-    STEP(G, b, c, d, a, GET(0), 0xe9b6c7aa, 20)
-    STEP(G, a, b, c, d, GET(5), 0xd62f105d, 5)
-    STEP(G, d, a, b, c, GET(10), 0x02441453, 9)
-    STEP(G, c, d, a, b, GET(15), 0xd8a1e681, 14)
-    STEP(G, b, c, d, a, GET(4), 0xe7d3fbc8, 20)
-    STEP(G, a, b, c, d, GET(9), 0x21e1cde6, 5)
-    STEP(G, d, a, b, c, GET(14), 0xc33707d6, 9)
-    STEP(G, c, d, a, b, GET(3), 0xf4d50d87, 14)
-    STEP(G, b, c, d, a, GET(8), 0x455a14ed, 20)
-    STEP(G, a, b, c, d, GET(13), 0xa9e3e905, 5)
-    STEP(G, d, a, b, c, GET(2), 0xfcefa3f8, 9)
-    STEP(G, c, d, a, b, GET(7), 0x676f02d9, 14)
-    STEP(G, b, c, d, a, GET(12), 0x8d2a4c8a, 20)
-
-    // Round 3
-    STEP(H, a, b, c, d, GET(5), 0xfffa3942, 4)
-    STEP(H, d, a, b, c, GET(8), 0x8771f681, 11)
-    STEP(H, c, d, a, b, GET(11), 0x6d9d6122, 16)
-    STEP(H, b, c, d, a, GET(14), 0xfde5380c, 23)
-    STEP(H, a, b, c, d, GET(1), 0xa4beea44, 4)
-    STEP(H, d, a, b, c, GET(4), 0x4bdecfa9, 11)
-    STEP(H, c, d, a, b, GET(7), 0xf6bb4b60, 16)
-    STEP(H, b, c, d, a, GET(10), 0xbebfbc70, 23)
-    STEP(H, a, b, c, d, GET(13), 0x289b7ec6, 4)
-    STEP(H, d, a, b, c, GET(0), 0xeaa127fa, 11)
-    STEP(H, c, d, a, b, GET(3), 0xd4ef3085, 16)
-    STEP(H, b, c, d, a, GET(6), 0x04881d05, 23)
-    STEP(H, a, b, c, d, GET(9), 0xd9d4d039, 4)
-    STEP(H, d, a, b, c, GET(12), 0xe6db99e5, 11)
-    STEP(H, c, d, a, b, GET(15), 0x1fa27cf8, 16)
-    STEP(H, b, c, d, a, GET(2), 0xc4ac5665, 23)
-
-    // Round 4
-    STEP(I, a, b, c, d, GET(0), 0xf4292244, 6)
-    STEP(I, d, a, b, c, GET(7), 0x432aff97, 10)
-    STEP(I, c, d, a, b, GET(14), 0xab9423a7, 15)
-    STEP(I, b, c, d, a, GET(5), 0xfc93a039, 21)
-    STEP(I, a, b, c, d, GET(12), 0x655b59c3, 6)
-    STEP(I, d, a, b, c, GET(3), 0x8f0ccc92, 10)
-    STEP(I, c, d, a, b, GET(10), 0xffeff47d, 15)
-    STEP(I, b, c, d, a, GET(1), 0x85845dd1, 21)
-    STEP(I, a, b, c, d, GET(8), 0x6fa87e4f, 6)
-    STEP(I, d, a, b, c, GET(15), 0xfe2ce6e0, 10)
-    STEP(I, c, d, a, b, GET(6), 0xa3014314, 15)
-    STEP(I, b, c, d, a, GET(13), 0x4e0811a1, 21)
-    STEP(I, a, b, c, d, GET(4), 0xf7537e82, 6)
-    STEP(I, d, a, b, c, GET(11), 0xbd3af235, 10)
-    STEP(I, c, d, a, b, GET(2), 0x2ad7d2bb, 15)
-    STEP(I, b, c, d, a, GET(9), 0xeb86d391, 21)
-
-    a += saved_a;
-    b += saved_b;
-    c += saved_c;
-    d += saved_d;
-
+    for (unsigned n = 0; n != 16; ++n)
+      SET(n);
+    transform(a, b, c, d, block);
     ptr += 64;
   } while (Size -= 64);
 
@@ -283,4 +304,155 @@ void MD5::stringifyResult(MD5Result &Result, SmallString<32> &Str) {
     Res << format("%.2x", Result[i]);
 }
 
+
+namespace {
+/// The host's features and the implementation selected from them.
+struct MD5Impl {
+  bool UseAVX2Lanes = false;
+  bool HostHasAVX2 = false;
+
+  MD5Impl() {
+#ifdef MD5_X86_ACCEL
+    StringMap<bool> Features;
+    if (sys::getHostCPUFeatures(Features))
+      HostHasAVX2 = Features.lookup("avx2");
+#endif
+    select(MD5::Implementation::Default);
+  }
+
+  bool select(MD5::Implementation Impl) {
+    switch (Impl) {
+    case MD5::Implementation::Default:
+      UseAVX2Lanes = HostHasAVX2;
+      return true;
+    case MD5::Implementation::Generic:
+      UseAVX2Lanes = false;
+      return true;
+    case MD5::Implementation::AVX2:
+      if (!HostHasAVX2)
+        return false;
+      UseAVX2Lanes = true;
+      return true;
+    }
+    llvm_unreachable("unknown MD5 implementation");
+  }
+};
+} // end anonymous namespace
+
+static MD5Impl &getImpl() {
+  static MD5Impl Impl;
+  return Impl;
+}
+
+bool MD5::setImplementationForTesting(Implementation Impl) {
+  return getImpl().select(Impl);
+}
+
+#ifdef MD5_X86_ACCEL
+namespace {
+/// The blocks of one message in a lane of the multi-buffer hash: the whole
+/// blocks from the input, followed by one or two padded blocks built from the
+/// tail.
+struct MD5Lane {
+  const uint8_t *Data;
+  uint64_t NumDataBlocks;
+  uint64_t NumBlocks;
+  uint8_t Tail[128];
+
+  void init(ArrayRef<uint8_t> Input) {
+    Data = Input.data();
+    NumDataBlocks = Input.size() / 64;
+    size_t TailSize = Input.size() % 64;
+    NumBlocks = NumDataBlocks + (TailSize + 9 > 64 ? 2 : 1);
+
+    memset(Tail, 0, sizeof(Tail));
+    memcpy(Tail, Data + NumDataBlocks * 64, TailSize);
+    Tail[TailSize] = 0x80;
+    uint8_t *Length = Tail + (NumBlocks - NumDataBlocks) * 64 - 8;
+    support::endian::write64le(Length, uint64_t(Input.size()) << 3);
+  }
+
+  const uint8_t *getBlock(uint64_t I) const {
+    if (I < NumDataBlocks)
+      return Data + I * 64;
+    return Tail + (I - NumDataBlocks) * 64;
+  }
+};
+} // end anonymous namespace
+
+/// Hash up to eight messages at once, one per 32-bit lane of an AVX2
+/// register.
+__attribute__((target("avx2"))) static void
+hashLanesAVX2(const MD5Lane *Lanes, unsigned NumLanes,
+              std::array<uint8_t, 16> **Results) {
+  typedef uint32_t V8 __attribute__((vector_size(32)));
+  static const uint8_t ZeroBlock[64] = {0};
+
+  uint64_t MaxBlocks = 0;
+  for (unsigned J = 0; J != NumLanes; ++J)
+    MaxBlocks = std::max(MaxBlocks, Lanes[J].NumBlocks);
+
+  V8 a = V8{} + 0x67452301, b = V8{} + 0xefcdab89, c = V8{} + 0x98badcfe,
+     d = V8{} + 0x10325476;
+  for (uint64_t Block = 0; Block != MaxBlocks; ++Block) {
+    V8 W[16];
+    for (unsigned J = 0; J != 8; ++J) {
+      const uint8_t *P = J < NumLanes && Block < Lanes[J].NumBlocks
+                             ? Lanes[J].getBlock(Block)
+                             : ZeroBlock;
+      for (unsigned I = 0; I != 16; ++I)
+        W[I][J] = support::endian::read32le(P + 4 * I);
+    }
+    transform(a, b, c, d, W);
+
+    for (unsigned J = 0; J != NumLanes; ++J) {
+      if (Block + 1 != Lanes[J].NumBlocks)
+        continue;
+      uint8_t *Result = Results[J]->data();
+      support::endian::write32le(Result, a[J]);
+      support::endian::write32le(Result + 4, b[J]);
+      support::endian::write32le(Result + 8, c[J]);
+      support::endian::write32le(Result + 12, d[J]);
+    }
+  }
+}
+#endif
+
+void MD5::hashMany(ArrayRef<ArrayRef<uint8_t>> Inputs,
+                   MutableArrayRef<std::array<uint8_t, 16>> Results) {
+  assert(Inputs.size() == Results.size() && "one result per input");
+
+#ifdef MD5_X86_ACCEL
+  if (getImpl().UseAVX2Lanes && Inputs.size() > 1) {
+    // Hash messages of similar length together, so that few lanes idle
+    // while the longest message of a group finishes.
+    std::vector<size_t> Order(Inputs.size());
+    std::iota(Order.begin(), Order.end(), 0);
+    std::sort(Order.begin(), Order.end(), [&](size_t L, size_t R) {
+      return Inputs[L].size() > Inputs[R].size();
+    });
+
+    MD5Lane Lanes[8];
+    std::array<uint8_t, 16> *LaneResults[8];
+    for (size_t I = 0; I < Order.size(); I += 8) {
+      unsigned NumLanes = std::min<size_t>(8, Order.size() - I);
+      for (unsigned J = 0; J != NumLanes; ++J) {
+        Lanes[J].init(Inputs[Order[I + J]]);
+        LaneResults[J] = &Results[Order[I + J]];
+      }
+      hashLanesAVX2(Lanes, NumLanes, LaneResults);
+    }
+    return;
+  }
+#endif
+
+  for (size_t I = 0, E = Inputs.size(); I != E; ++I) {
+    MD5 Hash;
+    Hash.update(Inputs[I]);
+    MD5Result Result;
+    Hash.final(Result);
+    memcpy(Results[I].data(), Result, sizeof(Result));
+  }
+}
+
 }
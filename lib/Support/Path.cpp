@@ -19,8 +19,16 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/ThreadPool.h"
+#include <algorithm>
 #include <cctype>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <mutex>
+#if LLVM_ENABLE_THREADS
+#include <thread>
+#endif
 
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
 #include <unistd.h>
@@ -1158,6 +1166,154 @@ std::error_code directory_entry::status(file_status &result) const {
   return fs::status(Path, result);
 }
 
+namespace {
+/// Directory entries, or the error from reading a directory, that
+/// walk_directory_tree has ready to visit.
+struct WalkBatch {
+  std::vector<std::pair<directory_entry, file_status>> Entries;
+  std::error_code EC;
+};
+
+/// Runs the directory reads and stats of walk_directory_tree on a thread pool
+/// and hands the results back to the calling thread.
+class DirectoryWalker {
+  /// Directories are listed by one task, but their entries are stat()'d in
+  /// batches of this many so that one huge directory still spreads out.
+  static const unsigned BatchSize = 256;
+
+  bool StatEntries;
+
+  /// Guards Done and Pending, and signals when either changes.
+  std::mutex Lock;
+  std::condition_variable Changed;
+  std::deque<WalkBatch> Done;
+  /// The number of tasks that have been started but have not finished yet.
+  unsigned Pending = 0;
+
+#if LLVM_ENABLE_THREADS
+  /// Declared last so that its threads are joined before anything they use
+  /// is destroyed.
+  ThreadPool Pool;
+#endif
+
+public:
+  DirectoryWalker(bool StatEntries, unsigned ThreadCount)
+      : StatEntries(StatEntries)
+#if LLVM_ENABLE_THREADS
+        ,
+        Pool(ThreadCount ? ThreadCount
+                         : std::max(1u, std::thread::hardware_concurrency()))
+#endif
+  {
+  }
+
+  /// Start reading the entries of the directory at \p Dir.
+  void readDirectory(std::string Dir) {
+    run([this](const std::string &Dir) { listDirectory(Dir); },
+        std::move(Dir));
+  }
+
+  /// Wait for the next batch of results and return false if there are none
+  /// left.
+  bool next(WalkBatch &Batch) {
+    std::unique_lock<std::mutex> Guard(Lock);
+    Changed.wait(Guard, [this] { return !Done.empty() || !Pending; });
+    if (Done.empty())
+      return false;
+    Batch = std::move(Done.front());
+    Done.pop_front();
+    return true;
+  }
+
+private:
+  template <typename Function, typename Arg> void run(Function F, Arg &&A) {
+    {
+      std::lock_guard<std::mutex> Guard(Lock);
+      ++Pending;
+    }
+#if LLVM_ENABLE_THREADS
+    Pool.async(std::move(F), std::forward<Arg>(A));
+#else
+    F(A);
+#endif
+  }
+
+  void finish(WalkBatch Batch) {
+    {
+      std::lock_guard<std::mutex> Guard(Lock);
+      if (Batch.EC || !Batch.Entries.empty())
+        Done.push_back(std::move(Batch));
+      --Pending;
+    }
+    Changed.notify_one();
+  }
+
+  bool needsStat(const directory_entry &Entry) const {
+    return StatEntries || Entry.type() == file_type::type_unknown ||
+           Entry.type() == file_type::symlink_file;
+  }
+
+  void listDirectory(const std::string &Dir) {
+    WalkBatch Batch;
+    bool BatchNeedsStat = false;
+    std::error_code EC;
+    for (directory_iterator I(Dir, EC), E; I != E && !EC; I.increment(EC)) {
+      Batch.Entries.emplace_back(*I, file_status(I->type()));
+      BatchNeedsStat |= needsStat(*I);
+      if (Batch.Entries.size() == BatchSize) {
+        addBatch(std::move(Batch), BatchNeedsStat);
+        Batch = WalkBatch();
+        BatchNeedsStat = false;
+      }
+    }
+    if (!Batch.Entries.empty())
+      addBatch(std::move(Batch), BatchNeedsStat);
+
+    WalkBatch Result;
+    Result.EC = EC;
+    finish(std::move(Result));
+  }
+
+  void addBatch(WalkBatch Batch, bool NeedsStat) {
+    if (!NeedsStat) {
+      std::lock_guard<std::mutex> Guard(Lock);
+      Done.push_back(std::move(Batch));
+      Changed.notify_one();
+      return;
+    }
+    run([this](WalkBatch &Batch) { statEntries(std::move(Batch)); },
+        std::move(Batch));
+  }
+
+  void statEntries(WalkBatch Batch) {
+    for (auto &Entry : Batch.Entries)
+      if (needsStat(Entry.first) && Entry.first.status(Entry.second))
+        Entry.second = file_status();
+    finish(std::move(Batch));
+  }
+};
+} // end anonymous namespace
+
+std::error_code
+walk_directory_tree(const Twine &Path,
+                    function_ref<bool(const directory_entry &Entry,
+                                      const file_status &Status)> Visit,
+                    bool StatEntries, unsigned ThreadCount) {
+  DirectoryWalker Walker(StatEntries, ThreadCount);
+  Walker.readDirectory(Path.str());
+
+  std::error_code FirstEC;
+  WalkBatch Batch;
+  while (Walker.next(Batch)) {
+    if (Batch.EC && !FirstEC)
+      FirstEC = Batch.EC;
+    for (const auto &Entry : Batch.Entries)
+      if (Visit(Entry.first, Entry.second) && is_directory(Entry.second))
+        Walker.readDirectory(Entry.first.path());
+  }
+  return FirstEC;
+}
+
 } // end namespace fs
 } // end namespace sys
 } // end namespace llvm
@@ -16,15 +16,31 @@
 #include "llvm/Support/Host.h"
 #include "llvm/Support/SHA1.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/ErrorHandling.h"
 using namespace llvm;
 
+#include <algorithm>
+#include <cassert>
+#include <numeric>
 #include <stdint.h>
 #include <string.h>
+#include <vector>
 
 #if defined(BYTE_ORDER) && defined(BIG_ENDIAN) && BYTE_ORDER == BIG_ENDIAN
 #define SHA_BIG_ENDIAN
 #endif
 
+// The accelerated implementations are compiled for their target features with
+// function attributes and only called after checking the host CPU, so the
+// rest of the library keeps running everywhere.
+#if (defined(__x86_64__) || defined(__i386__)) &&                               \
+    (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define SHA1_X86_ACCEL
+#include <immintrin.h>
+#endif
+
 /* code */
 #define SHA1_K0 0x5a827999
 #define SHA1_K20 0x6ed9eba1
@@ -51,21 +67,23 @@ static uint32_t rol32(uint32_t number, uint8_t bits) {
   return ((number << bits) | (number >> (32 - bits)));
 }
 
-void SHA1::hashBlock() {
+/// Hash one 64 byte block, given as sixteen big endian words that have
+/// already been converted to host order, into \p State. \p W is clobbered.
+typedef void (*SHA1BlockFn)(uint32_t State[5], uint32_t W[16]);
+
+static void hashBlockGeneric(uint32_t State[5], uint32_t W[16]) {
   uint8_t i;
   uint32_t a, b, c, d, e, t;
 
-  a = InternalState.State[0];
-  b = InternalState.State[1];
-  c = InternalState.State[2];
-  d = InternalState.State[3];
-  e = InternalState.State[4];
+  a = State[0];
+  b = State[1];
+  c = State[2];
+  d = State[3];
+  e = State[4];
   for (i = 0; i < 80; i++) {
     if (i >= 16) {
-      t = InternalState.Buffer[(i + 13) & 15] ^
-          InternalState.Buffer[(i + 8) & 15] ^
-          InternalState.Buffer[(i + 2) & 15] ^ InternalState.Buffer[i & 15];
-      InternalState.Buffer[i & 15] = rol32(t, 1);
+      t = W[(i + 13) & 15] ^ W[(i + 8) & 15] ^ W[(i + 2) & 15] ^ W[i & 15];
+      W[i & 15] = rol32(t, 1);
     }
     if (i < 20) {
       t = (d ^ (b & (c ^ d))) + SHA1_K0;
@@ -76,18 +94,152 @@ void SHA1::hashBlock() {
     } else {
       t = (b ^ c ^ d) + SHA1_K60;
     }
-    t += rol32(a, 5) + e + InternalState.Buffer[i & 15];
+    t += rol32(a, 5) + e + W[i & 15];
     e = d;
     d = c;
     c = rol32(b, 30);
     b = a;
     a = t;
   }
-  InternalState.State[0] += a;
-  InternalState.State[1] += b;
-  InternalState.State[2] += c;
-  InternalState.State[3] += d;
-  InternalState.State[4] += e;
+  State[0] += a;
+  State[1] += b;
+  State[2] += c;
+  State[3] += d;
+  State[4] += e;
+}
+
+#ifdef SHA1_X86_ACCEL
+/// Do rounds 4*I to 4*I+3 with the SHA extensions. \p Prev holds the A
+/// register from before the previous group of rounds (E for the first group),
+/// and the message schedule for later groups is computed a few groups ahead,
+/// as in Intel's reference code. I is a template parameter so that the whole
+/// block is unrolled and Msg lives in registers.
+template <unsigned I>
+__attribute__((target("sha,sse4.1"), always_inline)) static inline void
+roundsSHANI(__m128i &ABCD, __m128i &Prev, __m128i Msg[4]) {
+  __m128i Cur = I == 0 ? _mm_add_epi32(Prev, Msg[0])
+                       : _mm_sha1nexte_epu32(Prev, Msg[I & 3]);
+  Prev = ABCD;
+  if (I >= 3 && I <= 18)
+    Msg[(I + 1) & 3] = _mm_sha1msg2_epu32(Msg[(I + 1) & 3], Msg[I & 3]);
+  ABCD = _mm_sha1rnds4_epu32(ABCD, Cur, I / 5);
+  if (I >= 1 && I <= 16)
+    Msg[(I - 1) & 3] = _mm_sha1msg1_epu32(Msg[(I - 1) & 3], Msg[I & 3]);
+  if (I >= 2 && I <= 17)
+    Msg[(I + 2) & 3] = _mm_xor_si128(Msg[(I + 2) & 3], Msg[I & 3]);
+}
+
+/// Hash one block with the SHA extensions, four rounds per instruction.
+__attribute__((target("sha,sse4.1"))) static void
+hashBlockSHANI(uint32_t State[5], uint32_t W[16]) {
+  // The instructions want the first word of a group of four and the A
+  // register in the highest lane.
+  __m128i ABCD = _mm_shuffle_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(State)), 0x1B);
+  __m128i E = _mm_set_epi32(State[4], 0, 0, 0);
+  __m128i ABCDSave = ABCD;
+
+  __m128i Msg[4];
+  for (unsigned I = 0; I != 4; ++I)
+    Msg[I] = _mm_shuffle_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(W + 4 * I)), 0x1B);
+
+  __m128i Prev = E;
+  roundsSHANI<0>(ABCD, Prev, Msg);
+  roundsSHANI<1>(ABCD, Prev, Msg);
+  roundsSHANI<2>(ABCD, Prev, Msg);
+  roundsSHANI<3>(ABCD, Prev, Msg);
+  roundsSHANI<4>(ABCD, Prev, Msg);
+  roundsSHANI<5>(ABCD, Prev, Msg);
+  roundsSHANI<6>(ABCD, Prev, Msg);
+  roundsSHANI<7>(ABCD, Prev, Msg);
+  roundsSHANI<8>(ABCD, Prev, Msg);
+  roundsSHANI<9>(ABCD, Prev, Msg);
+  roundsSHANI<10>(ABCD, Prev, Msg);
+  roundsSHANI<11>(ABCD, Prev, Msg);
+  roundsSHANI<12>(ABCD, Prev, Msg);
+  roundsSHANI<13>(ABCD, Prev, Msg);
+  roundsSHANI<14>(ABCD, Prev, Msg);
+  roundsSHANI<15>(ABCD, Prev, Msg);
+  roundsSHANI<16>(ABCD, Prev, Msg);
+  roundsSHANI<17>(ABCD, Prev, Msg);
+  roundsSHANI<18>(ABCD, Prev, Msg);
+  roundsSHANI<19>(ABCD, Prev, Msg);
+
+  E = _mm_sha1nexte_epu32(Prev, E);
+  ABCD = _mm_add_epi32(ABCD, ABCDSave);
+
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(State),
+                   _mm_shuffle_epi32(ABCD, 0x1B));
+  State[4] = _mm_extract_epi32(E, 3);
+}
+#endif
+
+namespace {
+/// The host's features and the implementations selected from them.
+struct SHA1Impl {
+  SHA1BlockFn HashBlock = hashBlockGeneric;
+  bool UseAVX2Lanes = false;
+  bool HostHasSHANI = false;
+  bool HostHasAVX2 = false;
+
+  SHA1Impl() {
+#ifdef SHA1_X86_ACCEL
+    StringMap<bool> Features;
+    if (sys::getHostCPUFeatures(Features)) {
+      HostHasSHANI = Features.lookup("sha") && Features.lookup("sse4.1");
+      HostHasAVX2 = Features.lookup("avx2");
+    }
+#endif
+    select(SHA1::Implementation::Default);
+  }
+
+  bool select(SHA1::Implementation Impl) {
+    switch (Impl) {
+    case SHA1::Implementation::Default:
+      // A single stream with the SHA extensions beats eight streams in AVX2.
+      if (HostHasSHANI)
+        return select(SHA1::Implementation::SHANI);
+      if (HostHasAVX2)
+        return select(SHA1::Implementation::AVX2);
+      return select(SHA1::Implementation::Generic);
+    case SHA1::Implementation::Generic:
+      HashBlock = hashBlockGeneric;
+      UseAVX2Lanes = false;
+      return true;
+    case SHA1::Implementation::SHANI:
+#ifdef SHA1_X86_ACCEL
+      if (!HostHasSHANI)
+        return false;
+      HashBlock = hashBlockSHANI;
+      UseAVX2Lanes = false;
+      return true;
+#else
+      return false;
+#endif
+    case SHA1::Implementation::AVX2:
+      if (!HostHasAVX2)
+        return false;
+      HashBlock = hashBlockGeneric;
+      UseAVX2Lanes = true;
+      return true;
+    }
+    llvm_unreachable("unknown SHA1 implementation");
+  }
+};
+} // end anonymous namespace
+
+static SHA1Impl &getImpl() {
+  static SHA1Impl Impl;
+  return Impl;
+}
+
+bool SHA1::setImplementationForTesting(Implementation Impl) {
+  return getImpl().select(Impl);
+}
+
+void SHA1::hashBlock() {
+  getImpl().HashBlock(InternalState.State, InternalState.Buffer);
 }
 
 void SHA1::addUncounted(uint8_t data) {
@@ -104,14 +256,25 @@ void SHA1::addUncounted(uint8_t data) {
   }
 }
 
-void SHA1::writebyte(uint8_t data) {
-  ++InternalState.ByteCount;
-  addUncounted(data);
-}
-
 void SHA1::update(ArrayRef<uint8_t> Data) {
-  for (auto &C : Data)
-    writebyte(C);
+  const uint8_t *P = Data.begin(), *End = Data.end();
+  InternalState.ByteCount += Data.size();
+
+  // Finish a partially filled block first.
+  for (; InternalState.BufferOffset != 0 && P != End; ++P)
+    addUncounted(*P);
+
+  // Then hash whole blocks straight from the input.
+  SHA1BlockFn HashBlock = getImpl().HashBlock;
+  uint32_t W[BLOCK_LENGTH / 4];
+  for (; End - P >= BLOCK_LENGTH; P += BLOCK_LENGTH) {
+    for (unsigned I = 0; I != BLOCK_LENGTH / 4; ++I)
+      W[I] = support::endian::read32be(P + 4 * I);
+    HashBlock(InternalState.State, W);
+  }
+
+  for (; P != End; ++P)
+    addUncounted(*P);
 }
 
 void SHA1::pad() {
@@ -122,16 +285,10 @@ void SHA1::pad() {
   while (InternalState.BufferOffset != 56)
     addUncounted(0x00);
 
-  // Append length in the last 8 bytes
-  addUncounted(0); // We're only using 32 bit lengths
-  addUncounted(0); // But SHA-1 supports 64 bit lengths
-  addUncounted(0); // So zero pad the top bits
-  addUncounted(InternalState.ByteCount >> 29); // Shifting to multiply by 8
-  addUncounted(InternalState.ByteCount >>
-               21); // as SHA-1 supports bitstreams as well as
-  addUncounted(InternalState.ByteCount >> 13); // byte.
-  addUncounted(InternalState.ByteCount >> 5);
-  addUncounted(InternalState.ByteCount << 3);
+  // Append the length in bits in the last 8 bytes
+  uint64_t BitCount = InternalState.ByteCount << 3;
+  for (int Shift = 56; Shift >= 0; Shift -= 8)
+    addUncounted(BitCount >> Shift);
 }
 
 StringRef SHA1::final() {
@@ -168,3 +325,139 @@ StringRef SHA1::result() {
   // Return pointer to hash (20 characters)
   return Hash;
 }
+
+std::array<uint8_t, 20> SHA1::hash(ArrayRef<uint8_t> Data) {
+  SHA1 Hash;
+  Hash.update(Data);
+  StringRef S = Hash.final();
+
+  std::array<uint8_t, 20> Arr;
+  memcpy(Arr.data(), S.data(), S.size());
+  return Arr;
+}
+
+#ifdef SHA1_X86_ACCEL
+namespace {
+/// The blocks of one message in a lane of the multi-buffer hash: the whole
+/// blocks from the input, followed by one or two padded blocks built from the
+/// tail.
+struct SHA1Lane {
+  const uint8_t *Data;
+  uint64_t NumDataBlocks;
+  uint64_t NumBlocks;
+  uint8_t Tail[128];
+
+  void init(ArrayRef<uint8_t> Input) {
+    Data = Input.data();
+    NumDataBlocks = Input.size() / 64;
+    size_t TailSize = Input.size() % 64;
+    NumBlocks = NumDataBlocks + (TailSize + 9 > 64 ? 2 : 1);
+
+    memset(Tail, 0, sizeof(Tail));
+    memcpy(Tail, Data + NumDataBlocks * 64, TailSize);
+    Tail[TailSize] = 0x80;
+    uint8_t *Length = Tail + (NumBlocks - NumDataBlocks) * 64 - 8;
+    support::endian::write64be(Length, uint64_t(Input.size()) << 3);
+  }
+
+  const uint8_t *getBlock(uint64_t I) const {
+    if (I < NumDataBlocks)
+      return Data + I * 64;
+    return Tail + (I - NumDataBlocks) * 64;
+  }
+};
+} // end anonymous namespace
+
+/// Hash up to eight messages at once, one per 32-bit lane of an AVX2
+/// register. The rounds are the same as in hashBlockGeneric.
+__attribute__((target("avx2"))) static void
+hashLanesAVX2(const SHA1Lane *Lanes, unsigned NumLanes,
+              std::array<uint8_t, 20> **Results) {
+  typedef uint32_t V8 __attribute__((vector_size(32)));
+  static const uint8_t ZeroBlock[64] = {0};
+
+  uint64_t MaxBlocks = 0;
+  for (unsigned J = 0; J != NumLanes; ++J)
+    MaxBlocks = std::max(MaxBlocks, Lanes[J].NumBlocks);
+
+  V8 State[5] = {V8{} + SEED_0, V8{} + SEED_1, V8{} + SEED_2, V8{} + SEED_3,
+                 V8{} + SEED_4};
+  for (uint64_t Block = 0; Block != MaxBlocks; ++Block) {
+    V8 W[16];
+    for (unsigned J = 0; J != 8; ++J) {
+      const uint8_t *P = J < NumLanes && Block < Lanes[J].NumBlocks
+                             ? Lanes[J].getBlock(Block)
+                             : ZeroBlock;
+      for (unsigned I = 0; I != 16; ++I)
+        W[I][J] = support::endian::read32be(P + 4 * I);
+    }
+
+    V8 a = State[0], b = State[1], c = State[2], d = State[3], e = State[4];
+    for (unsigned i = 0; i < 80; i++) {
+      V8 t;
+      if (i >= 16) {
+        t = W[(i + 13) & 15] ^ W[(i + 8) & 15] ^ W[(i + 2) & 15] ^ W[i & 15];
+        W[i & 15] = (t << 1) | (t >> 31);
+      }
+      if (i < 20)
+        t = (d ^ (b & (c ^ d))) + SHA1_K0;
+      else if (i < 40)
+        t = (b ^ c ^ d) + SHA1_K20;
+      else if (i < 60)
+        t = ((b & c) | (d & (b | c))) + SHA1_K40;
+      else
+        t = (b ^ c ^ d) + SHA1_K60;
+      t += ((a << 5) | (a >> 27)) + e + W[i & 15];
+      e = d;
+      d = c;
+      c = (b << 30) | (b >> 2);
+      b = a;
+      a = t;
+    }
+    State[0] += a;
+    State[1] += b;
+    State[2] += c;
+    State[3] += d;
+    State[4] += e;
+
+    for (unsigned J = 0; J != NumLanes; ++J) {
+      if (Block + 1 != Lanes[J].NumBlocks)
+        continue;
+      for (unsigned I = 0; I != 5; ++I)
+        support::endian::write32be(Results[J]->data() + 4 * I, State[I][J]);
+    }
+  }
+}
+#endif
+
+void SHA1::hashMany(ArrayRef<ArrayRef<uint8_t>> Inputs,
+                    MutableArrayRef<std::array<uint8_t, 20>> Results) {
+  assert(Inputs.size() == Results.size() && "one result per input");
+
+#ifdef SHA1_X86_ACCEL
+  if (getImpl().UseAVX2Lanes && Inputs.size() > 1) {
+    // Hash messages of similar length together, so that few lanes idle
+    // while the longest message of a group finishes.
+    std::vector<size_t> Order(Inputs.size());
+    std::iota(Order.begin(), Order.end(), 0);
+    std::sort(Order.begin(), Order.end(), [&](size_t L, size_t R) {
+      return Inputs[L].size() > Inputs[R].size();
+    });
+
+    SHA1Lane Lanes[8];
+    std::array<uint8_t, 20> *LaneResults[8];
+    for (size_t I = 0; I < Order.size(); I += 8) {
+      unsigned NumLanes = std::min<size_t>(8, Order.size() - I);
+      for (unsigned J = 0; J != NumLanes; ++J) {
+        Lanes[J].init(Inputs[Order[I + J]]);
+        LaneResults[J] = &Results[Order[I + J]];
+      }
+      hashLanesAVX2(Lanes, NumLanes, LaneResults);
+    }
+    return;
+  }
+#endif
+
+  for (size_t I = 0, E = Inputs.size(); I != E; ++I)
+    Results[I] = hash(Inputs[I]);
+}
@@ -19,27 +19,74 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
 using namespace llvm;
 
 static const size_t TabStop = 8;
 
-namespace {
-  struct LineNoCacheTy {
-    unsigned LastQueryBufferID;
-    const char *LastQuery;
-    unsigned LineNoOfQuery;
-  };
+template <typename T>
+static std::vector<T> &getOffsetCache(void *&OffsetCache,
+                                      const MemoryBuffer &Buffer) {
+  if (OffsetCache)
+    return *static_cast<std::vector<T> *>(OffsetCache);
+
+  // memchr is vectorized in the C libraries we care about, so this is much
+  // faster than looking at one character at a time.
+  auto *Offsets = new std::vector<T>();
+  const char *BufStart = Buffer.getBufferStart();
+  const char *BufEnd = Buffer.getBufferEnd();
+  for (const char *Ptr = BufStart;
+       (Ptr = static_cast<const char *>(memchr(Ptr, '\n', BufEnd - Ptr)));
+       ++Ptr)
+    Offsets->push_back(static_cast<T>(Ptr - BufStart));
+
+  OffsetCache = Offsets;
+  return *Offsets;
 }
 
-static LineNoCacheTy *getCache(void *Ptr) {
-  return (LineNoCacheTy*)Ptr;
+template <typename T>
+static unsigned getLineNumberImpl(void *&OffsetCache,
+                                  const MemoryBuffer &Buffer,
+                                  const char *Ptr) {
+  std::vector<T> &Offsets = getOffsetCache<T>(OffsetCache, Buffer);
+
+  const char *BufStart = Buffer.getBufferStart();
+  assert(Ptr >= BufStart && Ptr <= Buffer.getBufferEnd() &&
+         "pointer outside of the buffer");
+  T PtrOffset = static_cast<T>(Ptr - BufStart);
+
+  // The line number is one more than the number of newlines before Ptr.
+  return std::lower_bound(Offsets.begin(), Offsets.end(), PtrOffset) -
+         Offsets.begin() + 1;
 }
 
+unsigned SourceMgr::SrcBuffer::getLineNumber(const char *Ptr) const {
+  // Use the narrowest offsets that can index the whole buffer, including the
+  // position just past its end.
+  size_t Size = Buffer->getBufferSize();
+  if (Size <= std::numeric_limits<uint8_t>::max())
+    return getLineNumberImpl<uint8_t>(OffsetCache, *Buffer, Ptr);
+  if (Size <= std::numeric_limits<uint16_t>::max())
+    return getLineNumberImpl<uint16_t>(OffsetCache, *Buffer, Ptr);
+  if (Size <= std::numeric_limits<uint32_t>::max())
+    return getLineNumberImpl<uint32_t>(OffsetCache, *Buffer, Ptr);
+  return getLineNumberImpl<uint64_t>(OffsetCache, *Buffer, Ptr);
+}
 
-SourceMgr::~SourceMgr() {
-  // Delete the line # cache if allocated.
-  if (LineNoCacheTy *Cache = getCache(LineNoCache))
-    delete Cache;
+SourceMgr::SrcBuffer::~SrcBuffer() {
+  if (!OffsetCache)
+    return;
+  size_t Size = Buffer->getBufferSize();
+  if (Size <= std::numeric_limits<uint8_t>::max())
+    delete static_cast<std::vector<uint8_t> *>(OffsetCache);
+  else if (Size <= std::numeric_limits<uint16_t>::max())
+    delete static_cast<std::vector<uint16_t> *>(OffsetCache);
+  else if (Size <= std::numeric_limits<uint32_t>::max())
+    delete static_cast<std::vector<uint32_t> *>(OffsetCache);
+  else
+    delete static_cast<std::vector<uint64_t> *>(OffsetCache);
 }
 
 unsigned SourceMgr::AddIncludeFile(const std::string &Filename,
@@ -79,40 +126,11 @@ SourceMgr::getLineAndColumn(SMLoc Loc, unsigned BufferID) const {
     BufferID = FindBufferContainingLoc(Loc);
   assert(BufferID && "Invalid Location!");
 
-  const MemoryBuffer *Buff = getMemoryBuffer(BufferID);
-
-  // Count the number of \n's between the start of the file and the specified
-  // location.
-  unsigned LineNo = 1;
-
-  const char *BufStart = Buff->getBufferStart();
-  const char *Ptr = BufStart;
+  const SrcBuffer &SB = getBufferInfo(BufferID);
+  const char *Ptr = Loc.getPointer();
+  const char *BufStart = SB.Buffer->getBufferStart();
 
-  // If we have a line number cache, and if the query is to a later point in the
-  // same file, start searching from the last query location.  This optimizes
-  // for the case when multiple diagnostics come out of one file in order.
-  if (LineNoCacheTy *Cache = getCache(LineNoCache))
-    if (Cache->LastQueryBufferID == BufferID &&
-        Cache->LastQuery <= Loc.getPointer()) {
-      Ptr = Cache->LastQuery;
-      LineNo = Cache->LineNoOfQuery;
-    }
-
-  // Scan for the location being queried, keeping track of the number of lines
-  // we see.
-  for (; SMLoc::getFromPointer(Ptr) != Loc; ++Ptr)
-    if (*Ptr == '\n') ++LineNo;
-
-  // Allocate the line number cache if it doesn't exist.
-  if (!LineNoCache)
-    LineNoCache = new LineNoCacheTy();
-
-  // Update the line # cache.
-  LineNoCacheTy &Cache = *getCache(LineNoCache);
-  Cache.LastQueryBufferID = BufferID;
-  Cache.LastQuery = Ptr;
-  Cache.LineNoOfQuery = LineNo;
-  
+  unsigned LineNo = SB.getLineNumber(Ptr);
   size_t NewlineOffs = StringRef(BufStart, Ptr-BufStart).find_last_of("\n\r");
   if (NewlineOffs == StringRef::npos) NewlineOffs = ~(size_t)0;
   return std::make_pair(LineNo, Ptr-BufStart-NewlineOffs);
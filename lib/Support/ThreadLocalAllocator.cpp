@@ -0,0 +1,82 @@
+//===- ThreadLocalAllocator.cpp - Per-thread bump pointer arenas ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the ThreadLocalBumpPtrAllocator interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadLocalAllocator.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+ThreadLocalBumpPtrAllocator::ThreadLocalBumpPtrAllocator() {}
+
+ThreadLocalBumpPtrAllocator::~ThreadLocalBumpPtrAllocator() {}
+
+BumpPtrAllocator &ThreadLocalBumpPtrAllocator::createThreadArena() {
+  sys::ScopedLock Guard(ArenasLock);
+  Arenas.push_back(make_unique<BumpPtrAllocator>());
+  BumpPtrAllocator *Arena = Arenas.back().get();
+  CurrentArena.set(Arena);
+  return *Arena;
+}
+
+void ThreadLocalBumpPtrAllocator::Reset() {
+  sys::ScopedLock Guard(ArenasLock);
+  for (auto &Arena : Arenas)
+    Arena->Reset();
+}
+
+size_t ThreadLocalBumpPtrAllocator::getNumArenas() const {
+  sys::ScopedLock Guard(ArenasLock);
+  return Arenas.size();
+}
+
+size_t ThreadLocalBumpPtrAllocator::GetNumSlabs() const {
+  sys::ScopedLock Guard(ArenasLock);
+  size_t NumSlabs = 0;
+  for (auto &Arena : Arenas)
+    NumSlabs += Arena->GetNumSlabs();
+  return NumSlabs;
+}
+
+size_t ThreadLocalBumpPtrAllocator::getTotalMemory() const {
+  sys::ScopedLock Guard(ArenasLock);
+  size_t TotalMemory = 0;
+  for (auto &Arena : Arenas)
+    TotalMemory += Arena->getTotalMemory();
+  return TotalMemory;
+}
+
+size_t ThreadLocalBumpPtrAllocator::getBytesAllocated() const {
+  sys::ScopedLock Guard(ArenasLock);
+  size_t BytesAllocated = 0;
+  for (auto &Arena : Arenas)
+    BytesAllocated += Arena->getBytesAllocated();
+  return BytesAllocated;
+}
+
+void ThreadLocalBumpPtrAllocator::PrintStats() const {
+  sys::ScopedLock Guard(ArenasLock);
+  size_t NumSlabs = 0, BytesAllocated = 0, TotalMemory = 0;
+  for (unsigned I = 0, E = Arenas.size(); I != E; ++I) {
+    const BumpPtrAllocator &Arena = *Arenas[I];
+    size_t ArenaMemory = Arena.getTotalMemory();
+    errs() << "Arena " << I << ": " << Arena.GetNumSlabs() << " slabs, "
+           << Arena.getBytesAllocated() << " bytes used, " << ArenaMemory
+           << " bytes allocated, "
+           << (ArenaMemory - Arena.getBytesAllocated()) << " bytes wasted\n";
+    NumSlabs += Arena.GetNumSlabs();
+    BytesAllocated += Arena.getBytesAllocated();
+    TotalMemory += ArenaMemory;
+  }
+  detail::printBumpPtrAllocatorStats(NumSlabs, BytesAllocated, TotalMemory);
+}
@@ -109,19 +109,39 @@ void raw_ostream::SetBufferAndMode(char *BufferStart, size_t Size,
   assert(OutBufStart <= OutBufEnd && "Invalid size!");
 }
 
-raw_ostream &raw_ostream::operator<<(unsigned long N) {
-  // Zero is a special case.
-  if (N == 0)
-    return *this << '0';
+/// Two-digit decimal strings for 00 to 99, so that integers can be formatted
+/// with half as many divisions.
+static const char DigitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536"
+    "37383940414243444546474849505152535455565758596061626364656667686970717273"
+    "7475767778798081828384858687888990919293949596979899";
+
+/// Format N in decimal, right-aligned so that it ends just before End, and
+/// return the position of its first digit.
+template <typename T> static char *formatDecimal(char *End, T N) {
+  while (N >= 100) {
+    unsigned Pair = static_cast<unsigned>(N % 100) * 2;
+    N /= 100;
+    *--End = DigitPairs[Pair + 1];
+    *--End = DigitPairs[Pair];
+  }
+  if (N >= 10) {
+    unsigned Pair = static_cast<unsigned>(N) * 2;
+    *--End = DigitPairs[Pair + 1];
+    *--End = DigitPairs[Pair];
+  } else {
+    *--End = char('0' + N);
+  }
+  return End;
+}
 
+raw_ostream &raw_ostream::operator<<(unsigned long N) {
   char NumberBuffer[20];
-  char *EndPtr = NumberBuffer+sizeof(NumberBuffer);
-  char *CurPtr = EndPtr;
-
-  while (N) {
-    *--CurPtr = '0' + char(N % 10);
-    N /= 10;
-  }
+  char *EndPtr = std::end(NumberBuffer);
+  // Use 32-bit div/mod when possible.
+  char *CurPtr = N == static_cast<uint32_t>(N)
+                     ? formatDecimal(EndPtr, static_cast<uint32_t>(N))
+                     : formatDecimal(EndPtr, N);
   return write(CurPtr, EndPtr-CurPtr);
 }
 
@@ -136,18 +156,12 @@ raw_ostream &raw_ostream::operator<<(long N) {
 }
 
 raw_ostream &raw_ostream::operator<<(unsigned long long N) {
-  // Output using 32-bit div/mod when possible.
   if (N == static_cast<unsigned long>(N))
     return this->operator<<(static_cast<unsigned long>(N));
 
   char NumberBuffer[20];
   char *EndPtr = std::end(NumberBuffer);
-  char *CurPtr = EndPtr;
-
-  while (N) {
-    *--CurPtr = '0' + char(N % 10);
-    N /= 10;
-  }
+  char *CurPtr = formatDecimal(EndPtr, N);
   return write(CurPtr, EndPtr-CurPtr);
 }
 
@@ -162,21 +176,21 @@ raw_ostream &raw_ostream::operator<<(long long N) {
 }
 
 raw_ostream &raw_ostream::write_hex(unsigned long long N) {
-  // Zero is a special case.
-  if (N == 0)
-    return *this << '0';
-
+  static const char HexDigits[] = "0123456789abcdef";
+  // The number of digits is known up front (zero still takes one), so they
+  // can be stored directly into the buffer when there is room for them.
+  size_t NumDigits = (64 - countLeadingZeros(N | 1) + 3) / 4;
   char NumberBuffer[16];
-  char *EndPtr = std::end(NumberBuffer);
-  char *CurPtr = EndPtr;
-
-  while (N) {
-    unsigned char x = static_cast<unsigned char>(N) % 16;
-    *--CurPtr = hexdigit(x, /*LowerCase*/true);
-    N /= 16;
+  char *CurPtr = size_t(OutBufEnd - OutBufCur) >= NumDigits ? OutBufCur
+                                                            : NumberBuffer;
+  for (char *Digit = CurPtr + NumDigits; Digit != CurPtr; N >>= 4)
+    *--Digit = HexDigits[N & 0xF];
+
+  if (CurPtr == OutBufCur) {
+    OutBufCur += NumDigits;
+    return *this;
   }
-
-  return write(CurPtr, EndPtr-CurPtr);
+  return write(CurPtr, NumDigits);
 }
 
 raw_ostream &raw_ostream::write_escaped(StringRef Str,
@@ -275,6 +289,12 @@ void raw_ostream::flush_nonempty() {
   write_impl(OutBufStart, Length);
 }
 
+void raw_ostream::writev_impl(const char *Buffered, size_t BufferedSize,
+                              const char *Ptr, size_t Size) {
+  write_impl(Buffered, BufferedSize);
+  write_impl(Ptr, Size);
+}
+
 raw_ostream &raw_ostream::write(unsigned char C) {
   // Group exceptional cases into a single branch.
   if (LLVM_UNLIKELY(OutBufCur >= OutBufEnd)) {
@@ -326,6 +346,16 @@ raw_ostream &raw_ostream::write(const char *Ptr, size_t Size) {
       return *this;
     }
 
+    // If the string would not fit even in an empty buffer, write out what is
+    // buffered together with the string rather than copying part of it into
+    // the buffer only to flush it straight away.
+    if (Size >= size_t(OutBufEnd - OutBufStart)) {
+      size_t Length = OutBufCur - OutBufStart;
+      OutBufCur = OutBufStart;
+      writev_impl(OutBufStart, Length, Ptr, Size);
+      return *this;
+    }
+
     // We don't have enough space in the buffer to fit the string in. Insert as
     // much as possible, flush and start over with the remainder.
     copy_to_buffer(Ptr, NumBytes);
@@ -613,6 +643,53 @@ void raw_fd_ostream::write_impl(const char *Ptr, size_t Size) {
   } while (Size > 0);
 }
 
+void raw_fd_ostream::writev_impl(const char *Buffered, size_t BufferedSize,
+                                 const char *Ptr, size_t Size) {
+#if defined(HAVE_SYS_UIO_H) && defined(HAVE_WRITEV)
+  assert(FD >= 0 && "File already closed.");
+  pos += BufferedSize + Size;
+
+  struct iovec IOV[2];
+  IOV[0].iov_base = const_cast<char *>(Buffered);
+  IOV[0].iov_len = BufferedSize;
+  IOV[1].iov_base = const_cast<char *>(Ptr);
+  IOV[1].iov_len = Size;
+  struct iovec *Cur = IOV;
+  int NumIOV = 2;
+
+  do {
+    ssize_t ret = ::writev(FD, Cur, NumIOV);
+
+    if (ret < 0) {
+      // Retry the same errors that write_impl does.
+      if (errno == EINTR || errno == EAGAIN
+#ifdef EWOULDBLOCK
+          || errno == EWOULDBLOCK
+#endif
+          )
+        continue;
+
+      error_detected();
+      break;
+    }
+
+    // Skip over whatever was written and retry with the rest.
+    size_t Written = ret;
+    while (NumIOV && Written >= Cur->iov_len) {
+      Written -= Cur->iov_len;
+      ++Cur;
+      --NumIOV;
+    }
+    if (NumIOV) {
+      Cur->iov_base = static_cast<char *>(Cur->iov_base) + Written;
+      Cur->iov_len -= Written;
+    }
+  } while (NumIOV);
+#else
+  raw_pwrite_stream::writev_impl(Buffered, BufferedSize, Ptr, Size);
+#endif
+}
+
 void raw_fd_ostream::close() {
   assert(ShouldClose);
   ShouldClose = false;
@@ -652,6 +729,12 @@ size_t raw_fd_ostream::preferred_buffer_size() const {
   // the complexity.
   if (S_ISCHR(statbuf.st_mode) && isatty(FD))
     return 0;
+  // Output files such as assembly listings and disassembly are usually large
+  // and written all at once, so use a buffer that takes many blocks per write.
+  // Keep to the preferred block size for pipes and devices, where a reader may
+  // be waiting on the output.
+  if (S_ISREG(statbuf.st_mode))
+    return std::max<size_t>(statbuf.st_blksize, 64 * 1024);
   // Return the preferred block size.
   return statbuf.st_blksize;
 #else
@@ -0,0 +1,541 @@
+//===- xxhash.cpp - xxHash ------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements XXH64 as described in
+// https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md, and the
+// 128-bit variant of XXH3 following the reference xxhash.h. Input words are
+// always read as little endian, so big endian hosts compute the same values.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/xxhash.h"
+#include "llvm/Support/Endian.h"
+#include <cstring>
+
+using namespace llvm;
+using namespace llvm::support;
+
+static const uint64_t PRIME64_1 = 11400714785074694791ULL;
+static const uint64_t PRIME64_2 = 14029467366897019727ULL;
+static const uint64_t PRIME64_3 = 1609587929392839161ULL;
+static const uint64_t PRIME64_4 = 9650029242287828579ULL;
+static const uint64_t PRIME64_5 = 2870177450012600261ULL;
+
+static inline uint64_t rotl64(uint64_t X, int R) {
+  return (X << R) | (X >> (64 - R));
+}
+
+static inline uint64_t xxhRound(uint64_t Acc, uint64_t Input) {
+  Acc += Input * PRIME64_2;
+  Acc = rotl64(Acc, 31);
+  Acc *= PRIME64_1;
+  return Acc;
+}
+
+static inline uint64_t mergeRound(uint64_t Acc, uint64_t Val) {
+  Val = xxhRound(0, Val);
+  Acc ^= Val;
+  Acc = Acc * PRIME64_1 + PRIME64_4;
+  return Acc;
+}
+
+/// Consume as many whole 32 byte stripes from \p P as fit before \p End,
+/// keeping four independent accumulators so the multiplies can overlap.
+static inline const uint8_t *consumeStripes(uint64_t Acc[4], const uint8_t *P,
+                                            const uint8_t *End) {
+  uint64_t V1 = Acc[0], V2 = Acc[1], V3 = Acc[2], V4 = Acc[3];
+  for (; End - P >= 32; P += 32) {
+    V1 = xxhRound(V1, endian::read64le(P));
+    V2 = xxhRound(V2, endian::read64le(P + 8));
+    V3 = xxhRound(V3, endian::read64le(P + 16));
+    V4 = xxhRound(V4, endian::read64le(P + 24));
+  }
+  Acc[0] = V1;
+  Acc[1] = V2;
+  Acc[2] = V3;
+  Acc[3] = V4;
+  return P;
+}
+
+/// Mix the accumulators with the length and the up to 31 trailing bytes in
+/// [P, End) into the final hash.
+static uint64_t finalize(const uint64_t Acc[4], uint64_t Seed,
+                         uint64_t TotalLength, const uint8_t *P,
+                         const uint8_t *End) {
+  uint64_t H64;
+  if (TotalLength >= 32) {
+    H64 = rotl64(Acc[0], 1) + rotl64(Acc[1], 7) + rotl64(Acc[2], 12) +
+          rotl64(Acc[3], 18);
+    for (unsigned I = 0; I != 4; ++I)
+      H64 = mergeRound(H64, Acc[I]);
+  } else {
+    H64 = Seed + PRIME64_5;
+  }
+
+  H64 += TotalLength;
+
+  for (; End - P >= 8; P += 8) {
+    H64 ^= xxhRound(0, endian::read64le(P));
+    H64 = rotl64(H64, 27) * PRIME64_1 + PRIME64_4;
+  }
+  if (End - P >= 4) {
+    H64 ^= static_cast<uint64_t>(endian::read32le(P)) * PRIME64_1;
+    H64 = rotl64(H64, 23) * PRIME64_2 + PRIME64_3;
+    P += 4;
+  }
+  for (; P != End; ++P) {
+    H64 ^= (*P) * PRIME64_5;
+    H64 = rotl64(H64, 11) * PRIME64_1;
+  }
+
+  H64 ^= H64 >> 33;
+  H64 *= PRIME64_2;
+  H64 ^= H64 >> 29;
+  H64 *= PRIME64_3;
+  H64 ^= H64 >> 32;
+  return H64;
+}
+
+static void initAccumulators(uint64_t Acc[4], uint64_t Seed) {
+  Acc[0] = Seed + PRIME64_1 + PRIME64_2;
+  Acc[1] = Seed + PRIME64_2;
+  Acc[2] = Seed;
+  Acc[3] = Seed - PRIME64_1;
+}
+
+void XXHash64::init(uint64_t Seed) {
+  this->Seed = Seed;
+  initAccumulators(Acc, Seed);
+  TotalLength = 0;
+  BufferSize = 0;
+}
+
+void XXHash64::update(ArrayRef<uint8_t> Data) {
+  if (Data.empty())
+    return;
+  const uint8_t *P = Data.begin();
+  const uint8_t *End = Data.end();
+  TotalLength += Data.size();
+
+  // Top up a partial stripe left over from the previous call first.
+  if (BufferSize) {
+    size_t Fill = std::min<size_t>(STRIPE_LENGTH - BufferSize, End - P);
+    memcpy(Buffer + BufferSize, P, Fill);
+    BufferSize += Fill;
+    P += Fill;
+    if (BufferSize < STRIPE_LENGTH)
+      return;
+    consumeStripes(Acc, Buffer, Buffer + STRIPE_LENGTH);
+    BufferSize = 0;
+  }
+
+  P = consumeStripes(Acc, P, End);
+
+  BufferSize = End - P;
+  memcpy(Buffer, P, BufferSize);
+}
+
+uint64_t XXHash64::result() const {
+  return finalize(Acc, Seed, TotalLength, Buffer, Buffer + BufferSize);
+}
+
+uint64_t XXHash64::hash(ArrayRef<uint8_t> Data, uint64_t Seed) {
+  uint64_t Acc[4];
+  initAccumulators(Acc, Seed);
+  const uint8_t *P = consumeStripes(Acc, Data.begin(), Data.end());
+  return finalize(Acc, Seed, Data.size(), P, Data.end());
+}
+
+//===----------------------------------------------------------------------===//
+// XXH3, 128-bit
+//===----------------------------------------------------------------------===//
+
+static const uint64_t PRIME32_1 = 0x9E3779B1U;
+static const uint64_t PRIME32_2 = 0x85EBCA77U;
+static const uint64_t PRIME32_3 = 0xC2B2AE3DU;
+static const uint64_t PRIME_MX1 = 0x165667919E3779F9ULL;
+static const uint64_t PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+/// The default secret of the reference implementation.
+static const uint8_t DefaultSecret[192] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c,
+    0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+    0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e,
+    0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+    0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+    0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97,
+    0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7,
+    0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+    0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+    0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26,
+    0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+    0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+    0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+typedef XXHash128::Result Hash128;
+
+/// Return the full 128-bit product of \p LHS and \p RHS.
+static inline Hash128 mult64to128(uint64_t LHS, uint64_t RHS) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t Product = static_cast<__uint128_t>(LHS) * RHS;
+  return {static_cast<uint64_t>(Product), static_cast<uint64_t>(Product >> 64)};
+#else
+  uint64_t LoLo = (LHS & 0xFFFFFFFF) * (RHS & 0xFFFFFFFF);
+  uint64_t HiLo = (LHS >> 32) * (RHS & 0xFFFFFFFF);
+  uint64_t LoHi = (LHS & 0xFFFFFFFF) * (RHS >> 32);
+  uint64_t HiHi = (LHS >> 32) * (RHS >> 32);
+  uint64_t Cross = (LoLo >> 32) + (HiLo & 0xFFFFFFFF) + LoHi;
+  uint64_t Upper = (HiLo >> 32) + (Cross >> 32) + HiHi;
+  uint64_t Lower = (Cross << 32) | (LoLo & 0xFFFFFFFF);
+  return {Lower, Upper};
+#endif
+}
+
+/// Multiply to 128 bits and fold the halves back into 64.
+static inline uint64_t mul128Fold64(uint64_t LHS, uint64_t RHS) {
+  Hash128 Product = mult64to128(LHS, RHS);
+  return Product.Low ^ Product.High;
+}
+
+static inline uint64_t xorShift64(uint64_t V, int Shift) {
+  return V ^ (V >> Shift);
+}
+
+static inline uint64_t xxh64Avalanche(uint64_t H) {
+  H ^= H >> 33;
+  H *= PRIME64_2;
+  H ^= H >> 29;
+  H *= PRIME64_3;
+  return H ^ (H >> 32);
+}
+
+static inline uint64_t xxh3Avalanche(uint64_t H) {
+  H = xorShift64(H, 37);
+  H *= PRIME_MX1;
+  return xorShift64(H, 32);
+}
+
+static inline uint32_t byteSwap32(uint32_t V) {
+  return (V << 24) | ((V << 8) & 0xFF0000) | ((V >> 8) & 0xFF00) | (V >> 24);
+}
+
+static inline uint64_t byteSwap64(uint64_t V) {
+  return (static_cast<uint64_t>(byteSwap32(static_cast<uint32_t>(V))) << 32) |
+         byteSwap32(static_cast<uint32_t>(V >> 32));
+}
+
+static Hash128 hashLen1To3(const uint8_t *P, size_t Len, const uint8_t *Secret,
+                           uint64_t Seed) {
+  uint32_t CombinedLo = (static_cast<uint32_t>(P[0]) << 16) |
+                        (static_cast<uint32_t>(P[Len >> 1]) << 24) |
+                        P[Len - 1] | static_cast<uint32_t>(Len << 8);
+  uint32_t CombinedHi = byteSwap32(CombinedLo);
+  CombinedHi = (CombinedHi << 13) | (CombinedHi >> 19);
+  uint64_t BitFlipLo =
+      (endian::read32le(Secret) ^ endian::read32le(Secret + 4)) + Seed;
+  uint64_t BitFlipHi =
+      (endian::read32le(Secret + 8) ^ endian::read32le(Secret + 12)) - Seed;
+  return {xxh64Avalanche(CombinedLo ^ BitFlipLo),
+          xxh64Avalanche(CombinedHi ^ BitFlipHi)};
+}
+
+static Hash128 hashLen4To8(const uint8_t *P, size_t Len, const uint8_t *Secret,
+                           uint64_t Seed) {
+  Seed ^= static_cast<uint64_t>(byteSwap32(static_cast<uint32_t>(Seed))) << 32;
+  uint64_t Input = endian::read32le(P) +
+                   (static_cast<uint64_t>(endian::read32le(P + Len - 4)) << 32);
+  uint64_t BitFlip =
+      (endian::read64le(Secret + 16) ^ endian::read64le(Secret + 24)) + Seed;
+  Hash128 M = mult64to128(Input ^ BitFlip, PRIME64_1 + (Len << 2));
+  M.High += M.Low << 1;
+  M.Low ^= M.High >> 3;
+  M.Low = xorShift64(M.Low, 35);
+  M.Low *= PRIME_MX2;
+  M.Low = xorShift64(M.Low, 28);
+  M.High = xxh3Avalanche(M.High);
+  return M;
+}
+
+static Hash128 hashLen9To16(const uint8_t *P, size_t Len,
+                            const uint8_t *Secret, uint64_t Seed) {
+  uint64_t BitFlipLo =
+      (endian::read64le(Secret + 32) ^ endian::read64le(Secret + 40)) - Seed;
+  uint64_t BitFlipHi =
+      (endian::read64le(Secret + 48) ^ endian::read64le(Secret + 56)) + Seed;
+  uint64_t InputLo = endian::read64le(P);
+  uint64_t InputHi = endian::read64le(P + Len - 8);
+  Hash128 M = mult64to128(InputLo ^ InputHi ^ BitFlipLo, PRIME64_1);
+  M.Low += static_cast<uint64_t>(Len - 1) << 54;
+  InputHi ^= BitFlipHi;
+  M.High += InputHi + (InputHi & 0xFFFFFFFF) * (PRIME32_2 - 1);
+  M.Low ^= byteSwap64(M.High);
+  Hash128 H = mult64to128(M.Low, PRIME64_2);
+  H.High += M.High * PRIME64_2;
+  return {xxh3Avalanche(H.Low), xxh3Avalanche(H.High)};
+}
+
+static Hash128 hashLen0To16(const uint8_t *P, size_t Len,
+                            const uint8_t *Secret, uint64_t Seed) {
+  if (Len > 8)
+    return hashLen9To16(P, Len, Secret, Seed);
+  if (Len >= 4)
+    return hashLen4To8(P, Len, Secret, Seed);
+  if (Len)
+    return hashLen1To3(P, Len, Secret, Seed);
+  uint64_t BitFlipLo =
+      endian::read64le(Secret + 64) ^ endian::read64le(Secret + 72);
+  uint64_t BitFlipHi =
+      endian::read64le(Secret + 80) ^ endian::read64le(Secret + 88);
+  return {xxh64Avalanche(Seed ^ BitFlipLo), xxh64Avalanche(Seed ^ BitFlipHi)};
+}
+
+static inline uint64_t mix16B(const uint8_t *P, const uint8_t *Secret,
+                              uint64_t Seed) {
+  return mul128Fold64(endian::read64le(P) ^ (endian::read64le(Secret) + Seed),
+                      endian::read64le(P + 8) ^
+                          (endian::read64le(Secret + 8) - Seed));
+}
+
+static inline void mix32B(Hash128 &Acc, const uint8_t *P1, const uint8_t *P2,
+                          const uint8_t *Secret, uint64_t Seed) {
+  Acc.Low += mix16B(P1, Secret, Seed);
+  Acc.Low ^= endian::read64le(P2) + endian::read64le(P2 + 8);
+  Acc.High += mix16B(P2, Secret + 16, Seed);
+  Acc.High ^= endian::read64le(P1) + endian::read64le(P1 + 8);
+}
+
+static Hash128 finalizeMidSize(const Hash128 &Acc, size_t Len, uint64_t Seed) {
+  uint64_t Low = Acc.Low + Acc.High;
+  uint64_t High = Acc.Low * PRIME64_1 + Acc.High * PRIME64_4 +
+                  (Len - Seed) * PRIME64_2;
+  return {xxh3Avalanche(Low), 0 - xxh3Avalanche(High)};
+}
+
+static Hash128 hashLen17To128(const uint8_t *P, size_t Len,
+                              const uint8_t *Secret, uint64_t Seed) {
+  Hash128 Acc = {Len * PRIME64_1, 0};
+  if (Len > 32) {
+    if (Len > 64) {
+      if (Len > 96)
+        mix32B(Acc, P + 48, P + Len - 64, Secret + 96, Seed);
+      mix32B(Acc, P + 32, P + Len - 48, Secret + 64, Seed);
+    }
+    mix32B(Acc, P + 16, P + Len - 32, Secret + 32, Seed);
+  }
+  mix32B(Acc, P, P + Len - 16, Secret, Seed);
+  return finalizeMidSize(Acc, Len, Seed);
+}
+
+static Hash128 hashLen129To240(const uint8_t *P, size_t Len,
+                               const uint8_t *Secret, uint64_t Seed) {
+  Hash128 Acc = {Len * PRIME64_1, 0};
+  unsigned NumRounds = Len / 32;
+  for (unsigned I = 0; I != 4; ++I)
+    mix32B(Acc, P + 32 * I, P + 32 * I + 16, Secret + 32 * I, Seed);
+  Acc.Low = xxh3Avalanche(Acc.Low);
+  Acc.High = xxh3Avalanche(Acc.High);
+  for (unsigned I = 4; I != NumRounds; ++I)
+    mix32B(Acc, P + 32 * I, P + 32 * I + 16, Secret + 3 + 32 * (I - 4), Seed);
+  mix32B(Acc, P + Len - 16, P + Len - 32, Secret + 136 - 17 - 16, 0 - Seed);
+  return finalizeMidSize(Acc, Len, Seed);
+}
+
+/// Mix one 64 byte stripe into the eight accumulators. The loop has no
+/// dependencies between lanes, so it vectorizes.
+static inline void accumulate512(uint64_t Acc[8], const uint8_t *P,
+                                 const uint8_t *Secret) {
+  for (unsigned I = 0; I != 8; ++I) {
+    uint64_t Data = endian::read64le(P + 8 * I);
+    uint64_t Key = Data ^ endian::read64le(Secret + 8 * I);
+    Acc[I ^ 1] += Data;
+    Acc[I] += (Key & 0xFFFFFFFF) * (Key >> 32);
+  }
+}
+
+static inline void scrambleAcc(uint64_t Acc[8], const uint8_t *Secret) {
+  for (unsigned I = 0; I != 8; ++I)
+    Acc[I] = (xorShift64(Acc[I], 47) ^ endian::read64le(Secret + 8 * I)) *
+             PRIME32_1;
+}
+
+enum : size_t {
+  XXH3_STRIPE_LEN = 64,
+  XXH3_SECRET_SIZE = 192,
+  XXH3_SECRET_LIMIT = XXH3_SECRET_SIZE - XXH3_STRIPE_LEN,
+  XXH3_STRIPES_PER_BLOCK = XXH3_SECRET_LIMIT / 8,
+  XXH3_BLOCK_LEN = XXH3_STRIPE_LEN * XXH3_STRIPES_PER_BLOCK,
+  XXH3_MAX_MIDSIZE = 240
+};
+
+/// Accumulate \p NumStripes stripes from \p P into a block that already holds
+/// \p StripesSoFar stripes, scrambling when the block is complete.
+static void consumeStripes128(uint64_t Acc[8], unsigned &StripesSoFar,
+                              const uint8_t *P, size_t NumStripes,
+                              const uint8_t *Secret) {
+  while (NumStripes) {
+    size_t Count =
+        std::min<size_t>(NumStripes, XXH3_STRIPES_PER_BLOCK - StripesSoFar);
+    for (size_t I = 0; I != Count; ++I)
+      accumulate512(Acc, P + I * XXH3_STRIPE_LEN,
+                    Secret + (StripesSoFar + I) * 8);
+    P += Count * XXH3_STRIPE_LEN;
+    NumStripes -= Count;
+    StripesSoFar += Count;
+    if (StripesSoFar == XXH3_STRIPES_PER_BLOCK) {
+      scrambleAcc(Acc, Secret + XXH3_SECRET_LIMIT);
+      StripesSoFar = 0;
+    }
+  }
+}
+
+static inline uint64_t mergeAccs(const uint64_t Acc[8], const uint8_t *Secret,
+                                 uint64_t Start) {
+  uint64_t Result = Start;
+  for (unsigned I = 0; I != 4; ++I)
+    Result += mul128Fold64(Acc[2 * I] ^ endian::read64le(Secret + 16 * I),
+                           Acc[2 * I + 1] ^
+                               endian::read64le(Secret + 16 * I + 8));
+  return xxh3Avalanche(Result);
+}
+
+static Hash128 finalizeLong(const uint64_t Acc[8], uint64_t Len,
+                            const uint8_t *Secret) {
+  return {mergeAccs(Acc, Secret + 11, Len * PRIME64_1),
+          mergeAccs(Acc, Secret + XXH3_SECRET_SIZE - 64 - 11,
+                    ~(Len * PRIME64_2))};
+}
+
+static void initAccumulators128(uint64_t Acc[8]) {
+  const uint64_t Init[8] = {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3,
+                            PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1};
+  memcpy(Acc, Init, sizeof(Init));
+}
+
+/// Derive the secret for the inputs over 240 bytes from \p Seed.
+static void initSecret(uint8_t Secret[192], uint64_t Seed) {
+  for (unsigned I = 0; I != XXH3_SECRET_SIZE; I += 16) {
+    endian::write64le(Secret + I, endian::read64le(DefaultSecret + I) + Seed);
+    endian::write64le(Secret + I + 8,
+                      endian::read64le(DefaultSecret + I + 8) - Seed);
+  }
+}
+
+static Hash128 hashLong(const uint8_t *P, size_t Len, const uint8_t *Secret) {
+  uint64_t Acc[8];
+  initAccumulators128(Acc);
+  unsigned StripesSoFar = 0;
+  // The last stripe is always mixed in separately, even when the input is a
+  // whole number of stripes.
+  consumeStripes128(Acc, StripesSoFar, P, (Len - 1) / XXH3_STRIPE_LEN,
+                    Secret);
+  accumulate512(Acc, P + Len - XXH3_STRIPE_LEN,
+                Secret + XXH3_SECRET_LIMIT - 7);
+  return finalizeLong(Acc, Len, Secret);
+}
+
+static Hash128 hashShort(const uint8_t *P, size_t Len, uint64_t Seed) {
+  if (Len <= 16)
+    return hashLen0To16(P, Len, DefaultSecret, Seed);
+  if (Len <= 128)
+    return hashLen17To128(P, Len, DefaultSecret, Seed);
+  return hashLen129To240(P, Len, DefaultSecret, Seed);
+}
+
+std::array<uint8_t, 16> XXHash128::Result::bytes() const {
+  std::array<uint8_t, 16> Bytes;
+  endian::write64be(Bytes.data(), High);
+  endian::write64be(Bytes.data() + 8, Low);
+  return Bytes;
+}
+
+void XXHash128::init(uint64_t Seed) {
+  this->Seed = Seed;
+  initAccumulators128(Acc);
+  initSecret(Secret, Seed);
+  TotalLength = 0;
+  StripesSoFar = 0;
+  BufferSize = 0;
+}
+
+void XXHash128::update(ArrayRef<uint8_t> Data) {
+  if (Data.empty())
+    return;
+  const uint8_t *P = Data.begin();
+  const uint8_t *End = Data.end();
+  TotalLength += Data.size();
+
+  if (Data.size() <= BUFFER_SIZE - BufferSize) {
+    memcpy(Buffer + BufferSize, P, Data.size());
+    BufferSize += Data.size();
+    return;
+  }
+
+  // The buffer only holds stripes that might be the last one, so consume it
+  // once more input arrives.
+  const unsigned BufferStripes = BUFFER_SIZE / STRIPE_LENGTH;
+  if (BufferSize) {
+    size_t Fill = BUFFER_SIZE - BufferSize;
+    memcpy(Buffer + BufferSize, P, Fill);
+    P += Fill;
+    consumeStripes128(Acc, StripesSoFar, Buffer, BufferStripes, Secret);
+    BufferSize = 0;
+  }
+
+  if (End - P > BUFFER_SIZE) {
+    do {
+      consumeStripes128(Acc, StripesSoFar, P, BufferStripes, Secret);
+      P += BUFFER_SIZE;
+    } while (End - P > BUFFER_SIZE);
+    // Keep the last consumed stripe, result() needs it when fewer than a
+    // stripe's worth of bytes are left.
+    memcpy(Buffer + BUFFER_SIZE - STRIPE_LENGTH, P - STRIPE_LENGTH,
+           STRIPE_LENGTH);
+  }
+
+  BufferSize = End - P;
+  memcpy(Buffer, P, BufferSize);
+}
+
+XXHash128::Result XXHash128::result() const {
+  if (TotalLength <= XXH3_MAX_MIDSIZE)
+    return hashShort(Buffer, TotalLength, Seed);
+
+  uint64_t FinalAcc[8];
+  memcpy(FinalAcc, Acc, sizeof(Acc));
+  unsigned FinalStripes = StripesSoFar;
+  const uint8_t *LastStripe;
+  uint8_t CatchUp[STRIPE_LENGTH];
+  if (BufferSize >= STRIPE_LENGTH) {
+    consumeStripes128(FinalAcc, FinalStripes, Buffer,
+                      (BufferSize - 1) / STRIPE_LENGTH, Secret);
+    LastStripe = Buffer + BufferSize - STRIPE_LENGTH;
+  } else {
+    // The last stripe starts in the previously consumed data.
+    size_t Missing = STRIPE_LENGTH - BufferSize;
+    memcpy(CatchUp, Buffer + BUFFER_SIZE - Missing, Missing);
+    memcpy(CatchUp + Missing, Buffer, BufferSize);
+    LastStripe = CatchUp;
+  }
+  accumulate512(FinalAcc, LastStripe, Secret + XXH3_SECRET_LIMIT - 7);
+  return finalizeLong(FinalAcc, TotalLength, Secret);
+}
+
+XXHash128::Result XXHash128::hash(ArrayRef<uint8_t> Data, uint64_t Seed) {
+  if (Data.size() <= XXH3_MAX_MIDSIZE)
+    return hashShort(Data.data(), Data.size(), Seed);
+  if (!Seed)
+    return hashLong(Data.data(), Data.size(), DefaultSecret);
+  uint8_t Secret[XXH3_SECRET_SIZE];
+  initSecret(Secret, Seed);
+  return hashLong(Data.data(), Data.size(), Secret);
+}
@@ -20,6 +20,7 @@
 #include "llvm/IR/AutoUpgrade.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/MappedSummaryIndex.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Linker/Linker.h"
@@ -28,14 +29,19 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Transforms/IPO/Internalize.h"
 #include "llvm/Transforms/Utils/FunctionImportUtils.h"
 
+#include <queue>
+
 #define DEBUG_TYPE "function-import"
 
 using namespace llvm;
 
 STATISTIC(NumImported, "Number of functions imported");
+STATISTIC(NumHotImports, "Number of imports decided through hot call edges");
+STATISTIC(NumOverBudget, "Number of imports rejected by the module budget");
 
 /// Limit on instruction count of imported functions.
 static cl::opt<unsigned> ImportInstrLimit(
@@ -49,6 +55,25 @@ static cl::opt<float>
                                "`import-instr-limit` threshold by this factor "
                                "before processing newly imported functions"));
 
+static cl::opt<float> ImportHotMultiplier(
+    "import-hot-multiplier", cl::init(3.0), cl::Hidden, cl::value_desc("x"),
+    cl::desc("Multiply the `import-instr-limit` threshold for hot call edges"));
+
+static cl::opt<float> ImportColdMultiplier(
+    "import-cold-multiplier", cl::init(1.0), cl::Hidden, cl::value_desc("x"),
+    cl::desc("Multiply the `import-instr-limit` threshold for call edges "
+             "that were never executed, when the index has profile data"));
+
+static cl::opt<unsigned> ImportHotPercent(
+    "import-hot-percent", cl::init(1), cl::Hidden, cl::value_desc("N"),
+    cl::desc("A call edge is hot when its profile count is at least N% of "
+             "the count of the hottest call edge of the index"));
+
+static cl::opt<unsigned> ImportInstrBudget(
+    "import-instr-budget", cl::init(0), cl::Hidden, cl::value_desc("N"),
+    cl::desc("Import at most N instructions into a module, hottest call "
+             "edges first (0 = unlimited)"));
+
 static cl::opt<bool> PrintImports("print-imports", cl::init(false), cl::Hidden,
                                   cl::desc("Print imported functions"));
 
@@ -257,91 +282,204 @@ static void exportGlobalInModule(const ModuleSummaryIndex &Index,
   }
 }
 
-using EdgeInfo = std::pair<const FunctionSummary *, unsigned /* Threshold */>;
+/// A call edge that may be imported into the current module: the callee, the
+/// threshold it must fit and the profile count of the edge, which decides the
+/// order in which the candidates are considered.
+struct ImportCandidate {
+  GlobalValue::GUID GUID;
+  /// The threshold at the depth of the edge, before the hot or cold
+  /// multiplier of the edge is applied. The callees of the candidate get
+  /// this threshold decayed by ImportInstrFactor.
+  unsigned BaseThreshold;
+  unsigned Threshold;
+  uint64_t ProfileCount;
+  unsigned Order;
+};
 
-/// Compute the list of functions to import for a given caller. Mark these
-/// imported functions and the symbols they reference in their source module as
-/// exported from their source module.
-static void computeImportForFunction(
-    const FunctionSummary &Summary, const ModuleSummaryIndex &Index,
-    unsigned Threshold, const GVSummaryMapTy &DefinedGVSummaries,
-    SmallVectorImpl<EdgeInfo> &Worklist,
-    FunctionImporter::ImportMapTy &ImportsForModule,
-    StringMap<FunctionImporter::ExportSetTy> *ExportLists = nullptr) {
+/// Order the candidates hottest first. Candidates with the same count are
+/// considered most recent first, which walks the call graph depth first.
+struct ImportCandidateLess {
+  bool operator()(const ImportCandidate &A, const ImportCandidate &B) const {
+    if (A.ProfileCount != B.ProfileCount)
+      return A.ProfileCount < B.ProfileCount;
+    return A.Order < B.Order;
+  }
+};
+
+/// Per module state of the import computation.
+struct ModuleImportState {
+  std::priority_queue<ImportCandidate, std::vector<ImportCandidate>,
+                      ImportCandidateLess>
+      Candidates;
+  unsigned NextOrder = 0;
+  /// Instructions imported so far, charged against ImportInstrBudget.
+  uint64_t ImportedInstrs = 0;
+  /// The count of the hottest call edge in the index, zero without profile.
+  uint64_t MaxProfileCount;
+
+  explicit ModuleImportState(uint64_t MaxProfileCount)
+      : MaxProfileCount(MaxProfileCount) {}
+};
+
+/// Return the count of the hottest call edge in \p Index.
+static uint64_t getMaxProfileCount(const ModuleSummaryIndex &Index) {
+  uint64_t MaxCount = 0;
+  for (auto &GlobalList : Index)
+    for (auto &Summary : GlobalList.second)
+      if (auto *FS = dyn_cast<FunctionSummary>(Summary.get()))
+        for (auto &Edge : FS->calls())
+          MaxCount = std::max(MaxCount, Edge.second.ProfileCount);
+  return MaxCount;
+}
+
+/// Return true if a call edge with \p ProfileCount is hot, compared to the
+/// hottest edge of the index.
+static bool isHotCount(uint64_t ProfileCount, uint64_t MaxProfileCount) {
+  return ProfileCount && double(ProfileCount) * 100 >=
+                             double(MaxProfileCount) * ImportHotPercent;
+}
+
+/// Return the threshold for importing through a call edge with the given
+/// profile count, with \p Threshold the base threshold at the depth of the
+/// edge.
+static unsigned getEdgeThreshold(unsigned Threshold, uint64_t ProfileCount,
+                                 uint64_t MaxProfileCount) {
+  if (!MaxProfileCount)
+    return Threshold;
+  if (!ProfileCount)
+    return Threshold * ImportColdMultiplier;
+  if (isHotCount(ProfileCount, MaxProfileCount))
+    return Threshold * ImportHotMultiplier;
+  return Threshold;
+}
+
+/// Queue the callees of \p Summary as import candidates, with \p
+/// BaseThreshold the threshold at their depth.
+static void addImportCandidates(const FunctionSummary &Summary,
+                                unsigned BaseThreshold,
+                                const GVSummaryMapTy &DefinedGVSummaries,
+                                ModuleImportState &State) {
   for (auto &Edge : Summary.calls()) {
     auto GUID = Edge.first.getGUID();
-    DEBUG(dbgs() << " edge -> " << GUID << " Threshold:" << Threshold << "\n");
-
     if (DefinedGVSummaries.count(GUID)) {
-      DEBUG(dbgs() << "ignored! Target already in destination module.\n");
+      DEBUG(dbgs() << " edge -> " << GUID
+                   << " ignored! Target already in destination module.\n");
       continue;
     }
+    ImportCandidate Candidate;
+    Candidate.GUID = GUID;
+    Candidate.BaseThreshold = BaseThreshold;
+    Candidate.Threshold = getEdgeThreshold(
+        BaseThreshold, Edge.second.ProfileCount, State.MaxProfileCount);
+    Candidate.ProfileCount = Edge.second.ProfileCount;
+    Candidate.Order = State.NextOrder++;
+    State.Candidates.push(Candidate);
+  }
+}
 
-    auto *CalleeSummary = selectCallee(GUID, Threshold, Index);
-    if (!CalleeSummary) {
-      DEBUG(dbgs() << "ignored! No qualifying callee with summary found.\n");
-      continue;
+/// Decide whether to import \p Candidate. If it is imported, mark it and the
+/// symbols it references in its source module as exported from that module,
+/// and queue its own callees.
+static void computeImportForCandidate(
+    const ImportCandidate &Candidate, const ModuleSummaryIndex &Index,
+    const GVSummaryMapTy &DefinedGVSummaries, ModuleImportState &State,
+    FunctionImporter::ImportMapTy &ImportsForModule,
+    StringMap<FunctionImporter::ExportSetTy> *ExportLists) {
+  auto GUID = Candidate.GUID;
+  auto Threshold = Candidate.Threshold;
+  DEBUG(dbgs() << " edge -> " << GUID << " Threshold:" << Threshold
+               << " Count:" << Candidate.ProfileCount << "\n");
+
+  auto *CalleeSummary = selectCallee(GUID, Threshold, Index);
+  if (!CalleeSummary) {
+    DEBUG(dbgs() << "ignored! No qualifying callee with summary found.\n");
+    return;
+  }
+  // "Resolve" the summary, traversing alias,
+  const FunctionSummary *ResolvedCalleeSummary;
+  if (isa<AliasSummary>(CalleeSummary)) {
+    ResolvedCalleeSummary = cast<FunctionSummary>(
+        &cast<AliasSummary>(CalleeSummary)->getAliasee());
+    assert(
+        GlobalValue::isLinkOnceODRLinkage(ResolvedCalleeSummary->linkage()) &&
+        "Unexpected alias to a non-linkonceODR in import list");
+  } else
+    ResolvedCalleeSummary = cast<FunctionSummary>(CalleeSummary);
+
+  assert(ResolvedCalleeSummary->instCount() <= Threshold &&
+         "selectCallee() didn't honor the threshold");
+
+  auto ExportModulePath = ResolvedCalleeSummary->modulePath();
+  unsigned ProcessedThreshold = 0;
+  auto ImportsFromModule = ImportsForModule.find(ExportModulePath);
+  if (ImportsFromModule != ImportsForModule.end()) {
+    auto Found = ImportsFromModule->second.find(GUID);
+    if (Found != ImportsFromModule->second.end())
+      ProcessedThreshold = Found->second;
+  }
+  /// Since the traversal of the call graph is DFS, we can revisit a function
+  /// a second time with a higher threshold. In this case, it is added back to
+  /// the worklist with the new threshold.
+  if (ProcessedThreshold && ProcessedThreshold >= Threshold) {
+    DEBUG(dbgs() << "ignored! Target was already seen with Threshold "
+                 << ProcessedThreshold << "\n");
+    return;
+  }
+
+  if (!ProcessedThreshold) {
+    // A new import must fit in what is left of the budget of the module.
+    auto InstCount = ResolvedCalleeSummary->instCount();
+    if (ImportInstrBudget &&
+        State.ImportedInstrs + InstCount > ImportInstrBudget) {
+      DEBUG(dbgs() << "ignored! Import budget exhausted after "
+                   << State.ImportedInstrs << " instructions\n");
+      ++NumOverBudget;
+      return;
     }
-    // "Resolve" the summary, traversing alias,
-    const FunctionSummary *ResolvedCalleeSummary;
-    if (isa<AliasSummary>(CalleeSummary)) {
-      ResolvedCalleeSummary = cast<FunctionSummary>(
-          &cast<AliasSummary>(CalleeSummary)->getAliasee());
-      assert(
-          GlobalValue::isLinkOnceODRLinkage(ResolvedCalleeSummary->linkage()) &&
-          "Unexpected alias to a non-linkonceODR in import list");
-    } else
-      ResolvedCalleeSummary = cast<FunctionSummary>(CalleeSummary);
-
-    assert(ResolvedCalleeSummary->instCount() <= Threshold &&
-           "selectCallee() didn't honor the threshold");
-
-    auto ExportModulePath = ResolvedCalleeSummary->modulePath();
-    auto &ProcessedThreshold = ImportsForModule[ExportModulePath][GUID];
-    /// Since the traversal of the call graph is DFS, we can revisit a function
-    /// a second time with a higher threshold. In this case, it is added back to
-    /// the worklist with the new threshold.
-    if (ProcessedThreshold && ProcessedThreshold >= Threshold) {
-      DEBUG(dbgs() << "ignored! Target was already seen with Threshold "
-                   << ProcessedThreshold << "\n");
-      continue;
+    State.ImportedInstrs += InstCount;
+    if (isHotCount(Candidate.ProfileCount, State.MaxProfileCount))
+      ++NumHotImports;
+  }
+  // Mark this function as imported in this module, with the current Threshold
+  ImportsForModule[ExportModulePath][GUID] = Threshold;
+
+  // Make exports in the source module.
+  if (ExportLists) {
+    auto &ExportList = (*ExportLists)[ExportModulePath];
+    ExportList.insert(GUID);
+    // Mark all functions and globals referenced by this function as exported
+    // to the outside if they are defined in the same source module.
+    for (auto &Edge : ResolvedCalleeSummary->calls()) {
+      auto CalleeGUID = Edge.first.getGUID();
+      exportGlobalInModule(Index, ExportModulePath, CalleeGUID, ExportList);
     }
-    // Mark this function as imported in this module, with the current Threshold
-    ProcessedThreshold = Threshold;
-
-    // Make exports in the source module.
-    if (ExportLists) {
-      auto &ExportList = (*ExportLists)[ExportModulePath];
-      ExportList.insert(GUID);
-      // Mark all functions and globals referenced by this function as exported
-      // to the outside if they are defined in the same source module.
-      for (auto &Edge : ResolvedCalleeSummary->calls()) {
-        auto CalleeGUID = Edge.first.getGUID();
-        exportGlobalInModule(Index, ExportModulePath, CalleeGUID, ExportList);
-      }
-      for (auto &Ref : ResolvedCalleeSummary->refs()) {
-        auto GUID = Ref.getGUID();
-        exportGlobalInModule(Index, ExportModulePath, GUID, ExportList);
-      }
+    for (auto &Ref : ResolvedCalleeSummary->refs()) {
+      auto GUID = Ref.getGUID();
+      exportGlobalInModule(Index, ExportModulePath, GUID, ExportList);
     }
-
-    // Insert the newly imported function to the worklist.
-    Worklist.push_back(std::make_pair(ResolvedCalleeSummary, Threshold));
   }
+
+  // Process the callees of the newly imported function, adjusting the
+  // threshold. The multiplier of this edge is not carried over, so that the
+  // threshold of a chain of hot edges still decays with depth.
+  addImportCandidates(*ResolvedCalleeSummary,
+                      Candidate.BaseThreshold * ImportInstrFactor,
+                      DefinedGVSummaries, State);
 }
 
 /// Given the list of globals defined in a module, compute the list of imports
 /// as well as the list of "exports", i.e. the list of symbols referenced from
 /// another module (that may require promotion).
+///
+/// The call edges leaving the module are considered hottest first, so that
+/// the hot callees get the budget of the module when there is one.
 static void ComputeImportForModule(
     const GVSummaryMapTy &DefinedGVSummaries, const ModuleSummaryIndex &Index,
-    FunctionImporter::ImportMapTy &ImportsForModule,
+    uint64_t MaxProfileCount, FunctionImporter::ImportMapTy &ImportsForModule,
     StringMap<FunctionImporter::ExportSetTy> *ExportLists = nullptr) {
-  // Worklist contains the list of function imported in this module, for which
-  // we will analyse the callees and may import further down the callgraph.
-  SmallVector<EdgeInfo, 128> Worklist;
+  ModuleImportState State(MaxProfileCount);
 
-  // Populate the worklist with the import for the functions in the current
+  // Populate the candidates with the callees of the functions in the current
   // module
   for (auto &GVSummary : DefinedGVSummaries) {
     auto *Summary = GVSummary.second;
@@ -352,22 +490,15 @@ static void ComputeImportForModule(
       // Skip import for global variables
       continue;
     DEBUG(dbgs() << "Initalize import for " << GVSummary.first << "\n");
-    computeImportForFunction(*FuncSummary, Index, ImportInstrLimit,
-                             DefinedGVSummaries, Worklist, ImportsForModule,
-                             ExportLists);
+    addImportCandidates(*FuncSummary, ImportInstrLimit, DefinedGVSummaries,
+                        State);
   }
 
-  while (!Worklist.empty()) {
-    auto FuncInfo = Worklist.pop_back_val();
-    auto *Summary = FuncInfo.first;
-    auto Threshold = FuncInfo.second;
-
-    // Process the newly imported functions and add callees to the worklist.
-    // Adjust the threshold
-    Threshold = Threshold * ImportInstrFactor;
-
-    computeImportForFunction(*Summary, Index, Threshold, DefinedGVSummaries,
-                             Worklist, ImportsForModule, ExportLists);
+  while (!State.Candidates.empty()) {
+    ImportCandidate Candidate = State.Candidates.top();
+    State.Candidates.pop();
+    computeImportForCandidate(Candidate, Index, DefinedGVSummaries, State,
+                              ImportsForModule, ExportLists);
   }
 }
 
@@ -378,14 +509,55 @@ void llvm::ComputeCrossModuleImport(
     const ModuleSummaryIndex &Index,
     const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
     StringMap<FunctionImporter::ImportMapTy> &ImportLists,
-    StringMap<FunctionImporter::ExportSetTy> &ExportLists) {
+    StringMap<FunctionImporter::ExportSetTy> &ExportLists,
+    unsigned ThreadCount) {
+  // The threads below iterate the index, which must already be sorted.
+  assert(Index.isFinalized() && "Index must be finalized before the import");
+  uint64_t MaxProfileCount = getMaxProfileCount(Index);
+
+  bool Serial = ThreadCount <= 1 || ModuleToDefinedGVSummaries.size() <= 1;
+#ifndef NDEBUG
+  // The per module debug output would interleave between the threads.
+  if (DebugFlag && isCurrentDebugType(DEBUG_TYPE))
+    Serial = true;
+#endif
+
   // For each module that has function defined, compute the import/export lists.
-  for (auto &DefinedGVSummaries : ModuleToDefinedGVSummaries) {
-    auto &ImportsForModule = ImportLists[DefinedGVSummaries.first()];
-    DEBUG(dbgs() << "Computing import for Module '"
-                 << DefinedGVSummaries.first() << "'\n");
-    ComputeImportForModule(DefinedGVSummaries.second, Index, ImportsForModule,
-                           &ExportLists);
+  if (Serial) {
+    for (auto &DefinedGVSummaries : ModuleToDefinedGVSummaries) {
+      auto &ImportsForModule = ImportLists[DefinedGVSummaries.first()];
+      DEBUG(dbgs() << "Computing import for Module '"
+                   << DefinedGVSummaries.first() << "'\n");
+      ComputeImportForModule(DefinedGVSummaries.second, Index,
+                             MaxProfileCount, ImportsForModule, &ExportLists);
+    }
+  } else {
+    // The modules are independent, apart from the exports they cause in
+    // other modules. Create the import list of every module up front so that
+    // the tasks don't modify ImportLists, and collect the exports of each
+    // module separately to merge them once all the tasks are done.
+    std::vector<std::pair<const GVSummaryMapTy *,
+                          FunctionImporter::ImportMapTy *>> Work;
+    for (auto &DefinedGVSummaries : ModuleToDefinedGVSummaries)
+      Work.push_back(std::make_pair(
+          &DefinedGVSummaries.second,
+          &ImportLists[DefinedGVSummaries.first()]));
+    std::vector<StringMap<FunctionImporter::ExportSetTy>> ModuleExports(
+        Work.size());
+    {
+      ThreadPool Pool(ThreadCount);
+      for (unsigned I = 0, E = Work.size(); I != E; ++I)
+        Pool.async([&](unsigned I) {
+          ComputeImportForModule(*Work[I].first, Index, MaxProfileCount,
+                                 *Work[I].second, &ModuleExports[I]);
+        }, I);
+    }
+    for (auto &Exports : ModuleExports)
+      for (auto &ModuleExport : Exports) {
+        auto &ExportList = ExportLists[ModuleExport.first()];
+        ExportList.insert(ModuleExport.second.begin(),
+                          ModuleExport.second.end());
+      }
   }
 
 #ifndef NDEBUG
@@ -406,10 +578,12 @@ void llvm::ComputeCrossModuleImport(
 #endif
 }
 
-/// Compute all the imports for the given module in the Index.
-void llvm::ComputeCrossModuleImportForModule(
+/// Compute all the imports for the given module in the Index, with \p
+/// MaxProfileCount the highest profile count of the thin link, which \p Index
+/// may only be a part of.
+static void computeImportForModuleInIndex(
     StringRef ModulePath, const ModuleSummaryIndex &Index,
-    FunctionImporter::ImportMapTy &ImportList) {
+    uint64_t MaxProfileCount, FunctionImporter::ImportMapTy &ImportList) {
 
   // Collect the list of functions this module defines.
   // GUID -> Summary
@@ -418,7 +592,8 @@ void llvm::ComputeCrossModuleImportForModule(
 
   // Compute the import list for this module.
   DEBUG(dbgs() << "Computing import for Module '" << ModulePath << "'\n");
-  ComputeImportForModule(FunctionSummaryMap, Index, ImportList);
+  ComputeImportForModule(FunctionSummaryMap, Index, MaxProfileCount,
+                         ImportList);
 
 #ifndef NDEBUG
   DEBUG(dbgs() << "* Module " << ModulePath << " imports from "
@@ -431,6 +606,14 @@ void llvm::ComputeCrossModuleImportForModule(
 #endif
 }
 
+/// Compute all the imports for the given module in the Index.
+void llvm::ComputeCrossModuleImportForModule(
+    StringRef ModulePath, const ModuleSummaryIndex &Index,
+    FunctionImporter::ImportMapTy &ImportList) {
+  computeImportForModuleInIndex(ModulePath, Index, getMaxProfileCount(Index),
+                                ImportList);
+}
+
 /// Compute the set of summaries needed for a ThinLTO backend compilation of
 /// \p ModulePath.
 void llvm::gatherImportedSummariesForModule(
@@ -697,10 +880,12 @@ static void diagnosticHandler(const DiagnosticInfo &DI) {
 }
 
 /// Parse the summary index out of an IR file and return the summary
-/// index object if found, or nullptr if not.
+/// index object if found, or nullptr if not. A mapped summary index is
+/// queried in place for the summaries importing into \p ModulePath needs.
+/// \p MaxProfileCount is set to the highest profile count of the whole index.
 static std::unique_ptr<ModuleSummaryIndex> getModuleSummaryIndexForFile(
-    StringRef Path, std::string &Error,
-    const DiagnosticHandlerFunction &DiagnosticHandler) {
+    StringRef Path, StringRef ModulePath, uint64_t &MaxProfileCount,
+    std::string &Error, const DiagnosticHandlerFunction &DiagnosticHandler) {
   std::unique_ptr<MemoryBuffer> Buffer;
   ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
       MemoryBuffer::getFile(Path);
@@ -709,6 +894,16 @@ static std::unique_ptr<ModuleSummaryIndex> getModuleSummaryIndexForFile(
     return nullptr;
   }
   Buffer = std::move(BufferOrErr.get());
+  if (MappedSummaryIndex::isMappedSummaryIndex(Buffer->getMemBufferRef())) {
+    Expected<std::unique_ptr<MappedSummaryIndex>> MappedOrErr =
+        MappedSummaryIndex::create(Buffer->getMemBufferRef());
+    if (!MappedOrErr) {
+      Error = toString(MappedOrErr.takeError());
+      return nullptr;
+    }
+    MaxProfileCount = (*MappedOrErr)->getMaxProfileCount();
+    return (*MappedOrErr)->materializeForModule(ModulePath);
+  }
   ErrorOr<std::unique_ptr<object::ModuleSummaryIndexObjectFile>> ObjOrErr =
       object::ModuleSummaryIndexObjectFile::create(Buffer->getMemBufferRef(),
                                                    DiagnosticHandler);
@@ -716,7 +911,10 @@ static std::unique_ptr<ModuleSummaryIndex> getModuleSummaryIndexForFile(
     Error = EC.message();
     return nullptr;
   }
-  return (*ObjOrErr)->takeIndex();
+  std::unique_ptr<ModuleSummaryIndex> Index = (*ObjOrErr)->takeIndex();
+  if (Index)
+    MaxProfileCount = getMaxProfileCount(*Index);
+  return Index;
 }
 
 static bool doImportingForModule(Module &M, const ModuleSummaryIndex *Index) {
@@ -724,23 +922,27 @@ static bool doImportingForModule(Module &M, const ModuleSummaryIndex *Index) {
     report_fatal_error("error: -function-import requires -summary-file or "
                        "file from frontend\n");
   std::unique_ptr<ModuleSummaryIndex> IndexPtr;
+  uint64_t MaxProfileCount;
   if (!SummaryFile.empty()) {
     if (Index)
       report_fatal_error("error: -summary-file and index from frontend\n");
     std::string Error;
     IndexPtr =
-        getModuleSummaryIndexForFile(SummaryFile, Error, diagnosticHandler);
+        getModuleSummaryIndexForFile(SummaryFile, M.getModuleIdentifier(),
+                                     MaxProfileCount, Error, diagnosticHandler);
     if (!IndexPtr) {
       errs() << "Error loading file '" << SummaryFile << "': " << Error << "\n";
       return false;
     }
     Index = IndexPtr.get();
+  } else {
+    MaxProfileCount = getMaxProfileCount(*Index);
   }
 
   // First step is collecting the import list.
   FunctionImporter::ImportMapTy ImportList;
-  ComputeCrossModuleImportForModule(M.getModuleIdentifier(), *Index,
-                                    ImportList);
+  computeImportForModuleInIndex(M.getModuleIdentifier(), *Index,
+                                MaxProfileCount, ImportList);
 
   // Next we need to promote to global scope and rename any local values that
   // are potentially exported to other modules.
@@ -157,6 +157,39 @@ public:
   }
 };
 
+/// \brief Per-function counters of what the combiner did, reported with
+/// -instcombine-report-stats.
+///
+/// Every instruction taken off the worklist is a visit. Besides the visits
+/// and combines per opcode, the successful folds are counted per rule for the
+/// simplifications tried before the opcode specific visitors and for the
+/// folds the visitors share, so a rule that keeps undoing another one shows
+/// up with many more hits than the instructions it started with.
+struct InstCombineStats {
+  enum Rule {
+    DCE,
+    ConstantFold,
+    KnownBits,
+    Sink,
+    Reassociate,
+    Factorize,
+    Expand,
+    FoldIntoSelect,
+    FoldIntoPhi,
+    DemandedBits,
+    VectorOp,
+    NumRules
+  };
+
+  unsigned Iterations = 0;
+  unsigned Rules[NumRules] = {};
+  unsigned Visits[Instruction::OtherOpsEnd] = {};
+  unsigned Combines[Instruction::OtherOpsEnd] = {};
+
+  static const char *getRuleName(Rule R);
+  void print(raw_ostream &OS, StringRef FnName) const;
+};
+
 /// \brief The core instruction combiner logic.
 ///
 /// This class provides both the logic to recursively visit instructions and
@@ -195,6 +228,9 @@ private:
 
   bool MadeIRChange;
 
+  /// Counters to update, if the caller asked for them.
+  InstCombineStats *Stats;
+
 public:
   InstCombiner(InstCombineWorklist &Worklist, BuilderTy *Builder,
                bool MinimizeSize, bool ExpensiveCombines, AliasAnalysis *AA,
@@ -202,7 +238,17 @@ public:
                DominatorTree *DT, const DataLayout &DL, LoopInfo *LI)
       : Worklist(Worklist), Builder(Builder), MinimizeSize(MinimizeSize),
         ExpensiveCombines(ExpensiveCombines), AA(AA), AC(AC), TLI(TLI), DT(DT),
-        DL(DL), LI(LI), MadeIRChange(false) {}
+        DL(DL), LI(LI), MadeIRChange(false), Stats(nullptr) {}
+
+  void setStats(InstCombineStats *S) { Stats = S; }
+
+  /// Count a fold of rule \p R if \p Result says that it fired, and return
+  /// \p Result.
+  template <typename T> T countFold(InstCombineStats::Rule R, T Result) {
+    if (Stats && Result)
+      ++Stats->Rules[R];
+    return Result;
+  }
 
   /// \brief Run the combiner over the entire worklist until it is empty.
   ///
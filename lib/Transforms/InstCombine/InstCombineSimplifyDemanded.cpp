@@ -58,9 +58,9 @@ bool InstCombiner::SimplifyDemandedInstructionBits(Instruction &Inst) {
   Value *V = SimplifyDemandedUseBits(&Inst, DemandedMask, KnownZero, KnownOne,
                                      0, &Inst);
   if (!V) return false;
-  if (V == &Inst) return true;
-  replaceInstUsesWith(Inst, V);
-  return true;
+  if (V != &Inst)
+    replaceInstUsesWith(Inst, V);
+  return countFold(InstCombineStats::DemandedBits, true);
 }
 
 /// This form of SimplifyDemandedBits simplifies the specified instruction
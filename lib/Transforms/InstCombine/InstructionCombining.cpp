@@ -77,11 +77,27 @@ STATISTIC(NumSunkInst , "Number of instructions sunk");
 STATISTIC(NumExpand,    "Number of expansions");
 STATISTIC(NumFactor   , "Number of factorizations");
 STATISTIC(NumReassoc  , "Number of reassociations");
+STATISTIC(NumWorklistIterations,
+          "Number of instruction combining iterations performed");
+STATISTIC(NumLateChanges,
+          "Number of iterations after the first that changed the function");
+STATISTIC(NumIterationLimit,
+          "Number of functions that hit the iteration limit");
 
 static cl::opt<bool>
 EnableExpensiveCombines("expensive-combines",
                         cl::desc("Enable expensive instruction combines"));
 
+static cl::opt<unsigned>
+MaxIterations("instcombine-max-iterations", cl::Hidden, cl::init(1000),
+              cl::desc("Maximum number of times InstCombine re-runs over a "
+                       "function before giving up on a fixed point"));
+
+static cl::opt<bool>
+ReportStats("instcombine-report-stats", cl::Hidden,
+            cl::desc("Print the number of iterations and visits per opcode "
+                     "InstCombine needed for each function"));
+
 Value *InstCombiner::EmitGEPOffset(User *GEP) {
   return llvm::EmitGEPOffset(Builder, DL, GEP);
 }
@@ -372,7 +388,7 @@ bool InstCombiner::SimplifyAssociativeOrCommutative(BinaryOperator &I) {
     }
 
     // No further simplifications.
-    return Changed;
+    return countFold(InstCombineStats::Reassociate, Changed);
   } while (1);
 }
 
@@ -611,20 +627,20 @@ Value *InstCombiner::SimplifyUsingDistributiveLaws(BinaryOperator &I) {
   // a common term.
   if (LHSOpcode == RHSOpcode) {
     if (Value *V = tryFactorization(Builder, DL, I, LHSOpcode, A, B, C, D))
-      return V;
+      return countFold(InstCombineStats::Factorize, V);
   }
 
   // The instruction has the form "(A op' B) op (C)".  Try to factorize common
   // term.
   if (Value *V = tryFactorization(Builder, DL, I, LHSOpcode, A, B, RHS,
                                   getIdentityValue(LHSOpcode, RHS)))
-    return V;
+    return countFold(InstCombineStats::Factorize, V);
 
   // The instruction has the form "(B) op (C op' D)".  Try to factorize common
   // term.
   if (Value *V = tryFactorization(Builder, DL, I, RHSOpcode, LHS,
                                   getIdentityValue(RHSOpcode, LHS), C, D))
-    return V;
+    return countFold(InstCombineStats::Factorize, V);
 
   // Expansion.
   if (Op0 && RightDistributesOverLeft(Op0->getOpcode(), TopLevelOpcode)) {
@@ -641,14 +657,14 @@ Value *InstCombiner::SimplifyUsingDistributiveLaws(BinaryOperator &I) {
         // If "L op' R" equals "A op' B" then "L op' R" is just the LHS.
         if ((L == A && R == B) ||
             (Instruction::isCommutative(InnerOpcode) && L == B && R == A))
-          return Op0;
+          return countFold(InstCombineStats::Expand, Op0);
         // Otherwise return "L op' R" if it simplifies.
         if (Value *V = SimplifyBinOp(InnerOpcode, L, R, DL))
-          return V;
+          return countFold(InstCombineStats::Expand, V);
         // Otherwise, create a new instruction.
         C = Builder->CreateBinOp(InnerOpcode, L, R);
         C->takeName(&I);
-        return C;
+        return countFold(InstCombineStats::Expand, C);
       }
   }
 
@@ -666,14 +682,14 @@ Value *InstCombiner::SimplifyUsingDistributiveLaws(BinaryOperator &I) {
         // If "L op' R" equals "B op' C" then "L op' R" is just the RHS.
         if ((L == B && R == C) ||
             (Instruction::isCommutative(InnerOpcode) && L == C && R == B))
-          return Op1;
+          return countFold(InstCombineStats::Expand, Op1);
         // Otherwise return "L op' R" if it simplifies.
         if (Value *V = SimplifyBinOp(InnerOpcode, L, R, DL))
-          return V;
+          return countFold(InstCombineStats::Expand, V);
         // Otherwise, create a new instruction.
         A = Builder->CreateBinOp(InnerOpcode, L, R);
         A->takeName(&I);
-        return A;
+        return countFold(InstCombineStats::Expand, A);
       }
   }
 
@@ -698,7 +714,7 @@ Value *InstCombiner::SimplifyUsingDistributiveLaws(BinaryOperator &I) {
                                    SI1->getFalseValue()));
         if (SI) {
           SI->takeName(&I);
-          return SI;
+          return countFold(InstCombineStats::Expand, SI);
         }
       }
     }
@@ -824,8 +840,9 @@ Instruction *InstCombiner::FoldOpIntoSelect(Instruction &Op, SelectInst *SI) {
     Value *SelectTrueVal = FoldOperationIntoSelectOperand(Op, TV, this);
     Value *SelectFalseVal = FoldOperationIntoSelectOperand(Op, FV, this);
 
-    return SelectInst::Create(SI->getCondition(),
-                              SelectTrueVal, SelectFalseVal);
+    return countFold(InstCombineStats::FoldIntoSelect,
+                     SelectInst::Create(SI->getCondition(), SelectTrueVal,
+                                        SelectFalseVal));
   }
   return nullptr;
 }
@@ -967,7 +984,8 @@ Instruction *InstCombiner::FoldOpIntoPhi(Instruction &I) {
     replaceInstUsesWith(*User, NewPN);
     eraseInstFromFunction(*User);
   }
-  return replaceInstUsesWith(I, NewPN);
+  return countFold(InstCombineStats::FoldIntoPhi,
+                   replaceInstUsesWith(I, NewPN));
 }
 
 /// Given a pointer type and a constant offset, determine whether or not there
@@ -1328,8 +1346,10 @@ Value *InstCombiner::SimplifyVectorOp(BinaryOperator &Inst) {
         LShuf->getMask() == RShuf->getMask()) {
       Value *NewBO = CreateBinOpAsGiven(Inst, LShuf->getOperand(0),
           RShuf->getOperand(0), Builder);
-      return Builder->CreateShuffleVector(NewBO,
-          UndefValue::get(NewBO->getType()), LShuf->getMask());
+      return countFold(InstCombineStats::VectorOp,
+                       Builder->CreateShuffleVector(
+                           NewBO, UndefValue::get(NewBO->getType()),
+                           LShuf->getMask()));
     }
   }
 
@@ -1368,8 +1388,10 @@ Value *InstCombiner::SimplifyVectorOp(BinaryOperator &Inst) {
       Value *NewLHS = isa<Constant>(LHS) ? C2 : Shuffle->getOperand(0);
       Value *NewRHS = isa<Constant>(LHS) ? Shuffle->getOperand(0) : C2;
       Value *NewBO = CreateBinOpAsGiven(Inst, NewLHS, NewRHS, Builder);
-      return Builder->CreateShuffleVector(NewBO,
-          UndefValue::get(Inst.getType()), Shuffle->getMask());
+      return countFold(InstCombineStats::VectorOp,
+                       Builder->CreateShuffleVector(
+                           NewBO, UndefValue::get(Inst.getType()),
+                           Shuffle->getMask()));
     }
   }
 
@@ -2812,11 +2834,16 @@ bool InstCombiner::run() {
     Instruction *I = Worklist.RemoveOne();
     if (I == nullptr) continue;  // skip null values.
 
+    if (Stats)
+      ++Stats->Visits[I->getOpcode()];
+
     // Check to see if we can DCE the instruction.
     if (isInstructionTriviallyDead(I, TLI)) {
       DEBUG(dbgs() << "IC: DCE: " << *I << '\n');
       eraseInstFromFunction(*I);
       ++NumDeadInst;
+      if (Stats)
+        ++Stats->Rules[InstCombineStats::DCE];
       MadeIRChange = true;
       continue;
     }
@@ -2830,6 +2857,8 @@ bool InstCombiner::run() {
         // Add operands to the worklist.
         replaceInstUsesWith(*I, C);
         ++NumConstProp;
+        if (Stats)
+          ++Stats->Rules[InstCombineStats::ConstantFold];
         if (isInstructionTriviallyDead(I, TLI))
           eraseInstFromFunction(*I);
         MadeIRChange = true;
@@ -2852,6 +2881,8 @@ bool InstCombiner::run() {
         // Add operands to the worklist.
         replaceInstUsesWith(*I, C);
         ++NumConstProp;
+        if (Stats)
+          ++Stats->Rules[InstCombineStats::KnownBits];
         if (isInstructionTriviallyDead(I, TLI))
           eraseInstFromFunction(*I);
         MadeIRChange = true;
@@ -2887,6 +2918,8 @@ bool InstCombiner::run() {
           // Okay, the CFG is simple enough, try to sink this instruction.
           if (TryToSinkInstruction(I, UserParent)) {
             DEBUG(dbgs() << "IC: Sink: " << *I << '\n');
+            if (Stats)
+              ++Stats->Rules[InstCombineStats::Sink];
             MadeIRChange = true;
             // We'll add uses of the sunk instruction below, but since sinking
             // can expose opportunities for it's *operands* add them to the
@@ -2909,8 +2942,11 @@ bool InstCombiner::run() {
     DEBUG(raw_string_ostream SS(OrigI); I->print(SS); OrigI = SS.str(););
     DEBUG(dbgs() << "IC: Visiting: " << OrigI << '\n');
 
+    unsigned Opcode = I->getOpcode();
     if (Instruction *Result = visit(*I)) {
       ++NumCombined;
+      if (Stats)
+        ++Stats->Combines[Opcode];
       // Should we replace the old instruction with a new one?
       if (Result != I) {
         DEBUG(dbgs() << "IC: Old = " << *I << '\n'
@@ -3127,10 +3163,16 @@ combineInstructionsOverFunction(Function &F, InstCombineWorklist &Worklist,
   // by instcombiner.
   bool DbgDeclaresChanged = LowerDbgDeclare(F);
 
-  // Iterate while there is work to do.
-  int Iteration = 0;
+  InstCombineStats Stats;
+
+  // Iterate while there is work to do. Each iteration after the first only
+  // confirms the fixed point in the common case; a function that keeps
+  // changing is given up on after MaxIterations.
+  bool MadeIRChange = false;
+  unsigned Iteration = 0;
   for (;;) {
     ++Iteration;
+    ++NumWorklistIterations;
     DEBUG(dbgs() << "\n\nINSTCOMBINE ITERATION #" << Iteration << " on "
                  << F.getName() << "\n");
 
@@ -3138,13 +3180,61 @@ combineInstructionsOverFunction(Function &F, InstCombineWorklist &Worklist,
 
     InstCombiner IC(Worklist, &Builder, F.optForMinSize(), ExpensiveCombines,
                     AA, &AC, &TLI, &DT, DL, LI);
+    if (ReportStats)
+      IC.setStats(&Stats);
     Changed |= IC.run();
 
     if (!Changed)
       break;
+    MadeIRChange = true;
+    if (Iteration > 1)
+      ++NumLateChanges;
+
+    if (Iteration >= MaxIterations) {
+      DEBUG(dbgs() << "InstCombine did not reach a fixed point on "
+                   << F.getName() << " after " << Iteration
+                   << " iterations\n");
+      ++NumIterationLimit;
+      break;
+    }
   }
 
-  return DbgDeclaresChanged || Iteration > 1;
+  if (ReportStats) {
+    Stats.Iterations = Iteration;
+    Stats.print(dbgs(), F.getName());
+  }
+
+  return DbgDeclaresChanged || MadeIRChange;
+}
+
+const char *InstCombineStats::getRuleName(Rule R) {
+  switch (R) {
+  case DCE:            return "dce";
+  case ConstantFold:   return "constant fold";
+  case KnownBits:      return "known bits";
+  case Sink:           return "sink";
+  case Reassociate:    return "reassociate";
+  case Factorize:      return "factorize";
+  case Expand:         return "expand";
+  case FoldIntoSelect: return "fold into select";
+  case FoldIntoPhi:    return "fold into phi";
+  case DemandedBits:   return "demanded bits";
+  case VectorOp:       return "vector op";
+  case NumRules:       break;
+  }
+  llvm_unreachable("Unknown InstCombine rule");
+}
+
+void InstCombineStats::print(raw_ostream &OS, StringRef FnName) const {
+  OS << "InstCombine stats for '" << FnName << "': " << Iterations
+     << (Iterations == 1 ? " iteration\n" : " iterations\n");
+  for (unsigned R = 0; R != NumRules; ++R)
+    if (Rules[R])
+      OS << "  rule " << getRuleName(Rule(R)) << ": " << Rules[R] << "\n";
+  for (unsigned Opcode = 0; Opcode != Instruction::OtherOpsEnd; ++Opcode)
+    if (Visits[Opcode])
+      OS << "  " << Instruction::getOpcodeName(Opcode) << ": " << Visits[Opcode]
+         << " visits, " << Combines[Opcode] << " combined\n";
 }
 
 PreservedAnalyses InstCombinePass::run(Function &F,
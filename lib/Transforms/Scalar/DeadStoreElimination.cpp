@@ -49,12 +49,20 @@ STATISTIC(NumRedundantStores, "Number of redundant stores deleted");
 STATISTIC(NumFastStores, "Number of stores deleted");
 STATISTIC(NumFastOther , "Number of other instrs removed");
 STATISTIC(NumCompletePartials, "Number of stores dead by later partials");
+STATISTIC(NumBudgetSkippedBlocks,
+          "Number of blocks skipped due to the MemDep budget");
 
 static cl::opt<bool>
 EnablePartialOverwriteTracking("enable-dse-partial-overwrite-tracking",
   cl::init(true), cl::Hidden,
   cl::desc("Enable partial-overwrite tracking in DSE"));
 
+static cl::opt<unsigned> MemDepScanBudget(
+    "dse-memdep-scan-budget", cl::init(1000000), cl::Hidden,
+    cl::desc("The number of instructions memory dependence analysis may scan "
+             "for one function before DSE skips its remaining blocks "
+             "(0 = unlimited)"));
+
 
 //===----------------------------------------------------------------------===//
 // Helper functions
@@ -1118,11 +1126,27 @@ static bool eliminateDeadStores(Function &F, AliasAnalysis *AA,
                                 MemoryDependenceResults *MD, DominatorTree *DT,
                                 const TargetLibraryInfo *TLI) {
   bool MadeChange = false;
-  for (BasicBlock &BB : F)
+  uint64_t ScanLimit =
+      MemDepScanBudget ? MD->getNumInstsScanned() + MemDepScanBudget : 0;
+  MD->setScanLimit(ScanLimit);
+  for (BasicBlock &BB : F) {
     // Only check non-dead blocks.  Dead blocks may have strange pointer
     // cycles that will confuse alias analysis.
-    if (DT->isReachableFromEntry(&BB))
-      MadeChange |= eliminateDeadStores(BB, AA, MD, DT, TLI);
+    if (!DT->isReachableFromEntry(&BB))
+      continue;
+    // Past the budget, leave the remaining blocks alone rather than let
+    // dependency queries dominate compile time.
+    if (MD->reachedScanLimit()) {
+      ++NumBudgetSkippedBlocks;
+      continue;
+    }
+    MadeChange |= eliminateDeadStores(BB, AA, MD, DT, TLI);
+  }
+  // MemDep is preserved, don't leave it results that are unknown only because
+  // of the budget.
+  if (MD->reachedScanLimit())
+    MD->releaseMemory();
+  MD->setScanLimit(0);
   return MadeChange;
 }
 
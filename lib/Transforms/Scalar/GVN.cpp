@@ -64,6 +64,7 @@ STATISTIC(NumGVNBlocks, "Number of blocks merged");
 STATISTIC(NumGVNSimpl,  "Number of instructions simplified");
 STATISTIC(NumGVNEqProp, "Number of equalities propagated");
 STATISTIC(NumPRELoad,   "Number of loads PRE'd");
+STATISTIC(NumGVNLoadBudget, "Number of loads skipped due to the MemDep budget");
 
 static cl::opt<bool> EnablePRE("enable-pre",
                                cl::init(true), cl::Hidden);
@@ -74,6 +75,12 @@ static cl::opt<uint32_t>
 MaxRecurseDepth("max-recurse-depth", cl::Hidden, cl::init(1000), cl::ZeroOrMore,
                 cl::desc("Max recurse depth (default = 1000)"));
 
+static cl::opt<unsigned> MemDepScanBudget(
+    "gvn-memdep-scan-budget", cl::Hidden, cl::init(1000000),
+    cl::desc("The number of instructions memory dependence analysis may scan "
+             "for the loads of one function before GVN stops analyzing "
+             "loads (0 = unlimited)"));
+
 struct llvm::GVN::Expression {
   uint32_t opcode;
   Type *type;
@@ -1781,6 +1788,11 @@ static void patchAndReplaceAllUsesWith(Instruction *I, Value *Repl) {
   I->replaceAllUsesWith(Repl);
 }
 
+/// Return true if MemDep has used up this function's scan budget.
+bool GVN::isMemDepBudgetExhausted() const {
+  return MD && MD->reachedScanLimit();
+}
+
 /// Attempt to eliminate a load, first by eliminating it
 /// locally, and then attempting non-local elimination if that fails.
 bool GVN::processLoad(LoadInst *L) {
@@ -1796,6 +1808,13 @@ bool GVN::processLoad(LoadInst *L) {
     return true;
   }
 
+  // Past the budget, leave the remaining loads alone rather than let
+  // dependency queries dominate compile time.
+  if (isMemDepBudgetExhausted()) {
+    ++NumGVNLoadBudget;
+    return false;
+  }
+
   // ... to a pointer that has been loaded from before...
   MemDepResult Dep = MD->getDependency(L);
 
@@ -2208,6 +2227,8 @@ bool GVN::runImpl(Function &F, AssumptionCache &RunAC, DominatorTree &RunDT,
   VN.setAliasAnalysis(&RunAA);
   MD = RunMD;
   VN.setMemDep(MD);
+  if (MD && MemDepScanBudget)
+    MD->setScanLimit(MD->getNumInstsScanned() + MemDepScanBudget);
 
   bool Changed = false;
   bool ShouldContinue = true;
@@ -2252,6 +2273,8 @@ bool GVN::runImpl(Function &F, AssumptionCache &RunAC, DominatorTree &RunDT,
   // Do not cleanup DeadBlocks in cleanupGlobalSets() as it's called for each
   // iteration.
   DeadBlocks.clear();
+  if (MD)
+    MD->setScanLimit(0);
 
   return Changed;
 }
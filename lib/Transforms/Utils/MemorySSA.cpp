@@ -47,6 +47,12 @@ using namespace llvm;
 STATISTIC(NumClobberCacheLookups, "Number of Memory SSA version cache lookups");
 STATISTIC(NumClobberCacheHits, "Number of Memory SSA version cache hits");
 STATISTIC(NumClobberCacheInserts, "Number of MemorySSA version cache inserts");
+STATISTIC(NumClobberCacheInvalidations,
+          "Number of MemorySSA version cache entries invalidated");
+STATISTIC(NumBatchOptimizedUses,
+          "Number of MemoryUses optimized without a walker query");
+STATISTIC(NumBatchSkippedUses,
+          "Number of MemoryUses not optimized due to the check limit");
 
 INITIALIZE_PASS_BEGIN(MemorySSAWrapperPass, "memoryssa", "Memory SSA", false,
                       true)
@@ -65,6 +71,12 @@ static cl::opt<bool>
     VerifyMemorySSA("verify-memoryssa", cl::init(false), cl::Hidden,
                     cl::desc("Verify MemorySSA in legacy printer pass."));
 
+static cl::opt<unsigned> MaxCheckLimit(
+    "memssa-check-limit", cl::Hidden, cl::init(100),
+    cl::desc("The maximum number of stores/phis MemorySSA "
+             "will consider trying to walk past when optimizing uses "
+             "(default = 100)"));
+
 namespace llvm {
 /// \brief An assembly annotator class to print Memory SSA information in
 /// comments.
@@ -160,6 +172,27 @@ public:
     return IsCall ? Calls.erase(MA) : Accesses.erase({MA, Loc});
   }
 
+  /// Remove every entry that starts at, or resolves to, \p MA. Entries whose
+  /// walk merely went past \p MA stay valid: removing a def that did not
+  /// clobber a location, or a phi whose incoming values are all the same,
+  /// does not change the clobber of anything above it.
+  void removeReferencesTo(const MemoryAccess *MA) {
+    for (auto I = Accesses.begin(), E = Accesses.end(); I != E;) {
+      auto Cur = I++;
+      if (Cur->first.first == MA || Cur->second == MA) {
+        Accesses.erase(Cur);
+        ++NumClobberCacheInvalidations;
+      }
+    }
+    for (auto I = Calls.begin(), E = Calls.end(); I != E;) {
+      auto Cur = I++;
+      if (Cur->first == MA || Cur->second == MA) {
+        Calls.erase(Cur);
+        ++NumClobberCacheInvalidations;
+      }
+    }
+  }
+
   void clear() {
     Accesses.clear();
     Calls.clear();
@@ -914,6 +947,189 @@ public:
   void resetClobberWalker() { Walker.reset(); }
 };
 
+/// Optimizes the MemoryUses of loads in one top-down walk of the dominator tree,
+/// instead of a walker query per use.
+///
+/// The walk keeps a stack of the defs and phis that dominate the current
+/// block, in order. For each location we remember how far down the stack the
+/// last query for it looked (LowerBound) and what it found (LastKill), so a
+/// later load of the same location only has to check the defs pushed since.
+/// Phis are the one thing the stack can't see through; when we reach one, we
+/// fall back to the walker.
+class MemorySSA::OptimizeUses {
+public:
+  OptimizeUses(MemorySSA *MSSA, CachingWalker *Walker, AliasAnalysis *AA,
+               DominatorTree *DT)
+      : MSSA(MSSA), Walker(Walker), AA(AA), DT(DT) {}
+
+  void optimizeUses();
+
+private:
+  /// Where the last walk for a given MemoryLocation stopped.
+  struct MemlocStackInfo {
+    // The stack and pop epochs the info was computed at. Whenever the stack
+    // changes due to pushes or pops, the corresponding epoch increases.
+    unsigned long StackEpoch;
+    unsigned long PopEpoch;
+    // The lowest stack slot that still needs checking. Note: correctness
+    // depends on this being initialized to 0, which DenseMap does.
+    unsigned long LowerBound;
+    const BasicBlock *LowerBoundBlock;
+    // The stack slot the last walk for this location ended at.
+    unsigned long LastKill;
+    bool LastKillValid;
+  };
+
+  void optimizeUsesInBlock(const BasicBlock *, unsigned long &StackEpoch,
+                           unsigned long &PopEpoch,
+                           SmallVectorImpl<MemoryAccess *> &VersionStack,
+                           DenseMap<MemoryLocation, MemlocStackInfo> &);
+
+  MemorySSA *MSSA;
+  CachingWalker *Walker;
+  AliasAnalysis *AA;
+  DominatorTree *DT;
+};
+
+void MemorySSA::OptimizeUses::optimizeUsesInBlock(
+    const BasicBlock *BB, unsigned long &StackEpoch, unsigned long &PopEpoch,
+    SmallVectorImpl<MemoryAccess *> &VersionStack,
+    DenseMap<MemoryLocation, MemlocStackInfo> &LocStackInfo) {
+  auto It = MSSA->PerBlockAccesses.find(BB);
+  if (It == MSSA->PerBlockAccesses.end())
+    return;
+  AccessList *Accesses = It->second.get();
+
+  // Pop everything that doesn't dominate the current block off the stack,
+  // and bump the PopEpoch to account for this.
+  while (true) {
+    assert(!VersionStack.empty() &&
+           "Version stack should have liveOnEntry dominating everything");
+    BasicBlock *BackBlock = VersionStack.back()->getBlock();
+    if (DT->dominates(BackBlock, BB))
+      break;
+    while (VersionStack.back()->getBlock() == BackBlock)
+      VersionStack.pop_back();
+    ++PopEpoch;
+  }
+
+  for (MemoryAccess &MA : *Accesses) {
+    auto *MU = dyn_cast<MemoryUse>(&MA);
+    if (!MU) {
+      VersionStack.push_back(&MA);
+      ++StackEpoch;
+      continue;
+    }
+
+    // Only plain locations can share stack info. Calls and the like go
+    // through the walker as before.
+    Instruction *Inst = MU->getMemoryInst();
+    if (!isa<LoadInst>(Inst)) {
+      MU->setDefiningAccess(Walker->getClobberingMemoryAccess(MU));
+      continue;
+    }
+
+    UpwardsMemoryQuery Q(Inst, MU);
+    auto &LocInfo = LocStackInfo[Q.StartingLoc];
+    // If the pop epoch changed, the top of the stack was removed since the
+    // info was computed, and the lower bound and last kill may no longer be
+    // on it.
+    if (LocInfo.PopEpoch != PopEpoch) {
+      LocInfo.PopEpoch = PopEpoch;
+      LocInfo.StackEpoch = StackEpoch;
+      // If the lower bound was in something that no longer dominates us, we
+      // have to reset it. We can't simply track the stack size, because the
+      // stack may have had pushes and pops in the meantime.
+      if (LocInfo.LowerBoundBlock && LocInfo.LowerBoundBlock != BB &&
+          !DT->dominates(LocInfo.LowerBoundBlock, BB)) {
+        LocInfo.LowerBound = 0;
+        LocInfo.LowerBoundBlock = VersionStack[0]->getBlock();
+        LocInfo.LastKillValid = false;
+      }
+    } else if (LocInfo.StackEpoch != StackEpoch) {
+      // Only pushes happened, so only the new entries need checking; the
+      // lower bound stays where it was.
+      LocInfo.StackEpoch = StackEpoch;
+    }
+    if (!LocInfo.LastKillValid) {
+      LocInfo.LastKill = VersionStack.size() - 1;
+      LocInfo.LastKillValid = true;
+    }
+
+    assert(LocInfo.LowerBound < VersionStack.size() &&
+           "Lower bound out of range");
+    assert(LocInfo.LastKill < VersionStack.size() &&
+           "Last kill info out of range");
+    // In any case, the new upper bound is the top of the stack.
+    unsigned long UpperBound = VersionStack.size() - 1;
+
+    if (UpperBound - LocInfo.LowerBound > MaxCheckLimit) {
+      DEBUG(dbgs() << "MemorySSA skipping optimization of " << *MU << " ("
+                   << *Inst << ") because there are "
+                   << UpperBound - LocInfo.LowerBound
+                   << " stores to disambiguate\n");
+      // Because we did not walk, LastKill is no longer valid, as this may
+      // have been a kill.
+      LocInfo.LastKillValid = false;
+      ++NumBatchSkippedUses;
+      continue;
+    }
+
+    bool FoundClobberResult = false;
+    bool UsedWalker = false;
+    while (UpperBound > LocInfo.LowerBound) {
+      if (isa<MemoryPhi>(VersionStack[UpperBound])) {
+        // For phis, use the walker, and move to wherever it ended up. The
+        // result dominates the use, so it is on the stack.
+        MemoryAccess *Result = Walker->getClobberingMemoryAccess(MU);
+        while (VersionStack[UpperBound] != Result) {
+          assert(UpperBound != 0 && "Walker result not on the stack");
+          --UpperBound;
+        }
+        FoundClobberResult = true;
+        UsedWalker = true;
+        break;
+      }
+
+      MemoryDef *MD = cast<MemoryDef>(VersionStack[UpperBound]);
+      if (instructionClobbersQuery(MD, Q.StartingLoc, Q, *AA)) {
+        FoundClobberResult = true;
+        break;
+      }
+      --UpperBound;
+    }
+
+    // At the end of this loop, UpperBound is either a clobber, or the lower
+    // bound. Phi walking may take it below the lower bound, and in fact below
+    // LastKill.
+    if (FoundClobberResult || UpperBound < LocInfo.LastKill) {
+      MU->setDefiningAccess(VersionStack[UpperBound]);
+      // We were last killed now by where we got to.
+      LocInfo.LastKill = UpperBound;
+    } else {
+      // Otherwise, we checked all the new ones, and now we know we can get to
+      // LastKill.
+      MU->setDefiningAccess(VersionStack[LocInfo.LastKill]);
+    }
+    LocInfo.LowerBound = VersionStack.size() - 1;
+    LocInfo.LowerBoundBlock = BB;
+    if (!UsedWalker)
+      ++NumBatchOptimizedUses;
+  }
+}
+
+void MemorySSA::OptimizeUses::optimizeUses() {
+  SmallVector<MemoryAccess *, 16> VersionStack;
+  DenseMap<MemoryLocation, MemlocStackInfo> LocStackInfo;
+  VersionStack.push_back(MSSA->getLiveOnEntryDef());
+
+  unsigned long StackEpoch = 1;
+  unsigned long PopEpoch = 1;
+  for (const auto *DomNode : depth_first(DT->getRootNode()))
+    optimizeUsesInBlock(DomNode->getBlock(), StackEpoch, PopEpoch,
+                        VersionStack, LocStackInfo);
+}
+
 /// \brief Rename a single basic block into MemorySSA form.
 /// Uses the standard SSA renaming algorithm.
 /// \returns The new incoming value.
@@ -1166,19 +1382,7 @@ void MemorySSA::buildMemorySSA() {
   // dominating clobbering def.
   // This ensures that MemoryUse's that are killed by the same store are
   // immediate users of that store, one of the invariants we guarantee.
-  for (auto DomNode : depth_first(DT)) {
-    BasicBlock *BB = DomNode->getBlock();
-    auto AI = PerBlockAccesses.find(BB);
-    if (AI == PerBlockAccesses.end())
-      continue;
-    AccessList *Accesses = AI->second.get();
-    for (auto &MA : *Accesses) {
-      if (auto *MU = dyn_cast<MemoryUse>(&MA)) {
-        Instruction *Inst = MU->getMemoryInst();
-        MU->setDefiningAccess(Walker->getClobberingMemoryAccess(Inst));
-      }
-    }
-  }
+  OptimizeUses(this, Walker, AA, DT).optimizeUses();
 
   Walker->setAutoResetWalker(true);
   Walker->resetClobberWalker();
@@ -1768,13 +1972,6 @@ MemorySSA::CachingWalker::CachingWalker(MemorySSA *M, AliasAnalysis *A,
 MemorySSA::CachingWalker::~CachingWalker() {}
 
 void MemorySSA::CachingWalker::invalidateInfo(MemoryAccess *MA) {
-  // TODO: We can do much better cache invalidation with differently stored
-  // caches.  For now, for MemoryUses, we simply remove them
-  // from the cache, and kill the entire call/non-call cache for everything
-  // else.  The problem is for phis or defs, currently we'd need to follow use
-  // chains down and invalidate anything below us in the chain that currently
-  // terminates at this access.
-
   // See if this is a MemoryUse, if so, just remove the cached info. MemoryUse
   // is by definition never a barrier, so nothing in the cache could point to
   // this use. In that case, we only need invalidate the info for the use
@@ -1784,8 +1981,9 @@ void MemorySSA::CachingWalker::invalidateInfo(MemoryAccess *MA) {
     UpwardsMemoryQuery Q(MU->getMemoryInst(), MU);
     Cache.remove(MU, Q.StartingLoc, Q.IsCall);
   } else {
-    // If it is not a use, the best we can do right now is destroy the cache.
-    Cache.clear();
+    // For phis and defs, drop the entries that start or end at MA, and keep
+    // the ones for unrelated accesses.
+    Cache.removeReferencesTo(MA);
   }
 
 #ifdef EXPENSIVE_CHECKS
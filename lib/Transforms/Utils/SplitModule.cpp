@@ -30,7 +30,9 @@
 #include "llvm/Support/MD5.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Cloning.h"
+#include <array>
 #include <queue>
+#include <vector>
 
 using namespace llvm;
 
@@ -203,26 +205,46 @@ static void externalize(GlobalValue *GV) {
     GV->setName("__llvmsplit_unnamed");
 }
 
-// Returns whether GV should be in partition (0-based) I of N.
-static bool isInPartition(const GlobalValue *GV, unsigned I, unsigned N) {
-  if (auto *GIS = dyn_cast<GlobalIndirectSymbol>(GV))
-    if (const GlobalObject *Base = GIS->getBaseObject())
-      GV = Base;
+// Assigns each global value that findPartitions left unassigned to a
+// partition by the MD5 hash of its name, or of its comdat's name. All the
+// names are hashed in one batch, once, rather than once per partition.
+static void assignHashPartitions(Module *M, ClusterIDMapType &ClusterIDMap,
+                                 unsigned N) {
+  std::vector<const GlobalValue *> GVs;
+  std::vector<ArrayRef<uint8_t>> Names;
+  auto AddGV = [&](const GlobalValue &GV) {
+    if (ClusterIDMap.count(&GV))
+      return;
+    const GlobalValue *Base = &GV;
+    if (auto *GIS = dyn_cast<GlobalIndirectSymbol>(Base))
+      if (const GlobalObject *BaseObject = GIS->getBaseObject())
+        Base = BaseObject;
 
-  StringRef Name;
-  if (const Comdat *C = GV->getComdat())
-    Name = C->getName();
-  else
-    Name = GV->getName();
+    StringRef Name;
+    if (const Comdat *C = Base->getComdat())
+      Name = C->getName();
+    else
+      Name = Base->getName();
+    GVs.push_back(&GV);
+    Names.push_back(makeArrayRef(
+        reinterpret_cast<const uint8_t *>(Name.data()), Name.size()));
+  };
+  for (const Function &F : *M)
+    AddGV(F);
+  for (const GlobalVariable &GV : M->globals())
+    AddGV(GV);
+  for (const GlobalAlias &GA : M->aliases())
+    AddGV(GA);
+  for (const GlobalIFunc &GIF : M->ifuncs())
+    AddGV(GIF);
 
   // Partition by MD5 hash. We only need a few bits for evenness as the number
   // of partitions will generally be in the 1-2 figure range; the low 16 bits
   // are enough.
-  MD5 H;
-  MD5::MD5Result R;
-  H.update(Name);
-  H.final(R);
-  return (R[0] | (R[1] << 8)) % N == I;
+  std::vector<std::array<uint8_t, 16>> Hashes(Names.size());
+  MD5::hashMany(Names, Hashes);
+  for (size_t I = 0, E = GVs.size(); I != E; ++I)
+    ClusterIDMap[GVs[I]] = (Hashes[I][0] | (Hashes[I][1] << 8)) % N;
 }
 
 void llvm::SplitModule(
@@ -244,6 +266,7 @@ void llvm::SplitModule(
   // always be possible.
   ClusterIDMapType ClusterIDMap;
   findPartitions(M.get(), ClusterIDMap, N);
+  assignHashPartitions(M.get(), ClusterIDMap, N);
 
   // FIXME: We should be able to reuse M as the last partition instead of
   // cloning it.
@@ -251,10 +274,7 @@ void llvm::SplitModule(
     ValueToValueMapTy VMap;
     std::unique_ptr<Module> MPart(
         CloneModule(M.get(), VMap, [&](const GlobalValue *GV) {
-          if (ClusterIDMap.count(GV))
-            return (ClusterIDMap[GV] == I);
-          else
-            return isInPartition(GV, I, N);
+          return ClusterIDMap.lookup(GV) == I;
         }));
     if (I != 0)
       MPart->setModuleInlineAsm("");
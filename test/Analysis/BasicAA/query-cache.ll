@@ -0,0 +1,25 @@
+; RUN: opt < %s -aa-query-cache -aa-pipeline=basic-aa -passes='aa-eval,aa-eval' -print-all-alias-modref-info -disable-output -stats 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; The second evaluation runs after a pass that preserved everything, so all of
+; its alias queries are answered from the cache with the same results.
+
+; CHECK-LABEL: Function: test
+; CHECK: NoAlias: i32* %a, i32* %b
+; CHECK: MustAlias: i32* %a, i32* %p
+; CHECK: NoAlias: i32* %b, i32* %p
+; CHECK-LABEL: Function: test
+; CHECK: NoAlias: i32* %a, i32* %b
+; CHECK: MustAlias: i32* %a, i32* %p
+; CHECK: NoAlias: i32* %b, i32* %p
+; CHECK: 3 aa - Number of alias queries answered from the cache
+
+define void @test() {
+  %a = alloca i32
+  %b = alloca i32
+  %p = getelementptr i32, i32* %a, i32 0
+  store i32 0, i32* %a
+  store i32 0, i32* %b
+  store i32 0, i32* %p
+  ret void
+}
@@ -0,0 +1,34 @@
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-print-cache-stats | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-max-arith-depth=0 | FileCheck %s --check-prefix=DEPTH
+
+; CHECK-LABEL: Determining loop execution counts for: @f
+; CHECK: Loop %loop: backedge-taken count is 99
+; CHECK-LABEL: ScalarEvolution cache sizes for: @f
+; CHECK-NEXT: UniqueSCEVs: {{[0-9]+}}
+; CHECK-NEXT: ValueExprMap: {{[0-9]+}}
+; CHECK-NEXT: ExprValueMap: {{[0-9]+}}
+; CHECK-NEXT: BackedgeTakenCounts: 1
+; CHECK: Allocated bytes: {{[0-9]+}}
+
+; Simplification is limited by the depth budget, but the trip count is still
+; computed.
+; DEPTH: Loop %loop: backedge-taken count is 99
+; DEPTH-NOT: cache sizes
+
+define void @f(i32* %p) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %a = add i32 %i, 7
+  %b = mul i32 %a, 3
+  %gep = getelementptr i32, i32* %p, i32 %b
+  store i32 %i, i32* %gep
+  %i.next = add nsw i32 %i, 1
+  %cond = icmp slt i32 %i.next, 100
+  br i1 %cond, label %loop, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,13 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -combiner-profile -o /dev/null 2>&1 | FileCheck %s
+
+; CHECK: DAG Combiner Profile
+; CHECK: Visits Fired Failed Wall Time Opcode
+; CHECK-DAG: {{[0-9]+ +[0-9]+ +[0-9]+ +[0-9.]+ +}}add
+; CHECK-DAG: {{[0-9]+ +[0-9]+ +[0-9]+ +[0-9.]+ +}}shl
+
+define i32 @f(i32 %a, i32 %b) nounwind {
+entry:
+  %s = add i32 %a, %b
+  %m = mul i32 %s, 8
+  ret i32 %m
+}
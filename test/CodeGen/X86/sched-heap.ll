@@ -0,0 +1,44 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -enable-misched=false -pre-RA-sched=list-heap | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -enable-misched=false -sched-heap-threshold=1 | FileCheck %s
+
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -enable-misched=false -pre-RA-sched=source | FileCheck %s
+
+; The heap based list scheduler keeps independent chains in source order,
+; which is the schedule the source order scheduler picks.
+
+define void @two_chains(i32* %p, i32* %q, i32 %a, i32 %b) nounwind {
+; CHECK-LABEL: two_chains:
+; CHECK: incl %edx
+; CHECK-NEXT: movl %edx, (%rdi)
+; CHECK-NEXT: addl $2, %ecx
+; CHECK-NEXT: movl %ecx, (%rsi)
+; CHECK-NEXT: retq
+entry:
+  %x = add i32 %a, 1
+  store i32 %x, i32* %p
+  %y = add i32 %b, 2
+  store i32 %y, i32* %q
+  ret void
+}
+
+define i32 @sum(i32* %p) nounwind {
+; CHECK-LABEL: sum:
+; CHECK: movl (%rdi), %ecx
+; CHECK-NEXT: movl 8(%rdi), %eax
+; CHECK-NEXT: addl 4(%rdi), %ecx
+; CHECK-NEXT: addl 12(%rdi), %eax
+; CHECK-NEXT: imull %ecx, %eax
+; CHECK-NEXT: retq
+entry:
+  %p1 = getelementptr i32, i32* %p, i64 1
+  %p2 = getelementptr i32, i32* %p, i64 2
+  %p3 = getelementptr i32, i32* %p, i64 3
+  %v0 = load i32, i32* %p
+  %v1 = load i32, i32* %p1
+  %v2 = load i32, i32* %p2
+  %v3 = load i32, i32* %p3
+  %s0 = add i32 %v0, %v1
+  %s1 = add i32 %v2, %v3
+  %s2 = mul i32 %s0, %s1
+  ret i32 %s2
+}
@@ -0,0 +1,22 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -verify-machineinstrs-quick -debug-pass=Structure -o /dev/null 2>&1 | FileCheck %s --check-prefix=PASSES
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -verify-machineinstrs-quick | FileCheck %s
+
+; The quick machine verifier runs after the same passes as the full one.
+; PASSES: Verify generated machine code
+; PASSES: Verify generated machine code
+
+; CHECK-LABEL: f:
+; CHECK: imull
+; CHECK: retq
+define i32 @f(i32 %a, i32 %b, i1 %c) {
+entry:
+  br i1 %c, label %then, label %exit
+
+then:
+  %m = mul i32 %a, %b
+  br label %exit
+
+exit:
+  %r = phi i32 [ %m, %then ], [ %a, %entry ]
+  ret i32 %r
+}
@@ -0,0 +1,23 @@
+target datalayout = "e-m:o-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-apple-macosx10.11.0"
+
+@counter = internal global i32 0, align 4
+
+define void @foo() {
+entry:
+  call void @bar()
+  ret void
+}
+
+define void @bar() {
+entry:
+  %0 = load i32, i32* @counter, align 4
+  %inc = add i32 %0, 1
+  store i32 %inc, i32* @counter, align 4
+  ret void
+}
+
+define void @unused() {
+entry:
+  ret void
+}
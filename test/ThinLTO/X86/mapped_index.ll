@@ -0,0 +1,31 @@
+; RUN: opt -module-summary %s -o %t1.bc
+; RUN: opt -module-summary %p/Inputs/mapped_index.ll -o %t2.bc
+; RUN: llvm-lto -thinlto-action=thinlink -thinlto-mapped-index -o %t.index %t1.bc %t2.bc
+
+; The mapped index is not bitcode, and backends read it in place.
+; RUN: not llvm-dis %t.index -o - 2>&1 | FileCheck %s --check-prefix=NOTBC
+; NOTBC: Invalid bitcode signature
+
+; Import through the ThinLTO code generator, which loads the whole index.
+; RUN: llvm-lto -thinlto-action=import %t1.bc -thinlto-index=%t.index -o - | llvm-dis -o - | FileCheck %s --check-prefix=IMPORT
+; Import through the pass, which only loads what importing into %t1.bc needs.
+; RUN: opt -function-import -summary-file %t.index %t1.bc -S | FileCheck %s --check-prefix=IMPORT
+; IMPORT-DAG: define available_externally void @foo()
+; IMPORT-DAG: define available_externally void @bar()
+; IMPORT-DAG: @counter.llvm.{{.*}} = external hidden global i32
+; IMPORT-NOT: @unused
+
+; Exporting @counter promotes it in the module defining it.
+; RUN: llvm-lto -thinlto-action=promote %t2.bc -thinlto-index=%t.index -o - | llvm-dis -o - | FileCheck %s --check-prefix=PROMOTE
+; PROMOTE: @counter.llvm.{{.*}} = hidden global i32 0
+
+target datalayout = "e-m:o-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-apple-macosx10.11.0"
+
+define void @main() {
+entry:
+  call void @foo()
+  ret void
+}
+
+declare void @foo()
@@ -0,0 +1,29 @@
+; RUN: opt -correlated-propagation -S %s | FileCheck %s
+; RUN: opt -correlated-propagation -lvi-max-processed-per-value=1 -S %s | FileCheck %s --check-prefix=BUDGET
+
+; Proving the compare needs the value of %x in several blocks. With a work
+; budget of one block value per query, LVI gives up and the compare stays.
+
+define i1 @f(i32 %x) {
+; CHECK-LABEL: @f(
+; CHECK: ret i1 true
+; BUDGET-LABEL: @f(
+; BUDGET: %r = icmp ult i32 %x, 20
+; BUDGET: ret i1 %r
+entry:
+  %c = icmp ult i32 %x, 10
+  br i1 %c, label %a, label %exit
+
+a:
+  br label %b
+
+b:
+  br label %d
+
+d:
+  %r = icmp ult i32 %x, 20
+  ret i1 %r
+
+exit:
+  ret i1 false
+}
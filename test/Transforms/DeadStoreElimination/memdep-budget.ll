@@ -0,0 +1,27 @@
+; RUN: opt < %s -basicaa -dse -S | FileCheck %s
+; RUN: opt < %s -basicaa -dse -dse-memdep-scan-budget=1 -S | FileCheck %s --check-prefix=BUDGET
+
+; Once the dependency queries of a function have scanned as many instructions
+; as the budget allows, the remaining blocks are left alone.
+
+define void @f(i32* %p, i32* %q) {
+; CHECK-LABEL: @f(
+; CHECK-NOT: store i32 1,
+; CHECK: store i32 2, i32* %p
+; CHECK-NOT: store i32 3,
+; CHECK: store i32 4, i32* %q
+; BUDGET-LABEL: @f(
+; BUDGET-NOT: store i32 1,
+; BUDGET: store i32 2, i32* %p
+; BUDGET: store i32 3, i32* %q
+; BUDGET: store i32 4, i32* %q
+entry:
+  store i32 1, i32* %p
+  store i32 2, i32* %p
+  br label %next
+
+next:
+  store i32 3, i32* %q
+  store i32 4, i32* %q
+  ret void
+}
@@ -0,0 +1,20 @@
+declare void @sink()
+
+; Both callees have 5 instructions.
+define void @hot_callee() {
+entry:
+  call void @sink()
+  call void @sink()
+  call void @sink()
+  call void @sink()
+  ret void
+}
+
+define void @cold_callee() {
+entry:
+  call void @sink()
+  call void @sink()
+  call void @sink()
+  call void @sink()
+  ret void
+}
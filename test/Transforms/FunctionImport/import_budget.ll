@@ -0,0 +1,41 @@
+; Do setup work for all below tests: generate bitcode and combined index
+; RUN: opt -module-summary %s -o %t.bc
+; RUN: opt -module-summary %p/Inputs/import_budget.ll -o %t2.bc
+; RUN: llvm-lto -thinlto -o %t3 %t.bc %t2.bc
+
+; Without a budget both callees are imported.
+; RUN: opt -function-import -summary-file %t3.thinlto.bc %t.bc -S | FileCheck %s --check-prefix=ALL
+; ALL-DAG: define available_externally void @hot_callee()
+; ALL-DAG: define available_externally void @cold_callee()
+
+; With room for a single callee, the hot one is imported.
+; RUN: opt -function-import -summary-file %t3.thinlto.bc %t.bc -import-instr-budget=5 -S | FileCheck %s --check-prefix=BUDGET
+; BUDGET-DAG: define available_externally void @hot_callee()
+; BUDGET-DAG: declare void @cold_callee()
+
+; Below the size of the callees, only the hot edge gets a large enough
+; threshold.
+; RUN: opt -function-import -summary-file %t3.thinlto.bc %t.bc -import-instr-limit=3 -S | FileCheck %s --check-prefix=HOT
+; HOT-DAG: define available_externally void @hot_callee()
+; HOT-DAG: declare void @cold_callee()
+; RUN: opt -function-import -summary-file %t3.thinlto.bc %t.bc -import-instr-limit=3 -import-hot-multiplier=1 -S | FileCheck %s --check-prefix=NOHOT
+; NOHOT-DAG: declare void @hot_callee()
+; NOHOT-DAG: declare void @cold_callee()
+
+declare void @hot_callee()
+declare void @cold_callee()
+
+define void @hot_caller() !prof !0 {
+entry:
+  call void @hot_callee()
+  ret void
+}
+
+define void @cold_caller() !prof !1 {
+entry:
+  call void @cold_callee()
+  ret void
+}
+
+!0 = !{!"function_entry_count", i64 10000}
+!1 = !{!"function_entry_count", i64 1}
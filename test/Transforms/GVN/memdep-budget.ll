@@ -0,0 +1,44 @@
+; RUN: opt < %s -basicaa -gvn -S | FileCheck %s
+; RUN: opt < %s -basicaa -gvn -gvn-memdep-scan-budget=1 -S | FileCheck %s --check-prefix=BUDGET
+
+; Once the dependency queries of a function have scanned as many instructions
+; as the budget allows, the remaining loads are left alone.
+
+define i32 @f(i32* %p) {
+; CHECK-LABEL: @f(
+; CHECK: load i32
+; CHECK-NOT: load i32
+; CHECK: ret i32
+; BUDGET-LABEL: @f(
+; BUDGET: %a = load i32
+; BUDGET-NOT: %b = load i32
+; BUDGET: %c = load i32
+; BUDGET: ret i32
+  %a = load i32, i32* %p
+  %b = load i32, i32* %p
+  %c = load i32, i32* %p
+  %s = add i32 %a, %b
+  %t = add i32 %s, %c
+  ret i32 %t
+}
+
+; The budget also stops a single query that would scan past it.
+
+define i32 @g(i32* %p, i32 %x) {
+; CHECK-LABEL: @g(
+; CHECK: load i32
+; CHECK-NOT: load i32
+; CHECK: ret i32
+; BUDGET-LABEL: @g(
+; BUDGET: %a = load i32
+; BUDGET: %b = load i32
+; BUDGET: ret i32
+  %a = load i32, i32* %p
+  %x1 = add i32 %x, 1
+  %x2 = mul i32 %x1, 3
+  %x3 = xor i32 %x2, 5
+  %b = load i32, i32* %p
+  %s = add i32 %a, %b
+  %t = add i32 %s, %x3
+  ret i32 %t
+}
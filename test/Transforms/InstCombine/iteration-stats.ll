@@ -0,0 +1,32 @@
+; RUN: opt < %s -instcombine -instcombine-report-stats -S 2>&1 | FileCheck %s
+; RUN: opt < %s -instcombine -instcombine-max-iterations=1 -S | FileCheck %s --check-prefix=LIMIT
+; RUN: opt < %s -instcombine -instcombine-max-iterations=1 -debug-pass=Details -disable-output 2>&1 | FileCheck %s --check-prefix=CHANGED
+
+; The add folds away on the first iteration; the second one only confirms
+; the fixed point.
+
+; CHECK-LABEL: InstCombine stats for 'fold': 2 iterations
+; CHECK-NOT: rule
+; CHECK-DAG: add: {{[0-9]+}} visits, 1 combined
+; CHECK-DAG: ret: {{[0-9]+}} visits, 0 combined
+
+; LIMIT-LABEL: @fold(
+; LIMIT-NEXT: ret i32 %x
+
+; Stopping at the cap after a changing iteration still reports the change.
+; CHANGED: Made Modification 'Combine redundant instructions' on Function 'fold'
+define i32 @fold(i32 %x) {
+  %a = add i32 %x, 0
+  ret i32 %a
+}
+
+; The constants of the two adds are combined by reassociation.
+
+; CHECK-LABEL: InstCombine stats for 'reassoc': 2 iterations
+; CHECK: rule reassociate: 1
+; CHECK-DAG: add: {{[0-9]+}} visits, 1 combined
+define i32 @reassoc(i32 %x) {
+  %a = add i32 %x, 1
+  %b = add i32 %a, 2
+  ret i32 %b
+}
@@ -0,0 +1,48 @@
+; RUN: opt -basicaa -print-memoryssa -verify-memoryssa -analyze < %s 2>&1 | FileCheck %s
+; RUN: opt -basicaa -print-memoryssa -verify-memoryssa -analyze -memssa-check-limit=1 < %s 2>&1 | FileCheck %s --check-prefix=LIMIT
+
+; The uses are optimized in one walk over the dominator tree. Loads of a
+; location that was already looked up only check the stores since, and a phi
+; in between is resolved with the walker.
+
+define i32 @f(i1 %c) {
+entry:
+  %a = alloca i32
+  %b = alloca i32
+; CHECK: 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 1, i32* %a
+  store i32 1, i32* %a
+; CHECK: 2 = MemoryDef(1)
+; CHECK-NEXT: store i32 2, i32* %b
+  store i32 2, i32* %b
+; CHECK: 3 = MemoryDef(2)
+; CHECK-NEXT: store i32 3, i32* %b
+  store i32 3, i32* %b
+; CHECK: MemoryUse(1)
+; CHECK-NEXT: %x = load i32, i32* %a
+; LIMIT: MemoryUse(3)
+; LIMIT-NEXT: %x = load i32, i32* %a
+  %x = load i32, i32* %a
+  br i1 %c, label %then, label %join
+
+then:
+; CHECK: 4 = MemoryDef(3)
+; CHECK-NEXT: store i32 4, i32* %b
+  store i32 4, i32* %b
+; CHECK: MemoryUse(1)
+; CHECK-NEXT: %y = load i32, i32* %a
+  %y = load i32, i32* %a
+  br label %join
+
+join:
+; CHECK: 5 = MemoryPhi({entry,3},{then,4})
+; CHECK: MemoryUse(1)
+; CHECK-NEXT: %z = load i32, i32* %a
+  %z = load i32, i32* %a
+; CHECK: MemoryUse(5)
+; CHECK-NEXT: %w = load i32, i32* %b
+  %w = load i32, i32* %b
+  %s = add i32 %x, %z
+  %t = add i32 %s, %w
+  ret i32 %t
+}
@@ -1,4 +1,5 @@
 ; RUN: not llvm-as %s -o /dev/null 2>&1 | FileCheck %s
+; RUN: not llvm-as -verify-threads=4 %s -o /dev/null 2>&1 | FileCheck %s
 
 declare void @llvm.localescape(...)
 declare i8* @llvm.localrecover(i8*, i8*, i32)
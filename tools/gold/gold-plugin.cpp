@@ -1374,6 +1374,7 @@ static ld_plugin_status thinLTOLink(raw_fd_ostream *ApiFile) {
     if (Index)
       CombinedIndex.mergeFrom(std::move(Index), ++NextModuleId);
   }
+  CombinedIndex.finalize();
 
   // Collect for each module the list of function it defines (GUID ->
   // Summary).
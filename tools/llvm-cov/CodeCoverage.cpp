@@ -32,6 +32,8 @@
 #include "llvm/Support/Program.h"
 #include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/ToolOutputFile.h"
+#include <algorithm>
+#include <deque>
 #include <functional>
 #include <system_error>
 
@@ -64,6 +66,10 @@ public:
   /// \brief Copy \p Path into the list of input source files.
   void addCollectedPath(const std::string &Path);
 
+  /// \brief If \p Path is a directory, add every file below it to the list
+  /// of input source files, otherwise add \p Path itself.
+  void collectPaths(const std::string &Path);
+
   /// \brief Return a memory buffer for the given source file.
   ErrorOr<const MemoryBuffer &> getSourceFile(StringRef SourceFile);
 
@@ -116,8 +122,9 @@ private:
   /// A cache for demangled symbol names.
   StringMap<std::string> DemangledNames;
 
-  /// File paths (absolute, or otherwise) to input source files.
-  std::vector<std::string> CollectedPaths;
+  /// File paths (absolute, or otherwise) to input source files. SourceFiles
+  /// refers to these strings, so they must not move as more are added.
+  std::deque<std::string> CollectedPaths;
 
   /// Errors and warnings which have not been printed.
   std::mutex ErrsLock;
@@ -156,6 +163,31 @@ void CodeCoverageTool::addCollectedPath(const std::string &Path) {
   SourceFiles.emplace_back(CollectedPaths.back());
 }
 
+void CodeCoverageTool::collectPaths(const std::string &Path) {
+  if (!sys::fs::is_directory(Path)) {
+    addCollectedPath(Path);
+    return;
+  }
+
+  // Source trees can be large. The walk reads directories in parallel and
+  // only needs the file types the listings already give.
+  std::vector<std::string> Files;
+  std::error_code EC = sys::fs::walk_directory_tree(
+      Path, [&](const sys::fs::directory_entry &Entry,
+                const sys::fs::file_status &Status) {
+        if (sys::fs::is_regular_file(Status))
+          Files.push_back(Entry.path());
+        return sys::fs::is_directory(Status);
+      });
+  if (EC)
+    warning(EC.message(), Path);
+
+  // The walk visits directories in no particular order.
+  std::sort(Files.begin(), Files.end());
+  for (const std::string &File : Files)
+    addCollectedPath(File);
+}
+
 ErrorOr<const MemoryBuffer &>
 CodeCoverageTool::getSourceFile(StringRef SourceFile) {
   // If we've remapped filenames, look up the real location for this file.
@@ -533,7 +565,7 @@ int CodeCoverageTool::run(Command Cmd, int argc, const char **argv) {
           return 1;
         }
       }
-      addCollectedPath(Path.str());
+      collectPaths(Path.str());
     }
     return 0;
   };
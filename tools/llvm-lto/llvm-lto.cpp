@@ -17,6 +17,7 @@
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/MappedSummaryIndex.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/LTO/legacy/LTOCodeGenerator.h"
@@ -105,6 +106,11 @@ static cl::opt<std::string>
                  cl::desc("Provide the index produced by a ThinLink, required "
                           "to perform the promotion and/or importing."));
 
+static cl::opt<bool> ThinLTOMappedIndex(
+    "thinlto-mapped-index", cl::init(false),
+    cl::desc("Write the ThinLink combined index in the mapped summary index "
+             "format, which backends query in place."));
+
 static cl::opt<std::string> ThinLTOPrefixReplace(
     "thinlto-prefix-replace",
     cl::desc("Control where files for distributed backends are "
@@ -297,6 +303,7 @@ static void createCombinedModuleSummaryIndex() {
       continue;
     CombinedIndex.mergeFrom(std::move(Index), ++NextModuleId);
   }
+  CombinedIndex.finalize();
   std::error_code EC;
   assert(!OutputFilename.empty());
   raw_fd_ostream OS(OutputFilename + ".thinlto.bc", EC,
@@ -449,7 +456,10 @@ private:
     std::error_code EC;
     raw_fd_ostream OS(OutputFilename, EC, sys::fs::OpenFlags::F_None);
     error(EC, "error opening the file '" + OutputFilename + "'");
-    WriteIndexToFile(*CombinedIndex, OS);
+    if (ThinLTOMappedIndex)
+      writeMappedSummaryIndex(*CombinedIndex, OS);
+    else
+      WriteIndexToFile(*CombinedIndex, OS);
     return;
   }
 
@@ -0,0 +1,216 @@
+//===- llvm/unittest/ADT/SwissTableMapTest.cpp - SwissTableMap tests ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SwissTableMap.h"
+#include "gtest/gtest.h"
+#include <map>
+#include <memory>
+#include <string>
+
+using namespace llvm;
+
+namespace {
+
+TEST(SwissTableMapTest, EmptyMap) {
+  SwissTableMap<unsigned, unsigned> Map;
+  EXPECT_TRUE(Map.empty());
+  EXPECT_EQ(0u, Map.size());
+  EXPECT_TRUE(Map.begin() == Map.end());
+  EXPECT_TRUE(Map.find(0) == Map.end());
+  EXPECT_EQ(0u, Map.count(0));
+  EXPECT_EQ(0u, Map.lookup(0));
+  EXPECT_FALSE(Map.erase(0));
+  EXPECT_EQ(0u, Map.getMemorySize());
+}
+
+TEST(SwissTableMapTest, SingleEntry) {
+  SwissTableMap<unsigned, unsigned> Map;
+  Map[1] = 2;
+  EXPECT_FALSE(Map.empty());
+  EXPECT_EQ(1u, Map.size());
+  EXPECT_EQ(1u, Map.count(1));
+  EXPECT_EQ(2u, Map.lookup(1));
+  EXPECT_TRUE(Map.find(1) != Map.end());
+  EXPECT_EQ(1u, Map.find(1)->first);
+  EXPECT_EQ(2u, Map.find(1)->second);
+
+  auto It = Map.begin();
+  EXPECT_EQ(1u, It->first);
+  ++It;
+  EXPECT_TRUE(It == Map.end());
+}
+
+TEST(SwissTableMapTest, InsertDoesNotOverwrite) {
+  SwissTableMap<unsigned, unsigned> Map;
+  auto R = Map.insert(std::make_pair(1u, 2u));
+  EXPECT_TRUE(R.second);
+  R = Map.insert(std::make_pair(1u, 3u));
+  EXPECT_FALSE(R.second);
+  EXPECT_EQ(2u, R.first->second);
+  EXPECT_EQ(1u, Map.size());
+}
+
+// The sentinel keys of DenseMapInfo are ordinary keys here.
+TEST(SwissTableMapTest, DenseMapInfoSentinelKeys) {
+  SwissTableMap<unsigned, unsigned> Map;
+  unsigned Empty = DenseMapInfo<unsigned>::getEmptyKey();
+  unsigned Tombstone = DenseMapInfo<unsigned>::getTombstoneKey();
+  Map[Empty] = 1;
+  Map[Tombstone] = 2;
+  EXPECT_EQ(2u, Map.size());
+  EXPECT_EQ(1u, Map.lookup(Empty));
+  EXPECT_EQ(2u, Map.lookup(Tombstone));
+}
+
+TEST(SwissTableMapTest, GrowAndErase) {
+  SwissTableMap<unsigned, unsigned> Map;
+  for (unsigned I = 0; I != 10000; ++I)
+    Map[I] = I * 3;
+  EXPECT_EQ(10000u, Map.size());
+  for (unsigned I = 0; I != 10000; ++I)
+    EXPECT_EQ(I * 3, Map.lookup(I));
+
+  for (unsigned I = 0; I != 10000; I += 2)
+    EXPECT_TRUE(Map.erase(I));
+  EXPECT_EQ(5000u, Map.size());
+  for (unsigned I = 0; I != 10000; ++I)
+    EXPECT_EQ(I % 2, Map.count(I));
+
+  unsigned Visited = 0;
+  for (const auto &KV : Map) {
+    EXPECT_EQ(1u, KV.first % 2);
+    EXPECT_EQ(KV.first * 3, KV.second);
+    ++Visited;
+  }
+  EXPECT_EQ(5000u, Visited);
+}
+
+// Repeatedly inserting and erasing keeps the table small by rehashing in
+// place instead of growing on tombstones.
+TEST(SwissTableMapTest, TombstoneChurn) {
+  SwissTableMap<unsigned, unsigned> Map;
+  for (unsigned I = 0; I != 100000; ++I) {
+    Map[I] = I;
+    if (I >= 4) {
+      EXPECT_TRUE(Map.erase(I - 4));
+    }
+  }
+  EXPECT_EQ(4u, Map.size());
+  EXPECT_LE(Map.getMemorySize(), 64 * (sizeof(unsigned) * 2 + 1) + 16);
+  for (unsigned I = 100000 - 4; I != 100000; ++I)
+    EXPECT_EQ(I, Map.lookup(I));
+}
+
+TEST(SwissTableMapTest, EraseIterator) {
+  SwissTableMap<unsigned, unsigned> Map;
+  for (unsigned I = 0; I != 100; ++I)
+    Map[I] = I;
+  Map.erase(Map.find(42));
+  EXPECT_EQ(99u, Map.size());
+  EXPECT_EQ(0u, Map.count(42));
+}
+
+TEST(SwissTableMapTest, ClearAndReuse) {
+  SwissTableMap<unsigned, unsigned> Map;
+  for (unsigned I = 0; I != 100; ++I)
+    Map[I] = I;
+  Map.clear();
+  EXPECT_TRUE(Map.empty());
+  EXPECT_TRUE(Map.begin() == Map.end());
+  EXPECT_EQ(0u, Map.count(5));
+  Map[5] = 6;
+  EXPECT_EQ(6u, Map.lookup(5));
+}
+
+TEST(SwissTableMapTest, Reserve) {
+  SwissTableMap<unsigned, unsigned> Map(1000);
+  size_t MemorySize = Map.getMemorySize();
+  for (unsigned I = 0; I != 1000; ++I)
+    Map[I] = I;
+  EXPECT_EQ(MemorySize, Map.getMemorySize());
+}
+
+TEST(SwissTableMapTest, CopyAndMove) {
+  SwissTableMap<unsigned, std::string> Map;
+  for (unsigned I = 0; I != 100; ++I)
+    Map[I] = std::to_string(I);
+
+  SwissTableMap<unsigned, std::string> Copy(Map);
+  EXPECT_EQ(100u, Copy.size());
+  EXPECT_EQ("42", Copy.lookup(42));
+
+  SwissTableMap<unsigned, std::string> Moved(std::move(Copy));
+  EXPECT_EQ(100u, Moved.size());
+  EXPECT_TRUE(Copy.empty());
+  EXPECT_EQ("42", Moved.lookup(42));
+
+  Copy = Moved;
+  EXPECT_EQ(100u, Copy.size());
+  Moved.clear();
+  EXPECT_EQ("7", Copy.lookup(7));
+
+  Moved = std::move(Copy);
+  EXPECT_EQ("7", Moved.lookup(7));
+}
+
+TEST(SwissTableMapTest, MoveOnlyValues) {
+  SwissTableMap<unsigned, std::unique_ptr<unsigned>> Map;
+  for (unsigned I = 0; I != 100; ++I)
+    Map.try_emplace(I, new unsigned(I));
+  for (unsigned I = 0; I != 100; ++I)
+    EXPECT_EQ(I, *Map.find(I)->second);
+}
+
+TEST(SwissTableMapTest, PointerKeys) {
+  std::unique_ptr<int[]> Storage(new int[1000]);
+  SwissTableMap<int *, unsigned> Map;
+  for (unsigned I = 0; I != 1000; ++I)
+    Map[&Storage[I]] = I;
+  for (unsigned I = 0; I != 1000; ++I)
+    EXPECT_EQ(I, Map.lookup(&Storage[I]));
+}
+
+struct CollidingKeyInfo {
+  static unsigned getEmptyKey() { return ~0U; }
+  static unsigned getTombstoneKey() { return ~0U - 1; }
+  static unsigned getHashValue(unsigned Val) { return Val % 3; }
+  static bool isEqual(unsigned LHS, unsigned RHS) { return LHS == RHS; }
+};
+
+// Keys with the same hash share one probe sequence.
+TEST(SwissTableMapTest, Collisions) {
+  SwissTableMap<unsigned, unsigned, CollidingKeyInfo> Map;
+  for (unsigned I = 0; I != 300; ++I)
+    Map[I] = I;
+  for (unsigned I = 0; I != 300; I += 3)
+    Map.erase(I);
+  for (unsigned I = 0; I != 300; ++I)
+    EXPECT_EQ(I % 3 != 0, Map.count(I) == 1);
+}
+
+TEST(SwissTableMapTest, MatchesStdMap) {
+  SwissTableMap<unsigned, unsigned> Map;
+  std::map<unsigned, unsigned> Reference;
+  unsigned Seed = 1;
+  for (unsigned I = 0; I != 50000; ++I) {
+    Seed = Seed * 1103515245 + 12345;
+    unsigned Key = (Seed >> 8) % 2048;
+    if (Seed & 1) {
+      Map[Key] = I;
+      Reference[Key] = I;
+    } else {
+      EXPECT_EQ(Reference.erase(Key) == 1, Map.erase(Key));
+    }
+  }
+  EXPECT_EQ(Reference.size(), Map.size());
+  for (const auto &KV : Reference)
+    EXPECT_EQ(KV.second, Map.lookup(KV.first));
+}
+
+} // end anonymous namespace
@@ -19,6 +19,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/SourceMgr.h"
 #include "gtest/gtest.h"
 
@@ -204,6 +205,39 @@ TEST_F(AliasAnalysisTest, getModRefInfo) {
   EXPECT_EQ(AA.getModRefInfo(AtomicRMW), MRI_ModRef);
 }
 
+TEST_F(AliasAnalysisTest, QueryCacheTracksIR) {
+  auto *EnableQueryCache = static_cast<cl::opt<bool> *>(
+      cl::getRegisteredOptions()["aa-query-cache"]);
+  ASSERT_NE(nullptr, EnableQueryCache);
+  *EnableQueryCache = true;
+
+  FunctionType *FTy =
+      FunctionType::get(Type::getVoidTy(C), std::vector<Type *>(), false);
+  auto *F = cast<Function>(M.getOrInsertFunction("f", FTy));
+  auto *BB = BasicBlock::Create(C, "entry", F);
+  auto *IntType = Type::getInt32Ty(C);
+  auto *A = new AllocaInst(IntType, "a", BB);
+  auto *B = new AllocaInst(IntType, "b", BB);
+  auto *P = GetElementPtrInst::Create(
+      IntType, A, ConstantInt::get(Type::getInt64Ty(C), 0), "p", BB);
+  ReturnInst::Create(C, nullptr, BB);
+
+  auto &AA = getAAResults(*F);
+  EXPECT_EQ(MustAlias, AA.alias(P, 4, A, 4));
+  EXPECT_EQ(NoAlias, AA.alias(P, 4, B, 4));
+
+  // An operand rewritten in place doesn't notify any value handle.
+  P->setOperand(0, B);
+  EXPECT_EQ(NoAlias, AA.alias(P, 4, A, 4));
+  EXPECT_EQ(MustAlias, AA.alias(P, 4, B, 4));
+
+  // Replacing a value in the address computation drops the cached results.
+  B->replaceAllUsesWith(A);
+  EXPECT_EQ(MustAlias, AA.alias(P, 4, A, 4));
+
+  *EnableQueryCache = false;
+}
+
 class AAPassInfraTest : public testing::Test {
 protected:
   LLVMContext C;
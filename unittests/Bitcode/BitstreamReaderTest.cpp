@@ -238,4 +238,41 @@ TEST(BitstreamReaderTest, readRecordWithBlobWhileStreaming) {
   }
 }
 
+// VBRs of every chunk width, some of which straddle word boundaries, read
+// back the same from memory and from a stream.
+TEST(BitstreamReaderTest, readVBR) {
+  SmallVector<std::pair<uint64_t, unsigned>, 64> Values;
+  uint64_t Value = 1;
+  for (unsigned Width = 2; Width <= 32; ++Width) {
+    Value = Value * 6364136223846793005ULL + 1442695040888963407ULL;
+    Values.push_back(std::make_pair(Value >> Width, Width));
+    Values.push_back(std::make_pair(Value & 0xff, Width));
+  }
+
+  SmallVector<char, 1> Buffer;
+  {
+    BitstreamWriter Stream(Buffer);
+    for (const auto &V : Values)
+      Stream.EmitVBR64(V.first, V.second);
+    Stream.FlushToWord();
+  }
+
+  BitstreamReader MemR((const uint8_t *)Buffer.begin(),
+                       (const uint8_t *)Buffer.end());
+  BitstreamReader StreamR(llvm::make_unique<StreamingMemoryObject>(
+      llvm::make_unique<BufferStreamer>(
+          StringRef(Buffer.begin(), Buffer.size()))));
+  for (BitstreamReader *R : {&MemR, &StreamR}) {
+    SimpleBitstreamCursor Cursor(*R);
+    for (const auto &V : Values)
+      EXPECT_EQ(V.first, Cursor.ReadVBR64(V.second));
+    Cursor.JumpToBit(0);
+    for (const auto &V : Values)
+      if (V.first <= UINT32_MAX)
+        EXPECT_EQ(V.first, Cursor.ReadVBR(V.second));
+      else
+        Cursor.ReadVBR64(V.second);
+  }
+}
+
 } // end anonymous namespace
@@ -0,0 +1,104 @@
+//===- llvm/unittest/IR/MappedSummaryIndexTest.cpp - Mapped index tests ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/MappedSummaryIndex.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+typedef MappedSummaryIndex::SummaryEntry SummaryEntry;
+
+class MappedSummaryIndexTest : public testing::Test {
+protected:
+  std::string Buffer;
+
+  void SetUp() override {
+    // Module "a" defines @f (GUID 1) and an alias @al (GUID 3) of it, module
+    // "b" defines @g (GUID 2).
+    ModuleSummaryIndex Index;
+    StringRef A = Index.addModulePath("a", 1)->first();
+    StringRef B = Index.addModulePath("b", 2)->first();
+    GlobalValueSummary::GVFlags Flags(GlobalValue::ExternalLinkage, false);
+
+    auto F = llvm::make_unique<FunctionSummary>(Flags, 10);
+    F->setModulePath(A);
+    auto G = llvm::make_unique<FunctionSummary>(Flags, 20);
+    G->setModulePath(B);
+    auto Al = llvm::make_unique<AliasSummary>(Flags);
+    Al->setModulePath(A);
+    Al->setAliasee(F.get());
+    Index.addGlobalValueSummary(1, std::move(F));
+    Index.addGlobalValueSummary(3, std::move(Al));
+    Index.addGlobalValueSummary(2, std::move(G));
+    Index.finalize();
+
+    raw_string_ostream OS(Buffer);
+    writeMappedSummaryIndex(Index, OS);
+  }
+
+  SummaryEntry *summaries() {
+    auto *H = reinterpret_cast<MappedSummaryIndex::Header *>(&Buffer[0]);
+    return reinterpret_cast<SummaryEntry *>(
+        &Buffer[sizeof(*H) +
+                H->NumModules * sizeof(MappedSummaryIndex::ModuleEntry)]);
+  }
+
+  std::string createError() {
+    auto IndexOrErr = MappedSummaryIndex::create(
+        MemoryBufferRef(Buffer, "index"));
+    if (IndexOrErr)
+      return "";
+    return toString(IndexOrErr.takeError());
+  }
+};
+
+TEST_F(MappedSummaryIndexTest, RoundTrip) {
+  auto IndexOrErr = MappedSummaryIndex::create(MemoryBufferRef(Buffer, "index"));
+  ASSERT_TRUE(!!IndexOrErr);
+  MappedSummaryIndex &Mapped = **IndexOrErr;
+  EXPECT_EQ(3u, Mapped.summaries().size());
+  EXPECT_EQ(1u, Mapped.findSummaries(2).size());
+  EXPECT_TRUE(Mapped.findSummaries(4).empty());
+  ASSERT_NE(nullptr, Mapped.findSummaryInModule(3, "a"));
+  EXPECT_EQ(nullptr, Mapped.findSummaryInModule(3, "b"));
+
+  std::unique_ptr<ModuleSummaryIndex> Index = Mapped.materializeForModule("a");
+  auto *Alias = cast<AliasSummary>(Index->findSummaryInModule(3, "a"));
+  EXPECT_EQ(Index->findSummaryInModule(1, "a"), &Alias->getAliasee());
+  EXPECT_EQ(nullptr, Index->findSummaryInModule(2, "b"));
+}
+
+TEST_F(MappedSummaryIndexTest, AliasWithoutAliasee) {
+  SummaryEntry *Summaries = summaries();
+  ASSERT_EQ(3u, Summaries[2].GUID);
+  Summaries[2].AliaseeGUID = 2;
+  EXPECT_EQ("malformed mapped summary index: alias without an aliasee",
+            createError());
+}
+
+TEST_F(MappedSummaryIndexTest, UnsortedSummaries) {
+  SummaryEntry *Summaries = summaries();
+  Summaries[0].GUID = 5;
+  EXPECT_EQ("malformed mapped summary index: summaries not sorted by GUID and "
+            "module",
+            createError());
+}
+
+TEST_F(MappedSummaryIndexTest, Truncated) {
+  Buffer.resize(Buffer.size() - 1);
+  EXPECT_EQ("malformed mapped summary index: bad string table size",
+            createError());
+  Buffer.resize(40);
+  EXPECT_EQ("malformed mapped summary index: truncated tables", createError());
+}
+
+} // end anonymous namespace
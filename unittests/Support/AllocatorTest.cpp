@@ -67,6 +67,7 @@ TEST(AllocatorTest, TestReset) {
   Alloc.Reset();
   // Calling Reset should free all CustomSizedSlabs.
   EXPECT_EQ(0u, Alloc.GetNumSlabs());
+  EXPECT_EQ(0u, Alloc.getBytesAllocated());
 
   Alloc.Allocate(3000, 1);
   EXPECT_EQ(1U, Alloc.GetNumSlabs());
@@ -0,0 +1,147 @@
+//===- unittests/Support/CachePruningTest.cpp - CachePruning tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CachePruning.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+class CachePruningTest : public testing::Test {
+protected:
+  SmallString<64> CacheDir;
+
+  void SetUp() override {
+    ASSERT_FALSE(
+        sys::fs::createUniqueDirectory("CachePruningTestDir", CacheDir));
+  }
+
+  void TearDown() override {
+    std::vector<std::string> Files;
+    std::error_code EC;
+    for (sys::fs::directory_iterator I(CacheDir, EC), E; I != E && !EC;
+         I.increment(EC))
+      Files.push_back(I->path());
+    for (const std::string &File : Files)
+      sys::fs::remove(File);
+    sys::fs::remove(CacheDir);
+  }
+
+  std::string getPath(StringRef Name) {
+    SmallString<64> Path(CacheDir);
+    sys::path::append(Path, Name);
+    return Path.str();
+  }
+
+  bool exists(StringRef Name) { return sys::fs::exists(getPath(Name)); }
+
+  /// Create an entry of Size bytes that was last used Age seconds ago.
+  void createEntry(StringRef Name, unsigned Size, unsigned Age) {
+    int FD;
+    ASSERT_FALSE(sys::fs::openFileForWrite(getPath(Name), FD, sys::fs::F_None));
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << std::string(Size, 'x');
+    OS.flush();
+    ASSERT_FALSE(sys::fs::setLastModificationAndAccessTime(
+        FD, sys::TimeValue::now() -
+                sys::TimeValue(sys::TimeValue::SecondsType(Age))));
+  }
+};
+
+TEST_F(CachePruningTest, EvictLeastRecentlyUsed) {
+  createEntry("a", 100, 400);
+  createEntry("b", 100, 300);
+  createEntry("c", 100, 200);
+  createEntry("d", 100, 100);
+
+  // Without an index, every entry is stat()'d for its access time.
+  EXPECT_TRUE(CachePruning(CacheDir)
+                  .setPruningInterval(0)
+                  .setMaxSizeBytes(250)
+                  .prune());
+  EXPECT_FALSE(exists("a"));
+  EXPECT_FALSE(exists("b"));
+  EXPECT_TRUE(exists("c"));
+  EXPECT_TRUE(exists("d"));
+  EXPECT_TRUE(exists("llvmcache.index"));
+  EXPECT_TRUE(exists("llvmcache.timestamp"));
+
+  // Now the index knows c and d, and the journal says c was just used, which
+  // makes it newer than e even though its file was not touched.
+  CachePruning::recordAccess(getPath("c"), 100);
+  EXPECT_TRUE(exists("llvmcache.journal"));
+  createEntry("e", 100, 50);
+  EXPECT_TRUE(CachePruning(CacheDir)
+                  .setPruningInterval(0)
+                  .setMaxSizeBytes(150)
+                  .prune());
+  EXPECT_TRUE(exists("c"));
+  EXPECT_FALSE(exists("d"));
+  EXPECT_FALSE(exists("e"));
+}
+
+TEST_F(CachePruningTest, Expiration) {
+  createEntry("old", 10, 1000);
+  createEntry("new", 10, 0);
+  EXPECT_TRUE(CachePruning(CacheDir)
+                  .setPruningInterval(0)
+                  .setEntryExpiration(500)
+                  .prune());
+  EXPECT_FALSE(exists("old"));
+  EXPECT_TRUE(exists("new"));
+
+  // An entry that the index thinks is old is kept if its file was used since.
+  createEntry("reused", 10, 1000);
+  CachePruning(CacheDir).setPruningInterval(0).setMaxSizeBytes(1000).prune();
+  createEntry("reused", 10, 0);
+  EXPECT_TRUE(CachePruning(CacheDir)
+                  .setPruningInterval(0)
+                  .setEntryExpiration(500)
+                  .prune());
+  EXPECT_TRUE(exists("reused"));
+  EXPECT_TRUE(exists("new"));
+}
+
+TEST_F(CachePruningTest, PruningInterval) {
+  createEntry("a", 10, 1000);
+  EXPECT_TRUE(CachePruning(CacheDir)
+                  .setPruningInterval(3600)
+                  .setEntryExpiration(500)
+                  .prune());
+  createEntry("b", 10, 1000);
+  // The timestamp written by the first prune is too recent.
+  EXPECT_FALSE(CachePruning(CacheDir)
+                   .setPruningInterval(3600)
+                   .setEntryExpiration(500)
+                   .prune());
+  EXPECT_TRUE(exists("b"));
+}
+
+TEST_F(CachePruningTest, TemporariesAreNotEntries) {
+  // Left behind by a process that was writing a new index or moving the
+  // journal aside. They are not entries, so they are neither counted nor
+  // removed.
+  createEntry("llvmcache.index-a1b2c3", 100, 1000);
+  createEntry("llvmcache.journal-d4e5f6", 100, 1000);
+  createEntry("llvmcache.indexed", 100, 1000);
+  EXPECT_TRUE(CachePruning(CacheDir)
+                  .setPruningInterval(0)
+                  .setEntryExpiration(500)
+                  .prune());
+  EXPECT_TRUE(exists("llvmcache.index-a1b2c3"));
+  EXPECT_TRUE(exists("llvmcache.journal-d4e5f6"));
+  EXPECT_FALSE(exists("llvmcache.indexed"));
+}
+
+} // end anonymous namespace
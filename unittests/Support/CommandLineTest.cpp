@@ -476,4 +476,26 @@ TEST(CommandLineTest, RemoveFromAllSubCommands) {
   EXPECT_FALSE(cl::ParseCommandLineOptions(3, args2, nullptr, true));
 }
 
+// Options reach the option maps lazily. Ones constructed, or renamed, after
+// a parse must still be seen by the next one.
+TEST(CommandLineTest, RegisterOptionsAfterParsing) {
+  cl::ResetCommandLineParser();
+
+  StackOption<bool> First("first-option", cl::init(false));
+  const char *args[] = {"prog", "-first-option", "-second-option"};
+
+  EXPECT_FALSE(cl::ParseCommandLineOptions(3, args, nullptr, true));
+  EXPECT_TRUE(First);
+
+  StackOption<bool> Second("second-option-old", cl::init(false));
+  Second.setArgStr("second-option");
+  EXPECT_EQ(0u, cl::getRegisteredOptions().count("second-option-old"));
+  EXPECT_EQ(1u, cl::getRegisteredOptions().count("second-option"));
+
+  cl::ResetAllOptionOccurrences();
+  EXPECT_TRUE(cl::ParseCommandLineOptions(3, args, nullptr, true));
+  EXPECT_TRUE(First);
+  EXPECT_TRUE(Second);
+}
+
 }  // anonymous namespace
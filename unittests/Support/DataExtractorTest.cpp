@@ -117,4 +117,25 @@ TEST(DataExtractorTest, LEB128) {
   EXPECT_EQ(8U, offset);
 }
 
+TEST(DataExtractorTest, ULEB128Array) {
+  DataExtractor DE(StringRef(leb128data, sizeof(leb128data)-1), false, 8);
+  DataExtractor BDE(StringRef(bigleb128data, sizeof(bigleb128data)-1), false,8);
+  uint64_t Values[2];
+  uint32_t offset = 0;
+
+  EXPECT_EQ(Values, DE.getULEB128(&offset, Values, 1));
+  EXPECT_EQ(9382ULL, Values[0]);
+  EXPECT_EQ(2U, offset);
+
+  offset = 0;
+  EXPECT_EQ(Values, BDE.getULEB128(&offset, Values, 1));
+  EXPECT_EQ(42218325750568106ULL, Values[0]);
+  EXPECT_EQ(8U, offset);
+
+  // The data ends before the second value, so nothing is extracted.
+  offset = 0;
+  EXPECT_EQ(nullptr, DE.getULEB128(&offset, Values, 2));
+  EXPECT_EQ(0U, offset);
+}
+
 }
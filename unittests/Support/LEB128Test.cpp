@@ -12,6 +12,7 @@
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/raw_ostream.h"
 #include <string>
+#include <vector>
 using namespace llvm;
 
 namespace {
@@ -119,6 +120,45 @@ TEST(LEB128Test, DecodeULEB128) {
 #undef EXPECT_DECODE_ULEB128_EQ
 }
 
+TEST(LEB128Test, DecodeULEB128Batch) {
+  // Cover single byte runs, values of every encoded length, and padded
+  // encodings, at every alignment relative to the end of the buffer.
+  std::vector<uint64_t> Values;
+  for (unsigned I = 0; I != 20; ++I)
+    Values.push_back(I);
+  for (unsigned Bits = 0; Bits <= 64; ++Bits) {
+    uint64_t Value = Bits == 64 ? ~0ULL : (1ULL << Bits) - 1;
+    Values.push_back(Value);
+    Values.push_back(Value / 3);
+  }
+
+  std::string Encoded;
+  raw_string_ostream Stream(Encoded);
+  for (unsigned I = 0, E = Values.size(); I != E; ++I)
+    encodeULEB128(Values[I], Stream, I % 5 == 0 ? 9 : 0);
+  Stream.flush();
+  const uint8_t *Begin = reinterpret_cast<const uint8_t *>(Encoded.data());
+  const uint8_t *End = Begin + Encoded.size();
+
+  for (unsigned Skip = 0; Skip != 10; ++Skip) {
+    const uint8_t *P = Begin;
+    std::vector<uint64_t> Out(Values.size());
+    EXPECT_EQ(Skip, decodeULEB128Batch(P, End, Out.data(), Skip));
+    unsigned Rest = Values.size() - Skip;
+    EXPECT_EQ(Rest, decodeULEB128Batch(P, End, Out.data() + Skip, Rest + 1));
+    EXPECT_EQ(End, P);
+    EXPECT_EQ(Values, Out);
+  }
+
+  // A value truncated by the end of the buffer is not decoded.
+  const uint8_t Truncated[] = {0x01, 0x80, 0x80};
+  const uint8_t *P = Truncated;
+  uint64_t Out[2];
+  EXPECT_EQ(1u, decodeULEB128Batch(P, std::end(Truncated), Out, 2));
+  EXPECT_EQ(1u, Out[0]);
+  EXPECT_EQ(Truncated + 1, P);
+}
+
 TEST(LEB128Test, DecodeSLEB128) {
 #define EXPECT_DECODE_SLEB128_EQ(EXPECTED, VALUE) \
   do { \
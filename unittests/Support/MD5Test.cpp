@@ -15,6 +15,9 @@
 #include "llvm/ADT/SmallString.h"
 #include "llvm/Support/MD5.h"
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <string>
+#include <vector>
 
 using namespace llvm;
 
@@ -57,4 +60,53 @@ TEST(MD5Test, MD5) {
              "81948d1f1554f58cd1a56ebb01f808cb");
   TestMD5Sum("abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b");
 }
+
+class MD5HashManyTest : public testing::TestWithParam<MD5::Implementation> {
+protected:
+  void SetUp() override {
+    Supported = MD5::setImplementationForTesting(GetParam());
+  }
+  void TearDown() override {
+    MD5::setImplementationForTesting(MD5::Implementation::Default);
+  }
+
+  bool Supported;
+};
+
+TEST_P(MD5HashManyTest, HashMany) {
+  if (!Supported)
+    return;
+
+  // Cover every tail size and messages of different lengths in one group.
+  std::vector<std::string> Messages;
+  for (unsigned I = 0; I != 300; ++I) {
+    std::string S;
+    for (unsigned J = 0, E = I * 7 % 400; J != E; ++J)
+      S.push_back(static_cast<char>(I * J + 3));
+    Messages.push_back(S);
+  }
+  Messages.push_back("abcdefghijklmnopqrstuvwxyz");
+
+  std::vector<ArrayRef<uint8_t>> Inputs;
+  for (const std::string &S : Messages)
+    Inputs.push_back(makeArrayRef(
+        reinterpret_cast<const uint8_t *>(S.data()), S.size()));
+  std::vector<std::array<uint8_t, 16>> Results(Inputs.size());
+  MD5::hashMany(Inputs, Results);
+
+  for (size_t I = 0, E = Inputs.size(); I != E; ++I) {
+    MD5 Hash;
+    Hash.update(Inputs[I]);
+    MD5::MD5Result Expected;
+    Hash.final(Expected);
+    EXPECT_TRUE(std::equal(Results[I].begin(), Results[I].end(), Expected))
+        << "message " << I;
+  }
+  EXPECT_EQ(0xc3, Results.back()[0]);
+  EXPECT_EQ(0x3b, Results.back()[15]);
+}
+
+INSTANTIATE_TEST_CASE_P(Implementations, MD5HashManyTest,
+                        testing::Values(MD5::Implementation::Generic,
+                                        MD5::Implementation::AVX2));
 }
@@ -15,6 +15,7 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
+#include <map>
 
 #ifdef LLVM_ON_WIN32
 #include "llvm/ADT/ArrayRef.h"
@@ -732,6 +733,69 @@ TEST_F(FileSystemTest, DirectoryIteration) {
   ASSERT_NO_ERROR(fs::remove(Twine(TestDirectory) + "/reclevel"));
 }
 
+TEST_F(FileSystemTest, WalkDirectoryTree) {
+  // Enough files that the top directory is stat()'d in several batches.
+  const unsigned NumFiles = 600;
+  SmallString<128> Root(TestDirectory);
+  path::append(Root, "walk");
+  ASSERT_NO_ERROR(fs::create_directories(Twine(Root) + "/sub/deeper"));
+  ASSERT_NO_ERROR(fs::create_directories(Twine(Root) + "/dontlookhere/da1"));
+  std::vector<std::string> Files;
+  for (unsigned I = 0; I != NumFiles; ++I)
+    Files.push_back((Twine(Root) + "/f" + Twine(I)).str());
+  Files.push_back((Twine(Root) + "/sub/deeper/last").str());
+  for (const std::string &File : Files) {
+    std::error_code EC;
+    raw_fd_ostream OS(File, EC, fs::F_None);
+    ASSERT_NO_ERROR(EC);
+    OS << path::filename(File);
+  }
+
+  for (bool StatEntries : {false, true}) {
+    std::map<std::string, uint64_t> Visited;
+    std::error_code EC = fs::walk_directory_tree(
+        Root,
+        [&](const fs::directory_entry &Entry, const fs::file_status &Status) {
+          EXPECT_TRUE(Visited.insert(std::make_pair(Entry.path(),
+                                                    Status.getSize()))
+                          .second);
+          if (fs::is_directory(Status))
+            return path::filename(Entry.path()) != "dontlookhere";
+          EXPECT_TRUE(fs::is_regular_file(Status));
+          return true;
+        },
+        StatEntries, /*ThreadCount=*/4);
+    ASSERT_NO_ERROR(EC);
+
+    // All the files and directories except the one not descended into.
+    EXPECT_EQ(Files.size() + 3, Visited.size());
+    EXPECT_EQ(0u, Visited.count((Twine(Root) + "/dontlookhere/da1").str()));
+    EXPECT_EQ(1u, Visited.count((Twine(Root) + "/sub/deeper").str()));
+    for (const std::string &File : Files) {
+      ASSERT_EQ(1u, Visited.count(File));
+      // Only a full stat() knows the size.
+      if (StatEntries)
+        EXPECT_EQ(path::filename(File).size(), Visited[File]);
+    }
+  }
+
+  std::error_code EC = fs::walk_directory_tree(
+      Twine(Root) + "/missing",
+      [](const fs::directory_entry &, const fs::file_status &) {
+        ADD_FAILURE();
+        return false;
+      });
+  EXPECT_EQ(errc::no_such_file_or_directory, EC);
+
+  for (const std::string &File : Files)
+    ASSERT_NO_ERROR(fs::remove(File));
+  ASSERT_NO_ERROR(fs::remove(Twine(Root) + "/sub/deeper"));
+  ASSERT_NO_ERROR(fs::remove(Twine(Root) + "/sub"));
+  ASSERT_NO_ERROR(fs::remove(Twine(Root) + "/dontlookhere/da1"));
+  ASSERT_NO_ERROR(fs::remove(Twine(Root) + "/dontlookhere"));
+  ASSERT_NO_ERROR(fs::remove(Root));
+}
+
 const char archive[] = "!<arch>\x0A";
 const char bitcode[] = "\xde\xc0\x17\x0b";
 const char coff_object[] = "\x00\x00......";
@@ -0,0 +1,116 @@
+//===- llvm/unittest/Support/SHA1Test.cpp - SHA1 tests --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements unit tests for the SHA1 functions. Each test runs
+// against every implementation the host supports.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/SHA1.h"
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+std::string toHex(StringRef Input) {
+  static const char *const LUT = "0123456789abcdef";
+  std::string Output;
+  for (unsigned char C : Input) {
+    Output.push_back(LUT[C >> 4]);
+    Output.push_back(LUT[C & 15]);
+  }
+  return Output;
+}
+
+std::string toHex(const std::array<uint8_t, 20> &Hash) {
+  return toHex(StringRef(reinterpret_cast<const char *>(Hash.data()), 20));
+}
+
+ArrayRef<uint8_t> bytes(StringRef S) {
+  return ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(S.data()),
+                           S.size());
+}
+
+class SHA1Test : public testing::TestWithParam<SHA1::Implementation> {
+protected:
+  void SetUp() override {
+    Supported = SHA1::setImplementationForTesting(GetParam());
+  }
+  void TearDown() override {
+    SHA1::setImplementationForTesting(SHA1::Implementation::Default);
+  }
+
+  bool Supported;
+};
+
+// Test vectors from FIPS 180-2.
+TEST_P(SHA1Test, KnownValues) {
+  if (!Supported)
+    return;
+  EXPECT_EQ("da39a3ee5e6b4b0d3255bfef95601890afd80709",
+            toHex(SHA1::hash(bytes(""))));
+  EXPECT_EQ("a9993e364706816aba3e25717850c26c9cd0d89d",
+            toHex(SHA1::hash(bytes("abc"))));
+  EXPECT_EQ("84983e441c3bd26ebaae4aa1f95129e5e54670f1",
+            toHex(SHA1::hash(bytes(
+                "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"))));
+  std::string Million(1000000, 'a');
+  EXPECT_EQ("34aa973cd4c4daa4f61eeb2bdbad27316534016f",
+            toHex(SHA1::hash(bytes(Million))));
+}
+
+// Splitting the input at any point, including inside and across blocks, does
+// not change the result.
+TEST_P(SHA1Test, Streaming) {
+  if (!Supported)
+    return;
+  std::string Million(1000000, 'a');
+  for (size_t Chunk : {1, 7, 63, 64, 65, 1000}) {
+    SHA1 Hash;
+    for (size_t I = 0; I < Million.size(); I += Chunk)
+      Hash.update(StringRef(Million).substr(I, Chunk));
+    EXPECT_EQ("34aa973cd4c4daa4f61eeb2bdbad27316534016f", toHex(Hash.final()));
+  }
+}
+
+TEST_P(SHA1Test, HashMany) {
+  if (!Supported)
+    return;
+  // Cover every tail size and messages of different lengths in one group.
+  std::vector<std::string> Messages;
+  for (unsigned I = 0; I != 300; ++I) {
+    std::string S;
+    for (unsigned J = 0, E = I * 7 % 400; J != E; ++J)
+      S.push_back(static_cast<char>(I * J + 3));
+    Messages.push_back(S);
+  }
+
+  std::vector<ArrayRef<uint8_t>> Inputs;
+  for (const std::string &S : Messages)
+    Inputs.push_back(bytes(S));
+  std::vector<std::array<uint8_t, 20>> Results(Inputs.size());
+  SHA1::hashMany(Inputs, Results);
+
+  for (size_t I = 0, E = Inputs.size(); I != E; ++I) {
+    SHA1 Hash;
+    for (uint8_t C : Inputs[I])
+      Hash.update(ArrayRef<uint8_t>(C));
+    EXPECT_EQ(toHex(Hash.final()), toHex(Results[I]));
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Implementations, SHA1Test,
+                        testing::Values(SHA1::Implementation::Generic,
+                                        SHA1::Implementation::SHANI,
+                                        SHA1::Implementation::AVX2));
+} // end anonymous namespace
@@ -173,3 +173,36 @@ TEST_F(SourceMgrTest, FixitForTab) {
             Output);
 }
 
+
+TEST_F(SourceMgrTest, LineAndColumnOutOfOrder) {
+  setMainBuffer("aaa\nbbb\r\nccc\n\nddd", "file.in");
+
+  EXPECT_EQ(std::make_pair(3u, 2u), SM.getLineAndColumn(getLoc(10)));
+  EXPECT_EQ(std::make_pair(1u, 1u), SM.getLineAndColumn(getLoc(0)));
+  EXPECT_EQ(std::make_pair(1u, 4u), SM.getLineAndColumn(getLoc(3)));
+  EXPECT_EQ(std::make_pair(2u, 1u), SM.getLineAndColumn(getLoc(4)));
+  EXPECT_EQ(std::make_pair(4u, 1u), SM.getLineAndColumn(getLoc(13)));
+  EXPECT_EQ(std::make_pair(5u, 4u), SM.getLineAndColumn(getLoc(17)));
+}
+
+// The line index uses wider offsets for larger buffers; check a buffer past
+// each width boundary, including the location just past the end.
+TEST_F(SourceMgrTest, LineNumbersInLargeBuffers) {
+  for (unsigned Size : {200u, 300u, 70000u}) {
+    SourceMgr LocalSM;
+    std::string Text;
+    for (unsigned I = 0; I != Size; ++I)
+      Text.push_back(I % 10 == 9 ? '\n' : 'a');
+    unsigned BufferID = LocalSM.AddNewSourceBuffer(
+        MemoryBuffer::getMemBufferCopy(Text, "file.in"), SMLoc());
+    const char *Start =
+        LocalSM.getMemoryBuffer(BufferID)->getBufferStart();
+
+    for (unsigned Offset : {0u, 9u, 10u, 199u, Size - 1, Size}) {
+      auto LineAndCol = LocalSM.getLineAndColumn(
+          SMLoc::getFromPointer(Start + Offset), BufferID);
+      EXPECT_EQ(Offset / 10 + 1, LineAndCol.first);
+      EXPECT_EQ(Offset % 10 + 1, LineAndCol.second);
+    }
+  }
+}
@@ -0,0 +1,83 @@
+//===- llvm/unittest/Support/ThreadLocalAllocatorTest.cpp -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadLocalAllocator.h"
+#include "llvm/Config/llvm-config.h"
+#include "gtest/gtest.h"
+
+#if LLVM_ENABLE_THREADS
+#include <thread>
+#endif
+
+using namespace llvm;
+
+namespace {
+
+TEST(ThreadLocalAllocatorTest, SingleThread) {
+  ThreadLocalBumpPtrAllocator Alloc;
+  EXPECT_EQ(0u, Alloc.getNumArenas());
+  EXPECT_EQ(0u, Alloc.getTotalMemory());
+
+  int *A = Alloc.Allocate<int>(10);
+  int *B = Alloc.Allocate<int>(10);
+  EXPECT_NE(A, B);
+  EXPECT_EQ(1u, Alloc.getNumArenas());
+  EXPECT_EQ(&Alloc.getThreadArena(), &Alloc.getThreadArena());
+  EXPECT_EQ(20 * sizeof(int), Alloc.getBytesAllocated());
+  EXPECT_EQ(1u, Alloc.GetNumSlabs());
+
+  // A request too large for a slab gets a slab of its own.
+  Alloc.Allocate(8192, 1);
+  EXPECT_EQ(2u, Alloc.GetNumSlabs());
+
+  Alloc.Reset();
+  EXPECT_EQ(0u, Alloc.getBytesAllocated());
+  EXPECT_EQ(1u, Alloc.GetNumSlabs());
+  EXPECT_EQ(1u, Alloc.getNumArenas());
+}
+
+#if LLVM_ENABLE_THREADS
+TEST(ThreadLocalAllocatorTest, ManyThreads) {
+  ThreadLocalBumpPtrAllocator Alloc;
+  const unsigned NumThreads = 4, NumInts = 10000;
+  int *Results[NumThreads];
+  BumpPtrAllocator *Arenas[NumThreads];
+
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T != NumThreads; ++T)
+    Threads.emplace_back([&, T] {
+      Arenas[T] = &Alloc.getThreadArena();
+      int *Ints = Alloc.Allocate<int>(NumInts);
+      for (unsigned I = 0; I != NumInts; ++I)
+        Ints[I] = T * NumInts + I;
+      Results[T] = Ints;
+    });
+  for (auto &Thread : Threads)
+    Thread.join();
+
+  // Memory outlives the threads that allocated it.
+  for (unsigned T = 0; T != NumThreads; ++T)
+    for (unsigned I = 0; I != NumInts; ++I)
+      ASSERT_EQ(int(T * NumInts + I), Results[T][I]);
+
+  for (unsigned T = 0; T != NumThreads; ++T)
+    for (unsigned U = T + 1; U != NumThreads; ++U)
+      EXPECT_NE(Arenas[T], Arenas[U]);
+
+  EXPECT_EQ(NumThreads, Alloc.getNumArenas());
+  EXPECT_EQ(NumThreads * NumInts * sizeof(int), Alloc.getBytesAllocated());
+  EXPECT_LE(Alloc.getBytesAllocated(), Alloc.getTotalMemory());
+
+  Alloc.Reset();
+  EXPECT_EQ(0u, Alloc.getBytesAllocated());
+  EXPECT_EQ(NumThreads, Alloc.getNumArenas());
+}
+#endif
+
+} // end anonymous namespace
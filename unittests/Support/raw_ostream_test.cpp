@@ -9,7 +9,9 @@
 
 #include "gtest/gtest.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
@@ -109,6 +111,32 @@ TEST(raw_ostreamTest, Types_Unbuffered) {
   EXPECT_EQ("-9223372036854775808", printToStringUnbuffered(INT64_MIN));
 }
 
+TEST(raw_ostreamTest, Types_DigitCounts) {
+  uint64_t N = 1;
+  for (unsigned Digits = 1; Digits != 20; ++Digits, N *= 10) {
+    EXPECT_EQ(std::to_string(N), printToString(N));
+    EXPECT_EQ(std::to_string(N - 1), printToString(N - 1));
+    EXPECT_EQ(std::to_string(N + 1), printToString(N + 1));
+    EXPECT_EQ(std::to_string(N * 9 + 8), printToString(N * 9 + 8));
+  }
+  EXPECT_EQ("4294967295", printToString(UINT32_MAX));
+  EXPECT_EQ("4294967296", printToString(uint64_t(UINT32_MAX) + 1));
+  EXPECT_EQ("-2147483648", printToString(INT32_MIN));
+}
+
+TEST(raw_ostreamTest, WriteHexBufferEdge) {
+  for (unsigned BytesLeft = 1; BytesLeft != 20; ++BytesLeft) {
+    EXPECT_EQ("0x0", printToString((void *)nullptr, BytesLeft));
+    EXPECT_EQ("0xdeadbeef", printToString((void *)0xdeadbeefLL, BytesLeft));
+  }
+  std::string Str;
+  raw_string_ostream OS(Str);
+  OS.write_hex(UINT64_MAX);
+  OS << ' ';
+  OS.write_hex(0x1000);
+  EXPECT_EQ("ffffffffffffffff 1000", OS.str());
+}
+
 TEST(raw_ostreamTest, BufferEdge) {  
   EXPECT_EQ("1.20", printToString(format("%.2f", 1.2), 1));
   EXPECT_EQ("1.20", printToString(format("%.2f", 1.2), 2));
@@ -127,6 +155,31 @@ TEST(raw_ostreamTest, TinyBuffer) {
   EXPECT_EQ("hello1world", OS.str());
 }
 
+// A write larger than the buffer is passed on together with what is already
+// buffered.
+TEST(raw_ostreamTest, LargeWriteAfterBufferedData) {
+  std::string Large(100, 'x');
+  std::string Str;
+  raw_string_ostream OS(Str);
+  OS.SetBufferSize(16);
+  OS << "abc" << Large << "def" << Large;
+  EXPECT_EQ("abc" + Large + "def" + Large, OS.str());
+
+  SmallString<64> Path;
+  int FD;
+  ASSERT_FALSE(sys::fs::createTemporaryFile("raw_ostream_test", "", FD, Path));
+  {
+    raw_fd_ostream FOS(FD, /*shouldClose=*/true);
+    FOS.SetBufferSize(16);
+    FOS << "abc" << Large << "def" << Large;
+    EXPECT_EQ(206u, FOS.tell());
+  }
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buf = MemoryBuffer::getFile(Path);
+  ASSERT_TRUE((bool)Buf);
+  EXPECT_EQ("abc" + Large + "def" + Large, (*Buf)->getBuffer().str());
+  sys::fs::remove(Path);
+}
+
 TEST(raw_ostreamTest, WriteEscaped) {
   std::string Str;
 
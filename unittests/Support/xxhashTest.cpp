@@ -0,0 +1,208 @@
+//===- llvm/unittest/Support/xxhashTest.cpp - xxHash tests ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/xxhash.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+// Expected values are from the reference implementation and must never
+// change: hashes computed by this function may be stored on disk.
+TEST(xxhashTest, KnownValues) {
+  EXPECT_EQ(0xef46db3751d8e999ULL, xxHash64(""));
+  EXPECT_EQ(0xd24ec4f1a98c6e5bULL, xxHash64("a"));
+  EXPECT_EQ(0x44bc2cf5ad770999ULL, xxHash64("abc"));
+  EXPECT_EQ(0x1fdfc63febacfde7ULL,
+            xxHash64("0123456789abcdef0123456789abcde"));
+  EXPECT_EQ(0x642a94958e71e6c5ULL,
+            xxHash64("0123456789abcdef0123456789abcdef"));
+  EXPECT_EQ(0x0b242d361fda71bcULL,
+            xxHash64("The quick brown fox jumps over the lazy dog"));
+}
+
+TEST(xxhashTest, Seed) {
+  auto Bytes = [](StringRef S) {
+    return ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(S.data()),
+                             S.size());
+  };
+  EXPECT_EQ(0xac75fda2929b17efULL, XXHash64::hash(Bytes(""), 0x9e3779b1));
+  EXPECT_EQ(0x1318df30094a85fdULL, XXHash64::hash(Bytes("abc"), 0x9e3779b1));
+  EXPECT_EQ(0xdfad85ccf8285222ULL,
+            XXHash64::hash(Bytes("0123456789abcdef0123456789abcdef"),
+                           0x9e3779b1));
+}
+
+// Covers every combination of whole stripes and 8, 4 and 1 byte tails.
+TEST(xxhashTest, Lengths) {
+  std::vector<uint8_t> Data;
+  for (unsigned I = 0; I != 256; ++I)
+    Data.push_back(static_cast<uint8_t>(I * 7 + 3));
+  ArrayRef<uint8_t> D(Data);
+
+  EXPECT_EQ(0x1f25c8d0bc1f4bb6ULL, XXHash64::hash(D.slice(0, 1)));
+  EXPECT_EQ(0x31d2363f52e564c9ULL, XXHash64::hash(D.slice(0, 3)));
+  EXPECT_EQ(0x9bb64b7d66ee9fdaULL, XXHash64::hash(D.slice(0, 4)));
+  EXPECT_EQ(0x9a7b149959ce60d8ULL, XXHash64::hash(D.slice(0, 7)));
+  EXPECT_EQ(0xdab99d95c6f90092ULL, XXHash64::hash(D.slice(0, 8)));
+  EXPECT_EQ(0xa2aa5f33cc4a6119ULL, XXHash64::hash(D.slice(0, 31)));
+  EXPECT_EQ(0x23c3c17ef790fd97ULL, XXHash64::hash(D.slice(0, 32)));
+  EXPECT_EQ(0x50a7cfc7ba588784ULL, XXHash64::hash(D.slice(0, 33)));
+  EXPECT_EQ(0x5e3e54b431c7493cULL, XXHash64::hash(D.slice(0, 63)));
+  EXPECT_EQ(0x0eb64b3ef6eeb01fULL, XXHash64::hash(D.slice(0, 64)));
+  EXPECT_EQ(0xa61f8d4c170fe531ULL, XXHash64::hash(D.slice(0, 100)));
+  EXPECT_EQ(0x39ae55a29989206fULL, XXHash64::hash(D.slice(0, 255)));
+  EXPECT_EQ(0x00cfc5207dd8e201ULL, XXHash64::hash(D));
+}
+
+TEST(xxhashTest, Streaming) {
+  std::vector<uint8_t> Data;
+  for (unsigned I = 0; I != 1000; ++I)
+    Data.push_back(static_cast<uint8_t>(I * 13 + 1));
+  ArrayRef<uint8_t> D(Data);
+  uint64_t Expected = XXHash64::hash(D, 42);
+
+  for (size_t Chunk : {1, 3, 8, 31, 32, 33, 100}) {
+    XXHash64 H(42);
+    for (size_t I = 0; I < D.size(); I += Chunk)
+      H.update(D.slice(I, std::min(Chunk, D.size() - I)));
+    EXPECT_EQ(Expected, H.result());
+  }
+
+  // result() does not disturb the state.
+  XXHash64 H(42);
+  H.update(D.slice(0, 500));
+  (void)H.result();
+  H.update(D.drop_front(500));
+  EXPECT_EQ(Expected, H.result());
+
+  H.init(42);
+  H.update(D);
+  EXPECT_EQ(Expected, H.result());
+}
+
+TEST(xxhashTest, StreamingEmptyUpdate) {
+  XXHash64 H;
+  H.update(ArrayRef<uint8_t>());
+  H.update("abc");
+  H.update(StringRef());
+  EXPECT_EQ(0x44bc2cf5ad770999ULL, H.result());
+}
+
+static XXHash128::Result hash128(uint64_t High, uint64_t Low) {
+  return {Low, High};
+}
+
+TEST(xxhashTest, XXH128KnownValues) {
+  EXPECT_EQ(hash128(0x99aa06d3014798d8ULL, 0x6001c324468d497fULL),
+            xxHash128(""));
+  EXPECT_EQ(hash128(0x06b05ab6733a6185ULL, 0x78af5f94892f3950ULL),
+            xxHash128("abc"));
+  EXPECT_EQ(hash128(0xddd650205ca3e7faULL, 0x24a1cc2e3a8a7651ULL),
+            xxHash128("The quick brown fox jumps over the lazy dog"));
+
+  std::array<uint8_t, 16> Bytes = xxHash128("abc").bytes();
+  EXPECT_EQ(0x06, Bytes[0]);
+  EXPECT_EQ(0x85, Bytes[7]);
+  EXPECT_EQ(0x78, Bytes[8]);
+  EXPECT_EQ(0x50, Bytes[15]);
+}
+
+static std::vector<uint8_t> xxh128TestData() {
+  std::vector<uint8_t> Data;
+  for (unsigned I = 0; I != 5000; ++I)
+    Data.push_back(static_cast<uint8_t>(I * 7 + 3));
+  return Data;
+}
+
+// Covers each of the size classes: up to 16 bytes, 17 to 128, 129 to 240, and
+// longer inputs with partial and whole blocks of 1024 bytes.
+TEST(xxhashTest, XXH128Lengths) {
+  std::vector<uint8_t> Data = xxh128TestData();
+  ArrayRef<uint8_t> D(Data);
+  struct {
+    size_t Length;
+    uint64_t High, Low;
+  } Expected[] = {
+      {1, 0x22bbb76b211a39baULL, 0x13e608bc156defedULL},
+      {3, 0xce31763cbf8245a5ULL, 0xa9088dda485b481cULL},
+      {4, 0x47197970590746b1ULL, 0x788a609154b0fe20ULL},
+      {8, 0xe3bc8a5f46171555ULL, 0x3cd024e3d63a1588ULL},
+      {9, 0xc72c88247a9a56d7ULL, 0xeafab1c7f123109fULL},
+      {16, 0xce0b9647ab24f884ULL, 0x60d75c5e47d40a24ULL},
+      {17, 0xbfd327edcc2fbd12ULL, 0xeeed7654312a26d7ULL},
+      {32, 0x4f130f27ab6baf45ULL, 0xd761fd22e8ad5262ULL},
+      {64, 0xfed953fe6a8b2b63ULL, 0xaa549d72c69cd267ULL},
+      {100, 0x2207ed96998d91f2ULL, 0x0cc97f05750182b2ULL},
+      {128, 0x1b1962a096bac78bULL, 0xc580008b6c92ac53ULL},
+      {129, 0x293e4968c4619023ULL, 0xbd91ce7ace4d385bULL},
+      {200, 0x32200a52a918beafULL, 0x380142cdd5843bbdULL},
+      {240, 0xad46c1021b076bc7ULL, 0x04e0b5f034bee80bULL},
+      {241, 0xac6c3492c3d6b45dULL, 0x8beadd3a8874fe17ULL},
+      {256, 0x77f21db933350c7eULL, 0x3c38817f6d79c0daULL},
+      {1024, 0x18bc0eaca9a33636ULL, 0x9b81661c641c72b1ULL},
+      {1025, 0xbf447251cfa98d7cULL, 0x806c2072ed713576ULL},
+      {2048, 0xf81f6e8f418d8075ULL, 0xabe604813ba62ed1ULL},
+      {5000, 0xc98ae385d09887ccULL, 0x799aaddd7339581dULL},
+  };
+  for (auto &E : Expected)
+    EXPECT_EQ(hash128(E.High, E.Low), XXHash128::hash(D.slice(0, E.Length)))
+        << "length " << E.Length;
+}
+
+TEST(xxhashTest, XXH128Seed) {
+  std::vector<uint8_t> Data = xxh128TestData();
+  ArrayRef<uint8_t> D(Data);
+  struct {
+    size_t Length;
+    uint64_t High, Low;
+  } Expected[] = {
+      {0, 0x92220ae55e14ab50ULL, 0x5444f7869c671ab0ULL},
+      {3, 0x1c2e8186abe1f726ULL, 0x16ad8d819b7143c0ULL},
+      {8, 0x1de9685eba90284dULL, 0xece7ce7fd691ccf5ULL},
+      {16, 0xd4eb50a7e415b629ULL, 0xbf767a1b63363506ULL},
+      {100, 0x1a835689ba9d599cULL, 0x51461c5e123d0211ULL},
+      {200, 0x2d973027406411b0ULL, 0x6c9eeedb5d95b3e0ULL},
+      {241, 0xb863cc1b1987b0c2ULL, 0x8f46c475df936767ULL},
+      {5000, 0xa8f69b1788b3948fULL, 0xe3cb90527f9be5faULL},
+  };
+  for (auto &E : Expected)
+    EXPECT_EQ(hash128(E.High, E.Low),
+              XXHash128::hash(D.slice(0, E.Length), 0x9e3779b1))
+        << "length " << E.Length;
+}
+
+TEST(xxhashTest, XXH128Streaming) {
+  std::vector<uint8_t> Data = xxh128TestData();
+  ArrayRef<uint8_t> D(Data);
+
+  for (size_t Length : {0, 100, 240, 241, 300, 1024, 1100, 5000}) {
+    ArrayRef<uint8_t> Input = D.slice(0, Length);
+    XXHash128::Result Expected = XXHash128::hash(Input, 42);
+    for (size_t Chunk : {1, 7, 64, 255, 256, 257, 1000}) {
+      XXHash128 H(42);
+      for (size_t I = 0; I < Input.size(); I += Chunk)
+        H.update(Input.slice(I, std::min(Chunk, Input.size() - I)));
+      EXPECT_EQ(Expected, H.result())
+          << "length " << Length << ", chunk " << Chunk;
+    }
+  }
+
+  // result() does not disturb the state.
+  XXHash128 H;
+  H.update(D.slice(0, 2500));
+  (void)H.result();
+  H.update(ArrayRef<uint8_t>());
+  H.update(D.drop_front(2500));
+  EXPECT_EQ(XXHash128::hash(D), H.result());
+}
+
+} // end anonymous namespace
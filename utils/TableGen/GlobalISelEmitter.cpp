@@ -0,0 +1,364 @@
+//===- GlobalISelEmitter.cpp - Generate an instruction selector -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+/// \file
+/// This tablegen backend emits code for use by the GlobalISel instruction
+/// selector. See include/llvm/Target/TargetGlobalISel.td.
+///
+/// This file analyzes the patterns recognized by the SelectionDAGISel tablegen
+/// backend, filters out the ones that are unsupported, and maps the
+/// SelectionDAG-specific constructs to their GlobalISel counterpart: MVT to
+/// LLT, and SDNode to the generic Instruction given by GINodeEquiv.
+///
+/// Not all patterns are supported: pass the tablegen invocation
+/// "-warn-on-skipped-patterns" to emit a warning when a pattern is skipped,
+/// as well as why.
+///
+/// The supported patterns are compiled into a matcher table sorted by generic
+/// opcode, and the generated file defines a single method:
+///     bool <Target>InstructionSelector::selectImpl(MachineInstr &I) const;
+/// intended to be used in InstructionSelector::select as the first-step
+/// selector for the patterns that don't require complex C++.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CodeGenDAGPatterns.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineValueType.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/TableGen/Error.h"
+#include "llvm/TableGen/Record.h"
+#include "llvm/TableGen/TableGenBackend.h"
+#include <algorithm>
+#include <string>
+using namespace llvm;
+
+#define DEBUG_TYPE "gisel-emitter"
+
+STATISTIC(NumPatternTotal, "Total number of patterns");
+STATISTIC(NumPatternSkipped, "Number of patterns skipped");
+STATISTIC(NumPatternEmitted, "Number of patterns emitted");
+
+static cl::opt<bool> WarnOnSkippedPatterns(
+    "warn-on-skipped-patterns",
+    cl::desc("Explain why a pattern was skipped for inclusion "
+             "in the GlobalISel selector"),
+    cl::init(false));
+
+namespace {
+
+/// A single entry of the matcher table: a generic instruction of a given
+/// scalar size whose register operands are mutated in place into a target
+/// instruction.
+struct MatchRule {
+  /// The generic opcode, e.g. "TargetOpcode::G_ADD", and its enum value.
+  std::string GenericOpcode;
+  unsigned GenericOpcodeValue;
+  /// The size of the scalar type of the generic instruction.
+  unsigned SizeInBits;
+  /// The target opcode, e.g. "AArch64::ADDWrr".
+  std::string Opcode;
+  /// The register class of each operand, in MachineInstr operand order.
+  std::vector<const CodeGenRegisterClass *> OperandRCs;
+  /// A textual form of the source and destination patterns.
+  std::string SrcComment;
+  std::string DstComment;
+};
+
+class GlobalISelEmitter {
+public:
+  explicit GlobalISelEmitter(RecordKeeper &RK);
+  void run(raw_ostream &OS);
+
+private:
+  const RecordKeeper &RK;
+  const CodeGenDAGPatterns CGP;
+  const CodeGenTarget &Target;
+
+  /// Keep track of the equivalence between SDNodes and Instruction.
+  /// This is defined using 'GINodeEquiv' in the target description.
+  DenseMap<Record *, const CodeGenInstruction *> NodeEquivs;
+
+  /// The enum value of each instruction, used to sort the matcher table.
+  DenseMap<const CodeGenInstruction *, unsigned> InstrEnumValues;
+
+  void gatherNodeEquivs();
+  const CodeGenInstruction *findNodeEquiv(Record *N) const;
+
+  /// Analyze pattern \p P. On success, fill in \p Rule and return true;
+  /// otherwise set \p SkipReason to explain why the pattern isn't supported.
+  bool runOnPattern(const PatternToMatch &P, MatchRule &Rule,
+                    std::string &SkipReason);
+};
+
+} // end anonymous namespace
+
+/// Return the register class an operand record refers to, looking through
+/// RegisterOperand.
+static const CodeGenRegisterClass *getRegClass(Record *R,
+                                               const CodeGenTarget &Target) {
+  if (R->isSubClassOf("RegisterOperand"))
+    R = R->getValueAsDef("RegClass");
+  if (!R->isSubClassOf("RegisterClass"))
+    return nullptr;
+  return &Target.getRegisterClass(R);
+}
+
+GlobalISelEmitter::GlobalISelEmitter(RecordKeeper &RK)
+    : RK(RK), CGP(RK), Target(CGP.getTargetInfo()) {}
+
+void GlobalISelEmitter::gatherNodeEquivs() {
+  assert(NodeEquivs.empty());
+  unsigned EnumValue = 0;
+  for (const CodeGenInstruction *Inst : Target.getInstructionsByEnumValue())
+    InstrEnumValues[Inst] = EnumValue++;
+
+  for (Record *Equiv : RK.getAllDerivedDefinitions("GINodeEquiv"))
+    NodeEquivs[Equiv->getValueAsDef("Node")] =
+        &Target.getInstruction(Equiv->getValueAsDef("I"));
+}
+
+const CodeGenInstruction *GlobalISelEmitter::findNodeEquiv(Record *N) const {
+  return NodeEquivs.lookup(N);
+}
+
+bool GlobalISelEmitter::runOnPattern(const PatternToMatch &P,
+                                     MatchRule &Rule,
+                                     std::string &SkipReason) {
+  // If the entire pattern has a predicate (e.g., target features), ignore it.
+  if (!P.getPredicates()->getValues().empty()) {
+    SkipReason = "Pattern has a predicate";
+    return false;
+  }
+
+  TreePatternNode *Src = P.getSrcPattern();
+  TreePatternNode *Dst = P.getDstPattern();
+
+  // If the root of either pattern isn't a simple operator, ignore it.
+  if (Src->isLeaf() || Dst->isLeaf()) {
+    SkipReason = "Src or Dst pattern is a leaf";
+    return false;
+  }
+
+  if (!Src->getPredicateFns().empty() || Src->getTransformFn()) {
+    SkipReason = "Src pattern root has a predicate or transform";
+    return false;
+  }
+
+  // The operators look good: match the opcode and mutate it to the new one.
+  const CodeGenInstruction *SrcGIOrNull = findNodeEquiv(Src->getOperator());
+  if (!SrcGIOrNull) {
+    SkipReason = "Pattern operator lacks an equivalent Instruction";
+    return false;
+  }
+  const CodeGenInstruction &SrcGI = *SrcGIOrNull;
+
+  Record *DstOp = Dst->getOperator();
+  if (!DstOp->isSubClassOf("Instruction")) {
+    SkipReason = "Pattern operator isn't an instruction";
+    return false;
+  }
+  const CodeGenInstruction &DstI = Target.getInstruction(DstOp);
+
+  // Only a single, scalar integer result is supported; it gives the type of
+  // every register operand of the generic instruction.
+  if (Src->getNumTypes() != 1 || !Src->getExtType(0).isConcrete()) {
+    SkipReason = "Src pattern result has multiple or unresolved types";
+    return false;
+  }
+  MVT VT = Src->getType(0);
+  if (!VT.isInteger() || VT.isVector()) {
+    SkipReason = "Src pattern result isn't a scalar integer";
+    return false;
+  }
+
+  // The target instruction must consist of exactly one def followed by the
+  // operands of the source pattern, in the same order, so that the generic
+  // instruction can be mutated in place.
+  if (DstI.Operands.NumDefs != 1 ||
+      DstI.Operands.size() != 1 + Dst->getNumChildren() ||
+      Dst->getNumChildren() != Src->getNumChildren() ||
+      SrcGI.Operands.size() != DstI.Operands.size()) {
+    SkipReason = "Dst instruction operands don't map to the Src pattern";
+    return false;
+  }
+  if (!DstI.ImplicitDefs.empty() || !DstI.ImplicitUses.empty()) {
+    SkipReason = "Dst instruction has implicit operands";
+    return false;
+  }
+
+  const CodeGenRegisterClass *DefRC =
+      getRegClass(DstI.Operands[0].Rec, Target);
+  if (!DefRC) {
+    SkipReason = "Dst instruction def isn't a register class";
+    return false;
+  }
+  Rule.OperandRCs.push_back(DefRC);
+
+  for (unsigned i = 0, e = Src->getNumChildren(); i != e; ++i) {
+    TreePatternNode *SrcChild = Src->getChild(i);
+    TreePatternNode *DstChild = Dst->getChild(i);
+    if (!SrcChild->isLeaf() || !DstChild->isLeaf()) {
+      SkipReason = "Pattern has a nested operand";
+      return false;
+    }
+    if (!SrcChild->getPredicateFns().empty() || SrcChild->getTransformFn()) {
+      SkipReason = "Src pattern child has a predicate or transform";
+      return false;
+    }
+    if (SrcChild->getName().empty() ||
+        SrcChild->getName() != DstChild->getName()) {
+      SkipReason = "Src and Dst operands don't correspond";
+      return false;
+    }
+    if (SrcChild->getNumTypes() != 1 || !SrcChild->getExtType(0).isConcrete() ||
+        SrcChild->getType(0) != VT.SimpleTy) {
+      SkipReason = "Src pattern child type differs from the result type";
+      return false;
+    }
+
+    DefInit *ChildDef = dyn_cast<DefInit>(SrcChild->getLeafValue());
+    const CodeGenRegisterClass *ChildRC =
+        ChildDef ? getRegClass(ChildDef->getDef(), Target) : nullptr;
+    const CodeGenRegisterClass *OpRC =
+        getRegClass(DstI.Operands[i + 1].Rec, Target);
+    if (!ChildRC || !OpRC) {
+      SkipReason = "Pattern operand isn't a register class";
+      return false;
+    }
+    Rule.OperandRCs.push_back(OpRC);
+  }
+
+  Rule.GenericOpcode = "TargetOpcode::" + SrcGI.TheDef->getName();
+  Rule.GenericOpcodeValue = InstrEnumValues.lookup(&SrcGI);
+  Rule.SizeInBits = VT.getSizeInBits();
+  Rule.Opcode = DstI.Namespace + "::" + DstI.TheDef->getName();
+
+  raw_string_ostream SrcOS(Rule.SrcComment);
+  Src->print(SrcOS);
+  SrcOS.flush();
+  raw_string_ostream DstOS(Rule.DstComment);
+  Dst->print(DstOS);
+  DstOS.flush();
+  return true;
+}
+
+void GlobalISelEmitter::run(raw_ostream &OS) {
+  // Track the GINodeEquiv definitions.
+  gatherNodeEquivs();
+
+  emitSourceFileHeader("Global Instruction Selector for the " +
+                       Target.getName() + " target", OS);
+
+  // Look through the SelectionDAG patterns we found, possibly emitting some.
+  std::vector<MatchRule> Rules;
+  for (CodeGenDAGPatterns::ptm_iterator I = CGP.ptm_begin(),
+       E = CGP.ptm_end(); I != E; ++I) {
+    const PatternToMatch &Pat = *I;
+    ++NumPatternTotal;
+    MatchRule Rule;
+    std::string SkipReason;
+    if (!runOnPattern(Pat, Rule, SkipReason)) {
+      if (WarnOnSkippedPatterns) {
+        PrintWarning(Pat.getSrcRecord()->getLoc(),
+                     "Skipped pattern: " + SkipReason);
+      }
+      ++NumPatternSkipped;
+      continue;
+    }
+    Rules.push_back(std::move(Rule));
+  }
+
+  // Sort the table by generic opcode so that the selector can binary search
+  // it. Ties keep the pattern order, so the first matching pattern wins.
+  std::stable_sort(Rules.begin(), Rules.end(),
+                   [](const MatchRule &LHS, const MatchRule &RHS) {
+    return LHS.GenericOpcodeValue < RHS.GenericOpcodeValue;
+  });
+
+  unsigned MaxOperands = 1;
+  for (const MatchRule &Rule : Rules)
+    MaxOperands = std::max<unsigned>(MaxOperands, Rule.OperandRCs.size());
+
+  OS << "#ifdef GET_GLOBALISEL_IMPL\n\n"
+     << "namespace {\n"
+     << "struct GISelMatchRule {\n"
+     << "  unsigned GenericOpcode;\n"
+     << "  unsigned SizeInBits;\n"
+     << "  unsigned Opcode;\n"
+     << "  unsigned NumOperands;\n"
+     << "  unsigned OperandRCs[" << MaxOperands << "];\n"
+     << "};\n"
+     << "} // end anonymous namespace\n\n"
+     << "static const GISelMatchRule GISelMatchTable[] = {\n";
+  for (const MatchRule &Rule : Rules) {
+    ++NumPatternEmitted;
+    OS << "  // Src: " << Rule.SrcComment << "\n"
+       << "  // Dst: " << Rule.DstComment << "\n"
+       << "  { " << Rule.GenericOpcode << ", " << Rule.SizeInBits << ", "
+       << Rule.Opcode << ", " << Rule.OperandRCs.size() << ", { ";
+    for (unsigned i = 0, e = Rule.OperandRCs.size(); i != e; ++i)
+      OS << (i ? ", " : "") << Rule.OperandRCs[i]->getQualifiedName()
+         << "RegClassID";
+    OS << " } },\n";
+  }
+  if (Rules.empty())
+    OS << "  { 0, 0, 0, 0, { 0 } },\n";
+  OS << "};\n\n";
+
+  OS << "bool " << Target.getName()
+     << "InstructionSelector::selectImpl(MachineInstr &I) const {\n"
+     << "  MachineRegisterInfo &MRI = I.getParent()->getParent()->getRegInfo();\n"
+     << "  if (I.getNumTypes() != 1 || !I.getType().isScalar())\n"
+     << "    return false;\n"
+     << "  const unsigned SizeInBits = I.getType().getSizeInBits();\n\n"
+     << "  const GISelMatchRule *Rule = std::lower_bound(\n"
+     << "      std::begin(GISelMatchTable), std::end(GISelMatchTable),\n"
+     << "      I.getOpcode(), [](const GISelMatchRule &LHS, unsigned RHS) {\n"
+     << "        return LHS.GenericOpcode < RHS;\n"
+     << "      });\n"
+     << "  for (; Rule != std::end(GISelMatchTable) &&\n"
+     << "         Rule->GenericOpcode == I.getOpcode(); ++Rule) {\n"
+     << "    if (Rule->SizeInBits != SizeInBits ||\n"
+     << "        Rule->NumOperands != I.getNumOperands())\n"
+     << "      continue;\n\n"
+     << "    bool Matched = true;\n"
+     << "    for (unsigned OpI = 0; OpI != Rule->NumOperands; ++OpI) {\n"
+     << "      const MachineOperand &MO = I.getOperand(OpI);\n"
+     << "      if (!MO.isReg() || !TargetRegisterInfo::isVirtualRegister("
+        "MO.getReg())) {\n"
+     << "        Matched = false;\n"
+     << "        break;\n"
+     << "      }\n"
+     << "      const RegisterBank *RB = RBI.getRegBank(MO.getReg(), MRI, TRI);\n"
+     << "      const TargetRegisterClass &RC =\n"
+     << "          *TRI.getRegClass(Rule->OperandRCs[OpI]);\n"
+     << "      if (!RB || RB != &RBI.getRegBankFromRegClass(RC)) {\n"
+     << "        Matched = false;\n"
+     << "        break;\n"
+     << "      }\n"
+     << "    }\n"
+     << "    if (!Matched)\n"
+     << "      continue;\n\n"
+     << "    I.setDesc(TII.get(Rule->Opcode));\n"
+     << "    I.removeTypes();\n"
+     << "    return constrainSelectedInstRegOperands(I, TII, TRI, RBI);\n"
+     << "  }\n"
+     << "  return false;\n"
+     << "}\n\n"
+     << "#endif // GET_GLOBALISEL_IMPL\n";
+}
+
+//===----------------------------------------------------------------------===//
+
+namespace llvm {
+void EmitGlobalISel(RecordKeeper &RK, raw_ostream &OS) {
+  GlobalISelEmitter(RK).run(OS);
+}
+} // End llvm namespace
@@ -36,6 +36,7 @@ enum ActionType {
   GenDAGISel,
   GenDFAPacketizer,
   GenFastISel,
+  GenGlobalISel,
   GenSubtarget,
   GenIntrinsic,
   GenTgtIntrinsic,
@@ -74,6 +75,8 @@ namespace {
                                "Generate DFA Packetizer for VLIW targets"),
                     clEnumValN(GenFastISel, "gen-fast-isel",
                                "Generate a \"fast\" instruction selector"),
+                    clEnumValN(GenGlobalISel, "gen-global-isel",
+                               "Generate GlobalISel selector"),
                     clEnumValN(GenSubtarget, "gen-subtarget",
                                "Generate subtarget enumerations"),
                     clEnumValN(GenIntrinsic, "gen-intrinsic",
@@ -136,6 +139,9 @@ bool LLVMTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
   case GenFastISel:
     EmitFastISel(Records, OS);
     break;
+  case GenGlobalISel:
+    EmitGlobalISel(Records, OS);
+    break;
   case GenSubtarget:
     EmitSubtarget(Records, OS);
     break;
@@ -0,0 +1,78 @@
+#!/usr/bin/env python
+"""A LazyValueInfo benchmark generator.
+
+This is a python program that creates LLVM IR for a switch-heavy function in
+which many values flow through a long chain of compares and switches.  Jump
+threading asks LazyValueInfo about each of them on every edge, which makes the
+LVI cache and solver dominate the compile time:
+
+  create_lvi_bench.py 2000 | opt -jump-threading -time-passes -disable-output
+
+and comparing the "Jump Threading" line, or -stats with
+-lvi-max-processed-per-value, before and after a change to LazyValueInfo.
+"""
+
+from __future__ import print_function
+
+import argparse
+import random
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__,
+      formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('blocks', type=int, help="Number of switch blocks to emit")
+  parser.add_argument('--values', type=int, default=8,
+                      help="Number of values carried through the chain")
+  parser.add_argument('--seed', type=int, default=0,
+                      help="Seed for the case values")
+  args = parser.parse_args()
+  rng = random.Random(args.seed)
+
+  print("define i32 @lvi_bench(%s) {" %
+        ", ".join("i32 %%a%d" % i for i in range(args.values)))
+  print("entry:")
+  print("  br label %b0")
+
+  for n in range(args.blocks):
+    print("b%d:" % n)
+    # Each value is either its argument, or a constant on the edges coming
+    # from the previous switch, so that the edge values differ.
+    for v in range(args.values):
+      if n == 0:
+        print("  %%v%d.%d = phi i32 [ %%a%d, %%entry ]" % (v, n, v))
+      else:
+        prev = "%%v%d.%d" % (v, n - 1)
+        print("  %%v%d.%d = phi i32 [ %s, %%b%d ], [ %s, %%s%d ], "
+              "[ %d, %%c%d ]" % (v, n, prev, n - 1, prev, n - 1,
+                                 rng.randrange(16), n - 1))
+    v = rng.randrange(args.values)
+    print("  %%cmp%d = icmp ult i32 %%v%d.%d, %d" % (n, v, n, rng.randrange(16)))
+    nxt = "b%d" % (n + 1) if n + 1 < args.blocks else "exit"
+    print("  br i1 %%cmp%d, label %%s%d, label %%%s" % (n, n, nxt))
+    print("s%d:" % n)
+    v = rng.randrange(args.values)
+    cases = sorted(rng.sample(range(16), 4))
+    print("  switch i32 %%v%d.%d, label %%%s [" % (v, n, nxt))
+    for c in cases:
+      print("    i32 %d, label %%c%d" % (c, n))
+    print("  ]")
+    print("c%d:" % n)
+    print("  br label %%%s" % nxt)
+
+  print("exit:")
+  last = args.blocks - 1
+  preds = ["%%b%d" % last, "%%s%d" % last, "%%c%d" % last]
+  vals = ["%%v%d.%d" % (v, last) for v in range(args.values)]
+  for v in range(args.values):
+    print("  %%r%d = phi i32 %s" %
+          (v, ", ".join("[ %s, %s ]" % (vals[v], p) for p in preds)))
+  acc = "%r0"
+  for v in range(1, args.values):
+    print("  %%sum%d = add i32 %s, %%r%d" % (v, acc, v))
+    acc = "%%sum%d" % v
+  print("  ret i32 %s" % acc)
+  print("}")
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,137 @@
+//===- HashBench - Measure the throughput of the Support hashes -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program hashes a buffer of pseudo random bytes with each hash function
+// in Support and prints its throughput. -size sets the buffer size; small
+// sizes show the per-call overhead, large ones the bulk speed. SHA1 and MD5
+// are measured with each implementation the host supports, for one buffer and
+// for -buffers independent buffers through hashMany.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <random>
+#include <vector>
+
+using namespace llvm;
+
+static cl::opt<unsigned> BufferSize("size",
+                                    cl::desc("Size of the hashed buffer"),
+                                    cl::init(64 << 20));
+
+static cl::opt<unsigned> TotalSize("total",
+                                   cl::desc("Number of bytes to hash per "
+                                            "round"),
+                                   cl::init(256 << 20));
+
+static cl::opt<unsigned> NumRounds("rounds",
+                                   cl::desc("Number of rounds, the fastest "
+                                            "counts"),
+                                   cl::init(3));
+
+static cl::opt<unsigned> NumBuffers("buffers",
+                                    cl::desc("Number of buffers for the "
+                                             "hashMany measurements"),
+                                    cl::init(64));
+
+static volatile uint64_t Sink;
+
+/// Hash the buffer repeatedly until TotalSize bytes are processed, and print
+/// the best throughput over NumRounds rounds.
+template <typename FnT>
+static void measure(StringRef Name, ArrayRef<uint8_t> Data, FnT Hash) {
+  size_t Calls =
+      std::max<size_t>(1, TotalSize / std::max<size_t>(1, Data.size()));
+  double Best = 0;
+  for (unsigned Round = 0; Round != NumRounds; ++Round) {
+    double Start = TimeRecord::getCurrentTime(true).getWallTime();
+    for (size_t I = 0; I != Calls; ++I)
+      Sink = Sink + Hash(Data);
+    double Time = TimeRecord::getCurrentTime(true).getWallTime() - Start;
+    if (Round == 0 || Time < Best)
+      Best = Time;
+  }
+  double Bytes = double(Calls) * Data.size();
+  outs() << format("%-16s %10.1f MB/s %10.1f ns/call\n", Name.data(),
+                   Bytes / Best / (1 << 20), Best * 1e9 / Calls);
+}
+
+int main(int argc, char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "Support hash benchmark\n");
+
+  std::vector<uint8_t> Buffer(BufferSize);
+  std::mt19937 Gen(0);
+  for (uint8_t &B : Buffer)
+    B = static_cast<uint8_t>(Gen());
+  ArrayRef<uint8_t> Data(Buffer);
+
+  outs() << "buffer size " << Data.size() << "\n";
+  measure("xxhash64", Data,
+          [](ArrayRef<uint8_t> D) { return XXHash64::hash(D); });
+  measure("xxhash128", Data,
+          [](ArrayRef<uint8_t> D) { return XXHash128::hash(D).Low; });
+  // Split the buffer for the multi-buffer hashes.
+  std::vector<ArrayRef<uint8_t>> Buffers;
+  size_t Chunk = std::max<size_t>(1, Data.size() / NumBuffers);
+  for (size_t I = 0; I + Chunk <= Data.size(); I += Chunk)
+    Buffers.push_back(Data.slice(I, Chunk));
+
+  struct {
+    const char *Name;
+    SHA1::Implementation Impl;
+  } SHA1Impls[] = {{"generic", SHA1::Implementation::Generic},
+                   {"sha-ni", SHA1::Implementation::SHANI},
+                   {"avx2", SHA1::Implementation::AVX2}};
+  for (auto &I : SHA1Impls) {
+    if (!SHA1::setImplementationForTesting(I.Impl))
+      continue;
+    measure((Twine("sha1-") + I.Name).str(), Data, [](ArrayRef<uint8_t> D) {
+      return uint64_t(SHA1::hash(D)[0]);
+    });
+    std::vector<std::array<uint8_t, 20>> Results(Buffers.size());
+    measure((Twine("sha1many-") + I.Name).str(), Data,
+            [&](ArrayRef<uint8_t>) {
+              SHA1::hashMany(Buffers, Results);
+              return uint64_t(Results[0][0]);
+            });
+  }
+  SHA1::setImplementationForTesting(SHA1::Implementation::Default);
+
+  measure("md5", Data, [](ArrayRef<uint8_t> D) {
+    MD5 Hash;
+    Hash.update(D);
+    MD5::MD5Result Result;
+    Hash.final(Result);
+    return uint64_t(Result[0]);
+  });
+  struct {
+    const char *Name;
+    MD5::Implementation Impl;
+  } MD5Impls[] = {{"generic", MD5::Implementation::Generic},
+                  {"avx2", MD5::Implementation::AVX2}};
+  for (auto &I : MD5Impls) {
+    if (!MD5::setImplementationForTesting(I.Impl))
+      continue;
+    std::vector<std::array<uint8_t, 16>> Results(Buffers.size());
+    measure((Twine("md5many-") + I.Name).str(), Data,
+            [&](ArrayRef<uint8_t>) {
+              MD5::hashMany(Buffers, Results);
+              return uint64_t(Results[0][0]);
+            });
+  }
+  MD5::setImplementationForTesting(MD5::Implementation::Default);
+  return 0;
+}
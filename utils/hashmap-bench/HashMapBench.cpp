@@ -0,0 +1,184 @@
+//===- HashMapBench - Compare DenseMap and SwissTableMap ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program times DenseMap and SwissTableMap on the key and value shapes of
+// the maps that use them, and prints the time per operation:
+//
+//   ptr/ptr      pointer keys and values, e.g. the ValueMap of a cloner
+//   ptr/range    pointer keys with 40 byte values, e.g. the SCEV range caches
+//   wide/ptr     two word keys and pointer values, e.g. the APInt constants
+//   pair/int     pairs of pointer keys, e.g. the alias query cache
+//
+// Each map is filled with -entries keys in allocation order, then looked up
+// in random order with keys it holds and with keys it doesn't, and churned by
+// erasing and reinserting.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SwissTableMap.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace llvm;
+
+static cl::opt<unsigned> NumEntries("entries",
+                                    cl::desc("Number of keys in each map"),
+                                    cl::init(200000));
+
+static cl::opt<unsigned> NumRounds("rounds",
+                                   cl::desc("Number of times to run each "
+                                            "operation, the fastest counts"),
+                                   cl::init(5));
+
+namespace {
+/// A value as large as a ConstantRange of two 64 bit APInts.
+struct RangeValue {
+  uint64_t Words[5];
+  RangeValue() : Words() {}
+  explicit RangeValue(uint64_t V) : Words{V, V, V, V, V} {}
+};
+
+typedef std::pair<uint64_t, uint64_t> WideKey;
+typedef std::pair<const void *, const void *> PairKey;
+
+/// Make \p Count distinct keys of the given shape. Pointer keys come from one
+/// allocation, like the values and SCEVs a pass creates in a row.
+template <typename KeyT> struct KeyMaker;
+
+template <> struct KeyMaker<const void *> {
+  std::vector<char> Storage;
+  std::vector<const void *> make(unsigned Count) {
+    Storage.resize(Count * 2 * 16);
+    std::vector<const void *> Keys;
+    for (unsigned I = 0; I != Count * 2; ++I)
+      Keys.push_back(&Storage[I * 16]);
+    return Keys;
+  }
+};
+
+template <> struct KeyMaker<WideKey> {
+  std::vector<WideKey> make(unsigned Count) {
+    std::vector<WideKey> Keys;
+    for (uint64_t I = 0; I != Count * 2; ++I)
+      Keys.push_back(WideKey(I * 0x10001, ~I));
+    return Keys;
+  }
+};
+
+template <> struct KeyMaker<PairKey> {
+  KeyMaker<const void *> Pointers;
+  std::vector<PairKey> make(unsigned Count) {
+    std::vector<const void *> Ptrs = Pointers.make(Count);
+    std::vector<PairKey> Keys;
+    for (unsigned I = 0; I != Count * 2; ++I)
+      Keys.push_back(PairKey(Ptrs[I], Ptrs[(I * 7 + 1) % Ptrs.size()]));
+    return Keys;
+  }
+};
+
+template <typename ValueT> ValueT makeValue(unsigned I) { return ValueT(I); }
+template <> const void *makeValue<const void *>(unsigned I) {
+  return reinterpret_cast<const void *>(uintptr_t(I) * 8);
+}
+
+/// Run \p Fn NumRounds times and return the fastest time per operation in
+/// nanoseconds.
+template <typename FnT> double timeOp(unsigned NumOps, FnT Fn) {
+  double Best = 0;
+  for (unsigned Round = 0; Round != NumRounds; ++Round) {
+    double Start = TimeRecord::getCurrentTime(true).getWallTime();
+    Fn();
+    double Time = TimeRecord::getCurrentTime(true).getWallTime() - Start;
+    if (Round == 0 || Time < Best)
+      Best = Time;
+  }
+  return Best * 1e9 / NumOps;
+}
+
+struct Times {
+  double Insert, Hit, Miss, Churn;
+};
+
+template <typename MapT, typename KeyT, typename ValueT>
+Times runMap(const std::vector<KeyT> &Keys, const std::vector<KeyT> &Shuffled,
+             const std::vector<KeyT> &Missing) {
+  unsigned N = NumEntries;
+  Times T;
+  volatile uint64_t Sink = 0;
+  T.Insert = timeOp(N, [&] {
+    MapT Map;
+    for (unsigned I = 0; I != N; ++I)
+      Map.insert(std::make_pair(Keys[I], makeValue<ValueT>(I)));
+    Sink = Sink + Map.size();
+  });
+
+  MapT Map;
+  for (unsigned I = 0; I != N; ++I)
+    Map.insert(std::make_pair(Keys[I], makeValue<ValueT>(I)));
+  T.Hit = timeOp(N, [&] {
+    unsigned Found = 0;
+    for (unsigned I = 0; I != N; ++I)
+      Found += Map.find(Shuffled[I]) != Map.end();
+    Sink = Sink + Found;
+  });
+  T.Miss = timeOp(N, [&] {
+    unsigned Found = 0;
+    for (unsigned I = 0; I != N; ++I)
+      Found += Map.count(Missing[I]);
+    Sink = Sink + Found;
+  });
+  T.Churn = timeOp(N, [&] {
+    for (unsigned I = 0; I != N; ++I) {
+      Map.erase(Shuffled[I]);
+      Map.insert(std::make_pair(Shuffled[I], makeValue<ValueT>(I)));
+    }
+  });
+  return T;
+}
+
+template <typename KeyT, typename ValueT> void runShape(StringRef Name) {
+  KeyMaker<KeyT> Maker;
+  std::vector<KeyT> Keys = Maker.make(NumEntries);
+  std::vector<KeyT> Shuffled(Keys.begin(), Keys.begin() + NumEntries);
+  std::vector<KeyT> Missing(Keys.begin() + NumEntries, Keys.end());
+  std::mt19937 Rng(0);
+  std::shuffle(Shuffled.begin(), Shuffled.end(), Rng);
+  std::shuffle(Missing.begin(), Missing.end(), Rng);
+
+  Times Dense =
+      runMap<DenseMap<KeyT, ValueT>, KeyT, ValueT>(Keys, Shuffled, Missing);
+  Times Swiss = runMap<SwissTableMap<KeyT, ValueT>, KeyT, ValueT>(
+      Keys, Shuffled, Missing);
+  auto Print = [&](StringRef Op, double D, double S) {
+    outs() << format("%-10s %-7s %9.1f %9.1f %+7.0f%%\n", Name.data(),
+                     Op.data(), D, S, (S - D) * 100 / D);
+  };
+  Print("insert", Dense.Insert, Swiss.Insert);
+  Print("hit", Dense.Hit, Swiss.Hit);
+  Print("miss", Dense.Miss, Swiss.Miss);
+  Print("churn", Dense.Churn, Swiss.Churn);
+}
+} // end anonymous namespace
+
+int main(int argc, char **argv) {
+  cl::ParseCommandLineOptions(argc, argv,
+                              "DenseMap and SwissTableMap benchmark\n");
+  outs() << "shape      op       dense ns  swiss ns   change\n";
+  runShape<const void *, const void *>("ptr/ptr");
+  runShape<const void *, RangeValue>("ptr/range");
+  runShape<WideKey, const void *>("wide/ptr");
+  runShape<PairKey, unsigned>("pair/int");
+  return 0;
+}
@@ -0,0 +1,63 @@
+#!/usr/bin/env python
+"""Measure the startup time of LLVM tools.
+
+This is a python program that runs llc, opt and llvm-mc on an empty input many
+times and prints the fastest and the median wall time of each.  An empty input
+leaves little besides static initialization and command line parsing, which is
+what changes to lib/Support/CommandLine.cpp affect:
+
+  measure_startup.py --bindir build/bin --runs 200
+
+Run it on two builds, or on one tool relinked with two versions of a library,
+on an otherwise idle machine.
+"""
+
+from __future__ import print_function
+
+import argparse
+import os
+import subprocess
+import time
+
+
+# Each tool reads an empty module or assembly file from stdin.
+TOOLS = [
+    ('llc', ['-o', os.devnull]),
+    ('opt', ['-o', os.devnull]),
+    ('llvm-mc', ['-o', os.devnull]),
+]
+
+
+def measure(cmd, runs):
+  times = []
+  with open(os.devnull, 'rb') as empty:
+    for _ in range(runs):
+      start = time.time()
+      subprocess.check_call(cmd, stdin=empty)
+      times.append(time.time() - start)
+  times.sort()
+  return times[0], times[len(times) // 2]
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__,
+      formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('--bindir', required=True,
+                      help="Directory holding the tools")
+  parser.add_argument('--runs', type=int, default=100,
+                      help="Number of runs of each tool")
+  parser.add_argument('tools', nargs='*',
+                      help="Tools to measure, all of them by default")
+  args = parser.parse_args()
+
+  for tool, tool_args in TOOLS:
+    if args.tools and tool not in args.tools:
+      continue
+    cmd = [os.path.join(args.bindir, tool)] + tool_args
+    best, median = measure(cmd, args.runs)
+    print('%-8s best %7.2f ms  median %7.2f ms' % (tool, best * 1000,
+                                                   median * 1000))
+
+
+if __name__ == '__main__':
+  main()